@@ -0,0 +1,195 @@
+#include "Archive.h"
+#include "Image.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <ktx.h>
+#include <sstream>
+
+#define TINYGLTF_IMPLEMENTATION
+#include <tiny_gltf.h>
+
+namespace fs = std::filesystem;
+
+// asset blob
+struct Blob
+{
+    // asset key
+    std::string key;
+    // baked asset
+    std::vector<char> bytes;
+};
+
+// Read the file as is.
+std::vector<char> readFile(const fs::path& path)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to read asset from " + path.string());
+    }
+    std::vector<char> bytes(file.tellg());
+    file.seekg(0);
+    file.read(bytes.data(), bytes.size());
+    return bytes;
+}
+
+// Bake the Khronos texture (KTX 2.0) to the RGBA8 images uploaded by the demo.
+// Basis Universal and block-compressed textures are read as is, since they are not expanded to RGBA8.
+std::vector<char> bakeTexture(const fs::path& path)
+{
+    ktxTexture2* texture;
+    if (ktxTexture2_CreateFromNamedFile(path.string().data(), KTX_TEXTURE_CREATE_NO_FLAGS, &texture) != KTX_SUCCESS)
+    {
+        throw std::runtime_error("Failed to load texture from " + path.string());
+    }
+    const bool compressed = ktxTexture2_NeedsTranscoding(texture) || texture->isCompressed;
+    ktxTexture2_Destroy(texture);
+    if (compressed)
+    {
+        return readFile(path);
+    }
+
+    std::vector<uint8_t> images;
+    const TextureLayout layout =
+        ImageData::readKhronosTexture(path, TextureCompression::none, [&images](size_t size) -> uint8_t* {
+            images.resize(size);
+            return images.data();
+        });
+    const Archive::TextureHeader header{
+        .width = static_cast<uint32_t>(layout.width),
+        .height = static_cast<uint32_t>(layout.height),
+        .faceCount = static_cast<uint32_t>(layout.offsets.size()),
+        .levelCount = static_cast<uint32_t>(layout.offsets[0].size()),
+    };
+    std::vector<char> bytes(sizeof(header));
+    memcpy(bytes.data(), &header, sizeof(header));
+    for (uint32_t face = 0; face < header.faceCount; face++)
+    {
+        for (uint32_t mipLevel = 0; mipLevel < header.levelCount; mipLevel++)
+        {
+            const size_t size =
+                std::max(layout.width >> mipLevel, 1) * std::max(layout.height >> mipLevel, 1) * ImageData::channels;
+            const char* data = reinterpret_cast<const char*>(images.data() + layout.offsets[face][mipLevel]);
+            bytes.insert(bytes.end(), data, data + size);
+        }
+    }
+    return bytes;
+}
+
+// Bake the glTF model to binary glTF with embedded buffers.
+std::vector<char> bakeModel(const fs::path& path)
+{
+    tinygltf::TinyGLTF tinyGLTF;
+    tinygltf::Model model;
+    std::string error, warning;
+    const bool success = path.extension() == ".glb"
+                             ? tinyGLTF.LoadBinaryFromFile(&model, &error, &warning, path.string())
+                             : tinyGLTF.LoadASCIIFromFile(&model, &error, &warning, path.string());
+    if (!warning.empty())
+    {
+        std::clog << warning << std::endl;
+    }
+    if (!success)
+    {
+        throw std::runtime_error("Failed to load model from " + path.string() + (error.empty() ? "" : (": " + error)));
+    }
+    std::ostringstream stream(std::ios::binary);
+    if (!tinyGLTF.WriteGltfSceneToStream(&model, stream, false, true))
+    {
+        throw std::runtime_error("Failed to bake model from " + path.string());
+    }
+    const std::string bytes = stream.str();
+    return std::vector<char>(bytes.begin(), bytes.end());
+}
+
+// Bake the demo assets into the asset archive (see Archive.h).
+int main()
+{
+    try
+    {
+        // Bake the assets.
+        std::vector<Blob> blobs;
+        for (const char* directory : {"fonts", "meshes", "models", "sounds", "textures"})
+        {
+            for (const fs::directory_entry& entry : fs::recursive_directory_iterator(assetDirectoryPath() / directory))
+            {
+                const fs::path& path = entry.path();
+                const fs::path extension = path.extension();
+                // The licenses are not loaded, and the glTF buffers are embedded into the baked models.
+                if (!entry.is_regular_file() || extension == ".txt" || extension == ".bin")
+                {
+                    continue;
+                }
+                Blob blob{.key = Archive::key(path)};
+                if (blob.key.size() >= sizeof(Archive::Entry::key))
+                {
+                    throw std::runtime_error("Failed to bake asset " + blob.key + ": key too long");
+                }
+                if (extension == ".ktx2")
+                {
+                    blob.bytes = bakeTexture(path);
+                }
+                else if (extension == ".gltf" || extension == ".glb")
+                {
+                    blob.bytes = bakeModel(path);
+                }
+                else
+                {
+                    blob.bytes = readFile(path);
+                }
+                blobs.emplace_back(std::move(blob));
+            }
+        }
+        std::sort(blobs.begin(), blobs.end(), [](const Blob& a, const Blob& b) -> bool { return a.key < b.key; });
+
+        // Lay out the table of contents and the aligned blobs.
+        const Archive::Header header{
+            .magic = Archive::magic,
+            .version = Archive::version,
+            .entryCount = static_cast<uint32_t>(blobs.size()),
+        };
+        std::vector<Archive::Entry> entries(blobs.size());
+        uint64_t offset = alignedSize(sizeof(header) + blobs.size() * sizeof(Archive::Entry), Archive::blobAlignment);
+        for (size_t b = 0; b < blobs.size(); b++)
+        {
+            strncpy(entries[b].key, blobs[b].key.data(), sizeof(entries[b].key));
+            entries[b].offset = offset;
+            entries[b].size = blobs[b].bytes.size();
+            offset = alignedSize(offset + entries[b].size, Archive::blobAlignment);
+        }
+
+        // Write the archive to a temporary file and replace the archive, so that it is never read incomplete.
+        const fs::path path = archivePath();
+        fs::path temporary = path;
+        temporary += ".tmp";
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to write asset archive to " + temporary.string());
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Archive::Entry));
+        for (size_t b = 0; b < blobs.size(); b++)
+        {
+            const std::vector<char> padding(entries[b].offset - static_cast<uint64_t>(file.tellp()), 0);
+            file.write(padding.data(), padding.size());
+            file.write(blobs[b].bytes.data(), blobs[b].bytes.size());
+        }
+        file.close();
+        if (!file.good())
+        {
+            throw std::runtime_error("Failed to write asset archive to " + temporary.string());
+        }
+        fs::rename(temporary, path);
+        std::cout << "Baked " << blobs.size() << " assets to " << path.string() << std::endl;
+    }
+    catch (const std::exception& exception)
+    {
+        std::cerr << exception.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "Archive.h"
+
+#include "Utils.h"
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+Archive::Stream::Stream(const Data& blob)
+    : std::istream(this)
+{
+    char* begin = static_cast<char*>(blob.data);
+    setg(begin, begin, begin + blob.size);
+}
+
+std::streampos Archive::Stream::seekoff(std::streamoff offset, std::ios_base::seekdir direction,
+                                       std::ios_base::openmode mode)
+{
+    char* position = offset + (direction == std::ios_base::beg   ? eback()
+                               : direction == std::ios_base::cur ? gptr()
+                                                                 : egptr());
+    if (!(mode & std::ios_base::in) || position < eback() || position > egptr())
+    {
+        return std::streampos(std::streamoff(-1));
+    }
+    setg(eback(), position, egptr());
+    return std::streampos(position - eback());
+}
+
+std::streampos Archive::Stream::seekpos(std::streampos position, std::ios_base::openmode mode)
+{
+    return seekoff(std::streamoff(position), std::ios_base::beg, mode);
+}
+
+Archive::Archive(const fs::path& path)
+    : file(path)
+{
+    const Data mapping = file.data();
+    if (!mapping.data)
+    {
+        return;
+    }
+
+    // Validate the header and read the table of contents.
+    // An invalid archive is ignored, so that the assets are loaded from their source files.
+    uint8_t* const begin = static_cast<uint8_t*>(mapping.data);
+    const Header& header = *reinterpret_cast<const Header*>(begin);
+    if (mapping.size < sizeof(Header) || header.magic != magic || header.version != version ||
+        mapping.size < sizeof(Header) + header.entryCount * sizeof(Entry))
+    {
+        return;
+    }
+    const Entry* const entries = reinterpret_cast<const Entry*>(begin + sizeof(Header));
+    blobs.reserve(header.entryCount);
+    for (uint32_t e = 0; e < header.entryCount; e++)
+    {
+        const Entry& entry = entries[e];
+        if (entry.offset > mapping.size || entry.size > mapping.size - entry.offset)
+        {
+            blobs.clear();
+            return;
+        }
+        blobs[std::string(entry.key, strnlen(entry.key, sizeof(entry.key)))] = Data{
+            .data = begin + entry.offset,
+            .size = entry.size,
+        };
+    }
+}
+
+std::string Archive::key(const fs::path& path)
+{
+    return path.lexically_relative(assetDirectoryPath()).generic_string();
+}
+
+Data Archive::find(const fs::path& path) const
+{
+    if (blobs.empty())
+    {
+        return {};
+    }
+    const auto blob = blobs.find(key(path));
+    return blob == blobs.end() ? Data{} : blob->second;
+}
+
+const Archive& Archive::assets()
+{
+    static const Archive archive(archivePath());
+    return archive;
+}
\ No newline at end of file
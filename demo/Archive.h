@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Data.h"
+#include "MappedFile.h"
+#include <filesystem>
+#include <istream>
+#include <string>
+#include <unordered_map>
+
+// packed asset archive
+// The archive is baked offline from the asset files (see baker/main.cpp) and memory-mapped at runtime.
+// It consists of a header, the table of contents and the asset blobs aligned to the blob alignment.
+// The assets are keyed by the path of their source file relative to the asset directory.
+// KTX 2.0 textures are baked to RGBA8 images (see TextureHeader), glTF models to binary glTF with embedded buffers.
+// The other assets, including Basis Universal and block-compressed textures, are stored as is.
+class Archive
+{
+  public:
+    // archive magic number ("LSAR")
+    static constexpr uint32_t magic{0x5241534C};
+    // archive version
+    static constexpr uint32_t version{1};
+    // blob alignment
+    static constexpr uint64_t blobAlignment{256};
+
+    // archive header
+    struct Header
+    {
+        // magic number
+        uint32_t magic;
+        // version
+        uint32_t version;
+        // table of contents entry count
+        uint32_t entryCount;
+        // reserved for alignment
+        uint32_t reserved;
+    };
+
+    // table of contents entry
+    struct Entry
+    {
+        // asset key (null-terminated)
+        char key[112];
+        // blob offset relative to the archive start
+        uint64_t offset;
+        // blob size
+        uint64_t size;
+    };
+
+    // baked texture header
+    // The header is followed by the RGBA8 images of the texture, ordered by face and then by mip level.
+    struct TextureHeader
+    {
+        // texture width
+        uint32_t width;
+        // texture height
+        uint32_t height;
+        // face count
+        uint32_t faceCount;
+        // mip level count
+        uint32_t levelCount;
+    };
+
+    // input stream reading an asset blob in place
+    class Stream : private std::streambuf, public std::istream
+    {
+      public:
+        // Construct the Stream object given the asset blob.
+        explicit Stream(const Data& blob);
+
+      protected:
+        std::streampos seekoff(std::streamoff offset, std::ios_base::seekdir direction,
+                               std::ios_base::openmode mode) override;
+        std::streampos seekpos(std::streampos position, std::ios_base::openmode mode) override;
+    };
+
+  private:
+    // mapped archive file
+    MappedFile file;
+    // asset key => asset blob
+    std::unordered_map<std::string, Data> blobs;
+
+  public:
+    // Construct an empty Archive object.
+    Archive() = default;
+    // Construct the Archive object given the path of the archive file.
+    // The archive is left empty if the file does not exist or is not a valid archive.
+    explicit Archive(const std::filesystem::path& path);
+    Archive(const Archive&) = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    // Return the key of the asset with the given source path.
+    static std::string key(const std::filesystem::path& path);
+    // Return the blob of the asset with the given source path. Return an empty blob if it is not archived.
+    // The blob is mapped copy-on-write, so it can be modified in place without affecting the archive file.
+    Data find(const std::filesystem::path& path) const;
+    // Return the archive of the demo assets, mapped on first use.
+    static const Archive& assets();
+};
\ No newline at end of file
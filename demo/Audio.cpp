@@ -1,6 +1,8 @@
 #include "Audio.h"
 
+#include "Archive.h"
 #include "Engine.h"
+#include "Profiler.h"
 #include <thread>
 
 using namespace SoLoud;
@@ -8,15 +10,19 @@ using namespace SoLoud;
 Audio::Audio(Engine& engine)
     : engine(engine)
 {
+    Profiler::Scope scope("initialize audio");
     soloud.init();
+    // Only the intro music is loaded up front, the other music is streamed while the intro plays.
     load("intro");
-    load("main");
-    load("finale");
-    load("credits");
+    stream({"main", "finale", "credits"});
 }
 
 Audio::~Audio()
 {
+    if (streaming.valid())
+    {
+        streaming.wait();
+    }
     soloud.fadeGlobalVolume(0.0f, 0.4f);
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
     soloud.deinit();
@@ -24,19 +30,82 @@ Audio::~Audio()
 
 void Audio::load(const std::string& name, const std::string& extension)
 {
+    Profiler::Scope scope("load sound", name);
     const std::string path = soundPath(name, extension).string();
     sounds[name] = Wav();
-    sounds[name].load(path.data());
+    if (const Data blob = Archive::assets().find(path); blob.data)
+    {
+        // The sound is decoded from the archive in place.
+        sounds[name].loadMem(static_cast<const unsigned char*>(blob.data), static_cast<unsigned int>(blob.size), false,
+                             false);
+    }
+    else
+    {
+        sounds[name].load(path.data());
+    }
+}
+
+void Audio::stream(const std::vector<std::string>& names, const std::string& extension)
+{
+    // Insert the sounds up front, so that the background thread does not modify the sound map.
+    for (const std::string& name : names)
+    {
+        sounds[name];
+        streamedSounds.emplace(name);
+    }
+    streaming = std::async(std::launch::async, [this, names, extension]() {
+        for (const std::string& name : names)
+        {
+            load(name, extension);
+        }
+    });
+}
+
+bool Audio::isStreamed()
+{
+    if (streaming.valid() && streaming.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        streaming.get();
+    }
+    return !streaming.valid();
+}
+
+void Audio::waitStreaming()
+{
+    if (streaming.valid())
+    {
+        streaming.get();
+    }
+}
+
+void Audio::update()
+{
+    if (!deferredQueue.empty() && isStreamed())
+    {
+        for (const std::string& name : deferredQueue)
+        {
+            queue.play(sounds[name]);
+        }
+        deferredQueue.clear();
+    }
 }
 
 void Audio::play(const std::string& name)
 {
+    if (streamedSounds.contains(name))
+    {
+        waitStreaming();
+    }
     Wav& sound = sounds[name];
     soloud.play(sound);
 }
 
 void Audio::startQueue(const std::string& name)
 {
+    if (streamedSounds.contains(name))
+    {
+        waitStreaming();
+    }
     Wav& sound = sounds[name];
     queue.setParamsFromAudioSource(sound);
     soloud.play(queue);
@@ -45,12 +114,19 @@ void Audio::startQueue(const std::string& name)
 
 void Audio::extendQueue(const std::string& name)
 {
+    // Defer the sound while it is streamed, so that the queue is extended without blocking the game loop.
+    if (!deferredQueue.empty() || (streamedSounds.contains(name) && !isStreamed()))
+    {
+        deferredQueue.emplace_back(name);
+        return;
+    }
     Wav& sound = sounds[name];
     queue.play(sound);
 }
 
 void Audio::stopQueue()
 {
+    deferredQueue.clear();
     soloud.fadeVolume(queue.mQueueHandle, 0.0f, 1.0f);
     soloud.scheduleStop(queue.mQueueHandle, 1.0f);
 }
\ No newline at end of file
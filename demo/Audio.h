@@ -1,9 +1,12 @@
 #pragma once
 
+#include <future>
 #include <soloud.h>
 #include <soloud_wav.h>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 class Engine;
 
@@ -19,6 +22,12 @@ class Audio
     std::unordered_map<std::string, SoLoud::Wav> sounds;
     // sound queue
     SoLoud::Queue queue;
+    // names of the streamed sounds
+    std::unordered_set<std::string> streamedSounds;
+    // sounds to extend the queue with once they are streamed
+    std::vector<std::string> deferredQueue;
+    // background loading of the streamed sounds
+    std::future<void> streaming;
 
   public:
     // Construct the Audio object given the engine.
@@ -27,6 +36,14 @@ class Audio
     ~Audio();
     // Load a sound.
     void load(const std::string& name, const std::string& extension = "mp3");
+    // Load the specified sounds on a background thread.
+    void stream(const std::vector<std::string>& names, const std::string& extension = "mp3");
+    // Return true if the streamed sounds are loaded. Return false otherwise.
+    bool isStreamed();
+    // Wait for the streamed sounds to be loaded.
+    void waitStreaming();
+    // Extend the queue with the deferred sounds once they are streamed.
+    void update();
     // Play the specified sound.
     void play(const std::string& name);
     // Start the queue with the specified sound.
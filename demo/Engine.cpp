@@ -1,5 +1,7 @@
 #include "Engine.h"
 
+#include "Profiler.h"
+
 namespace chrono = std::chrono;
 
 Engine::Engine(Demo& demo)
@@ -30,6 +32,7 @@ void Engine::runApplication()
     constexpr auto timeStep = chrono::duration_cast<chrono::steady_clock::duration>(
         chrono::duration<float, chrono::seconds::period>(deltaTime));
     uint32_t updateCount;
+    bool firstFrame = true;
     while (!glfw.windowShouldClose())
     {
         updateCount = 0;
@@ -84,9 +87,18 @@ void Engine::runApplication()
             updateCount++;
         }
 
+        // Extend the music queue with the streamed music.
+        audio.update();
+
         // Display the game.
         gui.create();
         vulkan.render();
+        if (firstFrame)
+        {
+            // Finish the startup profile at the first frame.
+            Profiler::startup().finish();
+            firstFrame = false;
+        }
 
         if (state == State::Credits && stateTime >= 160.0f)
         {
@@ -1,12 +1,14 @@
 #include "GLFW.h"
 
 #include "Demo.h"
+#include "Profiler.h"
 #include <imgui_impl_glfw.h>
 
 GLFW::GLFW(Engine& engine)
     : engine(engine),
       title(engine.demo.name)
 {
+    Profiler::Scope scope("initialize GLFW");
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     glfwWindowHint(GLFW_MAXIMIZED, GLFW_TRUE);
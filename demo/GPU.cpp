@@ -123,7 +123,11 @@ GPU GPU::select(const vk::Instance& instance, const vk::SurfaceKHR& surface,
         }
 
         // Query device properties and store the candidate GPU.
-        gpu.properties = device.getProperties();
+        PhysicalDeviceProperties2 properties2{
+            .pNext = &gpu.subgroupProperties,
+        };
+        device.getProperties2(&properties2);
+        gpu.properties = properties2.properties;
         gpu.name = std::string(gpu.properties.deviceName.begin(), gpu.properties.deviceName.end());
         gpu.vram = 0;
         if (gpu.properties.deviceType == PhysicalDeviceType::eDiscreteGpu)
@@ -235,6 +239,21 @@ vk::Format GPU::selectFormat(const std::vector<vk::Format>& candidates, vk::Imag
     throw std::runtime_error("Failed to find a supported format");
 }
 
+bool GPU::supportsFormats(const std::vector<vk::Format>& formats, vk::ImageTiling tiling,
+                          vk::FormatFeatureFlags features)
+{
+    for (const Format& format : formats)
+    {
+        FormatProperties formatProperties = device.getFormatProperties(format);
+        if (!((tiling == ImageTiling::eLinear && (features & formatProperties.linearTilingFeatures) == features) ||
+              (tiling == ImageTiling::eOptimal && (features & formatProperties.optimalTilingFeatures) == features)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 vk::Format GPU::selectDepthFormat()
 {
     return selectFormat({Format::eD32Sfloat, Format::eD32SfloatS8Uint}, ImageTiling::eOptimal,
@@ -333,4 +352,17 @@ WorkgroupDimensions GPU::selectWorkgroupDimensions(uint32_t invocationCount, uin
     }
 
     return workgroup;
+}
+
+bool GPU::supportsWaveOps(uint32_t groupSize)
+{
+    constexpr SubgroupFeatureFlags requiredOperations = SubgroupFeatureFlagBits::eBasic |
+                                                        SubgroupFeatureFlagBits::eVote |
+                                                        SubgroupFeatureFlagBits::eArithmetic |
+                                                        SubgroupFeatureFlagBits::eBallot |
+                                                        SubgroupFeatureFlagBits::eShuffle;
+    // The workgroups must consist of full waves, so that all lanes of a wave are active.
+    return (subgroupProperties.supportedStages & ShaderStageFlagBits::eCompute) &&
+           (subgroupProperties.supportedOperations & requiredOperations) == requiredOperations &&
+           subgroupProperties.subgroupSize > 0 && groupSize % subgroupProperties.subgroupSize == 0;
 }
\ No newline at end of file
@@ -16,6 +16,8 @@ struct GPU
     vk::PhysicalDevice device;
     // physical device properties
     vk::PhysicalDeviceProperties properties;
+    // physical device subgroup properties
+    vk::PhysicalDeviceSubgroupProperties subgroupProperties;
     // index of the graphics queue family
     uint32_t graphicsQueueFamilyIndex{-1u};
     // index of the compute queue family
@@ -49,6 +51,9 @@ struct GPU
     // Select the first supported format in a list of candidates.
     vk::Format selectFormat(const std::vector<vk::Format>& candidates, vk::ImageTiling tiling,
                             vk::FormatFeatureFlags features);
+    // Return true if all of the given formats are supported. Return false otherwise.
+    bool supportsFormats(const std::vector<vk::Format>& formats, vk::ImageTiling tiling,
+                         vk::FormatFeatureFlags features);
     // Select the format for depth textures.
     vk::Format selectDepthFormat();
     // Select the sample count for MSAA.
@@ -67,4 +72,7 @@ struct GPU
     // and shared size per invocation.
     WorkgroupDimensions selectWorkgroupDimensions(uint32_t invocationCount, uint32_t desiredGroupSize,
                                                   uint32_t sharedSizePerInvocation);
+    // Return true if compute shaders with the given group size can use wave (subgroup) operations.
+    // Return false otherwise.
+    bool supportsWaveOps(uint32_t groupSize);
 };
@@ -1,6 +1,8 @@
 #include "GUI.h"
 
+#include "Archive.h"
 #include "Engine.h"
+#include "Profiler.h"
 #include "Utils.h"
 #include <imgui_impl_glfw.h>
 
@@ -14,6 +16,7 @@ ImGuiIO& GUI::IO()
 GUI::GUI(Engine& engine)
     : engine(engine)
 {
+    Profiler::Scope scope("initialize GUI");
     const std::string regularFontPath = fontPath("Caveat", "Regular").string();
     const std::string boldFontPath = fontPath("Caveat", "Bold").string();
 
@@ -22,10 +25,20 @@ GUI::GUI(Engine& engine)
     ImGuiIO& io = IO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;
-    titleFont = io.Fonts->AddFontFromFileTTF(boldFontPath.data(), 128.0f);
-    headingFont = io.Fonts->AddFontFromFileTTF(boldFontPath.data(), 64.0f);
-    textFont = io.Fonts->AddFontFromFileTTF(regularFontPath.data(), 64.0f);
-    descriptionFont = io.Fonts->AddFontFromFileTTF(regularFontPath.data(), 32.0f);
+    // Add the archived fonts in place, the atlas must not free them.
+    const auto addFont = [&](const std::string& path, float size) -> ImFont* {
+        if (const Data blob = Archive::assets().find(path); blob.data)
+        {
+            ImFontConfig config;
+            config.FontDataOwnedByAtlas = false;
+            return io.Fonts->AddFontFromMemoryTTF(blob.data, static_cast<int>(blob.size), size, &config);
+        }
+        return io.Fonts->AddFontFromFileTTF(path.data(), size);
+    };
+    titleFont = addFont(boldFontPath, 128.0f);
+    headingFont = addFont(boldFontPath, 64.0f);
+    textFont = addFont(regularFontPath, 64.0f);
+    descriptionFont = addFont(regularFontPath, 32.0f);
     StyleColorsDark();
     engine.glfw.initializeGuiWindow();
     io.BackendRendererName = "Vulkan";
@@ -35,6 +48,7 @@ GUI::GUI(Engine& engine)
 
 ImageData GUI::fontTexture()
 {
+    Profiler::Scope scope("build font atlas");
     ImGuiIO& io = IO();
     ImageData fontTexture{};
     io.Fonts->GetTexDataAsRGBA32(reinterpret_cast<uint8_t**>(&fontTexture.data), &fontTexture.width,
@@ -1,5 +1,6 @@
 #include "Image.h"
 
+#include "Archive.h"
 #include "Utils.h"
 #include <ktx.h>
 
@@ -66,42 +67,110 @@ std::vector<std::vector<ImageData>> ImageData::loadTextureCubemap(const std::str
     return texture;
 }
 
-std::vector<std::vector<ImageData>> ImageData::loadKhronosTexture(const std::string& name, const std::string& model)
+// Read the Khronos texture into the memory reserved by the given function.
+// Basis Universal textures are transcoded to the given block compression. The texture is destroyed afterwards.
+static TextureLayout readTexture(ktxTexture* texture, TextureCompression compression, const std::string& source,
+                                 const std::function<uint8_t*(size_t)>& reserve)
 {
-    std::vector<std::vector<ImageData>> data;
-    const std::string path =
-        (model.empty() ? texturePath(name, "ktx2") : modelTexturePath(model, name, "ktx2")).string();
-    ktxTexture* texture;
-    if (ktxTexture_CreateFromNamedFile(path.data(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture) != KTX_SUCCESS)
+    // Transcode the texture to the block compression format matching its component count.
+    // Without block compression, it is transcoded to RGBA8.
+    if (texture->classId == ktxTexture2_c && ktxTexture2_NeedsTranscoding(reinterpret_cast<ktxTexture2*>(texture)))
     {
-        throw std::runtime_error("Failed to load texture [" + name + "]" +
-                                 (model.empty() ? "" : (" of model [" + model + "]")));
+        ktxTexture2* texture2 = reinterpret_cast<ktxTexture2*>(texture);
+        const uint32_t componentCount = ktxTexture2_GetNumComponents(texture2);
+        ktx_transcode_fmt_e format;
+        switch (compression)
+        {
+        case TextureCompression::BC:
+            format = (componentCount == 1)   ? KTX_TTF_BC4_R
+                     : (componentCount == 2) ? KTX_TTF_BC5_RG
+                                             : KTX_TTF_BC7_RGBA;
+            break;
+        case TextureCompression::ETC2:
+            format = (componentCount == 1)   ? KTX_TTF_ETC2_EAC_R11
+                     : (componentCount == 2) ? KTX_TTF_ETC2_EAC_RG11
+                                             : KTX_TTF_ETC2_RGBA;
+            break;
+        default:
+            format = KTX_TTF_RGBA32;
+        }
+        if (ktxTexture_LoadImageData(texture, nullptr, 0) != KTX_SUCCESS ||
+            ktxTexture2_TranscodeBasis(texture2, format, 0) != KTX_SUCCESS)
+        {
+            ktxTexture_Destroy(texture);
+            throw std::runtime_error("Failed to transcode texture from " + source);
+        }
+    }
+    if (texture->isCompressed && texture->classId != ktxTexture2_c)
+    {
+        ktxTexture_Destroy(texture);
+        throw std::runtime_error("Failed to load texture from " + source + ": unsupported format");
     }
-    size_t offset;
-    uint8_t* src = ktxTexture_GetData(texture);
+
+    TextureLayout layout{
+        .width = static_cast<int>(texture->baseWidth),
+        .height = static_cast<int>(texture->baseHeight),
+    };
+    layout.offsets.resize(texture->numFaces, std::vector<size_t>(texture->numLevels));
+    const uint32_t channels = ImageData::channels;
     const uint32_t elementSize = ktxTexture_GetElementSize(texture);
-    data.reserve(texture->numFaces);
-    for (uint32_t face = 0; face < texture->numFaces; face++)
-    {
-        int width = texture->baseWidth;
-        int height = texture->baseHeight;
-        data.emplace_back(std::vector<ImageData>{});
-        data[face].reserve(texture->numLevels);
-        for (uint32_t mipLevel = 0; mipLevel < texture->numLevels; mipLevel++)
+    if (texture->isCompressed || elementSize >= channels)
+    {
+        // Read the images as is. Unless they are already transcoded, they are loaded straight into the memory.
+        if (texture->isCompressed)
+        {
+            layout.format = static_cast<vk::Format>(reinterpret_cast<ktxTexture2*>(texture)->vkFormat);
+        }
+        const size_t size = ktxTexture_GetDataSizeUncompressed(texture);
+        uint8_t* dst = reserve(size);
+        if (texture->pData)
+        {
+            memcpy(dst, texture->pData, size);
+        }
+        else if (ktxTexture_LoadImageData(texture, dst, size) != KTX_SUCCESS)
         {
-            data[face].emplace_back(ImageData{
-                Data::allocate(width * height * channels),
-                width,
-                height,
-            });
-            ktxTexture_GetImageOffset(texture, mipLevel, 0, face, &offset);
-            if (elementSize < channels)
+            ktxTexture_Destroy(texture);
+            throw std::runtime_error("Failed to load texture from " + source);
+        }
+        for (uint32_t face = 0; face < texture->numFaces; face++)
+        {
+            for (uint32_t mipLevel = 0; mipLevel < texture->numLevels; mipLevel++)
+            {
+                ktxTexture_GetImageOffset(texture, mipLevel, 0, face, &layout.offsets[face][mipLevel]);
+            }
+        }
+    }
+    else
+    {
+        // Extend the elements to four channels while copying them into the memory, ordered by face and mip level.
+        if (ktxTexture_LoadImageData(texture, nullptr, 0) != KTX_SUCCESS)
+        {
+            ktxTexture_Destroy(texture);
+            throw std::runtime_error("Failed to load texture from " + source);
+        }
+        size_t size = 0;
+        for (uint32_t face = 0; face < texture->numFaces; face++)
+        {
+            for (uint32_t mipLevel = 0; mipLevel < texture->numLevels; mipLevel++)
             {
-                uint8_t* dst = static_cast<uint8_t*>(data[face][mipLevel]());
-                for (uint32_t element = 0; element < width * height; element++)
+                layout.offsets[face][mipLevel] = size;
+                size += std::max(layout.width >> mipLevel, 1) * std::max(layout.height >> mipLevel, 1) * channels;
+            }
+        }
+        uint8_t* const memory = reserve(size);
+        const uint8_t* const src = ktxTexture_GetData(texture);
+        size_t offset;
+        for (uint32_t face = 0; face < texture->numFaces; face++)
+        {
+            for (uint32_t mipLevel = 0; mipLevel < texture->numLevels; mipLevel++)
+            {
+                const uint32_t elementCount =
+                    std::max(layout.width >> mipLevel, 1) * std::max(layout.height >> mipLevel, 1);
+                uint8_t* dst = memory + layout.offsets[face][mipLevel];
+                ktxTexture_GetImageOffset(texture, mipLevel, 0, face, &offset);
+                for (uint32_t element = 0; element < elementCount; element++)
                 {
                     memcpy(dst, src + offset, elementSize);
-                    // Extend the element to four channels.
                     for (uint32_t channel = elementSize; channel < 3; channel++)
                     {
                         dst[channel] = 0;
@@ -111,19 +180,70 @@ std::vector<std::vector<ImageData>> ImageData::loadKhronosTexture(const std::str
                     offset += elementSize;
                 }
             }
-            else
-            {
-                ImageData& dst = data[face][mipLevel];
-                memcpy(dst(), src + offset, dst.size);
-            }
-            if (width >= 2)
-                width /= 2;
-            if (height >= 2)
-                height /= 2;
         }
     }
     ktxTexture_Destroy(texture);
-    return data;
+    return layout;
+}
+
+TextureLayout ImageData::readKhronosTexture(const std::string& name, const std::string& model,
+                                            TextureCompression compression,
+                                            const std::function<uint8_t*(size_t)>& reserve)
+{
+    const fs::path path = model.empty() ? texturePath(name, "ktx2") : modelTexturePath(model, name, "ktx2");
+    const Data blob = Archive::assets().find(path);
+    if (!blob.data)
+    {
+        return readKhronosTexture(path, compression, reserve);
+    }
+
+    // Basis Universal textures are archived as is, since they are transcoded for the GPU.
+    constexpr std::array<uint8_t, 12> identifier{0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    if (blob.size >= identifier.size() && memcmp(blob.data, identifier.data(), identifier.size()) == 0)
+    {
+        ktxTexture* texture;
+        if (ktxTexture_CreateFromMemory(static_cast<const ktx_uint8_t*>(blob.data), blob.size,
+                                        KTX_TEXTURE_CREATE_NO_FLAGS, &texture) != KTX_SUCCESS)
+        {
+            throw std::runtime_error("Failed to load texture from the asset archive");
+        }
+        return readTexture(texture, compression, "the asset archive", reserve);
+    }
+
+    // Copy the baked images into the memory.
+    const Archive::TextureHeader& header = *static_cast<const Archive::TextureHeader*>(blob.data);
+    TextureLayout layout{
+        .width = static_cast<int>(header.width),
+        .height = static_cast<int>(header.height),
+    };
+    layout.offsets.resize(header.faceCount, std::vector<size_t>(header.levelCount));
+    size_t size = 0;
+    for (uint32_t face = 0; face < header.faceCount; face++)
+    {
+        for (uint32_t mipLevel = 0; mipLevel < header.levelCount; mipLevel++)
+        {
+            layout.offsets[face][mipLevel] = size;
+            size += std::max(layout.width >> mipLevel, 1) * std::max(layout.height >> mipLevel, 1) * channels;
+        }
+    }
+    if (sizeof(Archive::TextureHeader) + size > blob.size)
+    {
+        throw std::runtime_error("Failed to load texture [" + name + "]" +
+                                 (model.empty() ? "" : (" of model [" + model + "]")) + " from the asset archive");
+    }
+    memcpy(reserve(size), static_cast<uint8_t*>(blob.data) + sizeof(Archive::TextureHeader), size);
+    return layout;
+}
+
+TextureLayout ImageData::readKhronosTexture(const fs::path& path, TextureCompression compression,
+                                            const std::function<uint8_t*(size_t)>& reserve)
+{
+    ktxTexture* texture;
+    if (ktxTexture_CreateFromNamedFile(path.string().data(), KTX_TEXTURE_CREATE_NO_FLAGS, &texture) != KTX_SUCCESS)
+    {
+        throw std::runtime_error("Failed to load texture from " + path.string());
+    }
+    return readTexture(texture, compression, path.string(), reserve);
 }
 
 bool ImageData::isMipmapped(const std::string& name, const std::string& extension, const std::string& layer,
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Data.h"
+#include <filesystem>
+#include <functional>
 #include <stb_image.h>
 #include <vk_mem_alloc.hpp>
 
@@ -8,6 +10,30 @@
 #undef max
 #endif
 
+// block compression of transcoded textures
+enum struct TextureCompression
+{
+    // 8-bit RGBA
+    none,
+    // BC4, BC5, or BC7
+    BC,
+    // EAC or ETC2
+    ETC2,
+};
+
+// layout of the texture images read into contiguous memory
+struct TextureLayout
+{
+    // base image width
+    int width{1};
+    // base image height
+    int height{1};
+    // image format (undefined for 8-bit RGBA, see textureFormat)
+    vk::Format format{};
+    // image offsets relative to the memory start, indexed by face and mip level
+    std::vector<std::vector<size_t>> offsets;
+};
+
 // image data
 struct ImageData : Data
 {
@@ -15,6 +41,8 @@ struct ImageData : Data
     int width{1};
     // image height
     int height{1};
+    // image format (undefined for 8-bit RGBA, see textureFormat)
+    vk::Format format{};
     // image channel count
     static const int channels{STBI_rgb_alpha};
 
@@ -31,9 +59,16 @@ struct ImageData : Data
     // Load a texture cubemap.
     static std::vector<std::vector<ImageData>> loadTextureCubemap(const std::string& name,
                                                                   const std::string& extension = "png");
-    // Load a Khronos texture (KTX 2.0).
-    static std::vector<std::vector<ImageData>> loadKhronosTexture(const std::string& name,
-                                                                  const std::string& model = {});
+    // Read a Khronos texture (KTX 2.0) into the memory reserved by the given function, which is called once.
+    // Use the baked images of the asset archive if the texture is archived.
+    // Basis Universal textures are transcoded to the given block compression, the others are read as RGBA8.
+    static TextureLayout readKhronosTexture(const std::string& name, const std::string& model,
+                                            TextureCompression compression,
+                                            const std::function<uint8_t*(size_t)>& reserve);
+    // Read the specified Khronos texture (KTX 2.0) file into the memory reserved by the given function.
+    // Basis Universal textures are transcoded to the given block compression, the others are read as RGBA8.
+    static TextureLayout readKhronosTexture(const std::filesystem::path& path, TextureCompression compression,
+                                            const std::function<uint8_t*(size_t)>& reserve);
     // Return true if the specified texture is mipmapped. Return false otherwise.
     // Optionally get the mip level count.
     static bool isMipmapped(const std::string& name, const std::string& extension = "png",
@@ -0,0 +1,76 @@
+#include "MappedFile.h"
+
+#include "Utils.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+MappedFile::MappedFile(const fs::path& path)
+{
+#ifdef _WIN32
+    const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                    FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+    {
+        fileMapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (fileMapping)
+        {
+            mapping = MapViewOfFile(fileMapping, FILE_MAP_COPY, 0, 0, 0);
+            mappingSize = static_cast<size_t>(fileSize.QuadPart);
+        }
+    }
+    CloseHandle(file);
+#else
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return;
+    }
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size > 0)
+    {
+        mapping = mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        if (mapping == MAP_FAILED)
+        {
+            mapping = {};
+        }
+        else
+        {
+            mappingSize = static_cast<size_t>(status.st_size);
+            // The file is mostly read front to back.
+            madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+        }
+    }
+    close(file);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (mapping)
+    {
+        UnmapViewOfFile(mapping);
+    }
+    if (fileMapping)
+    {
+        CloseHandle(fileMapping);
+    }
+#else
+    if (mapping)
+    {
+        munmap(mapping, mappingSize);
+    }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Data.h"
+#include <filesystem>
+
+// file mapped copy-on-write into memory
+class MappedFile
+{
+  private:
+    // mapped file
+    void* mapping{};
+    // mapped file size
+    size_t mappingSize{};
+#ifdef _WIN32
+    // file mapping handle
+    void* fileMapping{};
+#endif
+
+  public:
+    // Construct an empty MappedFile object.
+    MappedFile() = default;
+    // Construct the MappedFile object given the path of the file to map.
+    // The mapping is left empty if the file does not exist or cannot be mapped.
+    explicit MappedFile(const std::filesystem::path& path);
+    // Destruct the MappedFile object.
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Return the mapped data. Modifying it does not affect the file.
+    Data data() const
+    {
+        return Data{
+            .data = mapping,
+            .size = mappingSize,
+        };
+    }
+};
\ No newline at end of file
@@ -322,6 +322,16 @@ template <uint32_t frameCount> struct Model
     Animation* activeAnimation{};
     // animation blend value
     float animationBlend{};
+    // residency state
+    // The model is rendered once resident, i.e. once the uploads of its textures and meshes are complete.
+    enum struct Residency
+    {
+        loading,
+        uploading,
+        resident,
+    } residency{Residency::loading};
+    // upload timeline value signaled once the uploads of the model are complete
+    uint64_t uploadValue{};
     // node name => node index
     std::unordered_map<std::string, uint32_t> nodeNamesToIndices;
     // material name => material index
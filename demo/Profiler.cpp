@@ -0,0 +1,169 @@
+#include "Profiler.h"
+
+#include "Utils.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace chrono = std::chrono;
+namespace fs = std::filesystem;
+
+// Start the startup profiler before main, so that the profile covers the static initialization.
+[[maybe_unused]] static const Profiler& startupProfiler = Profiler::startup();
+
+Profiler::Scope::Scope(std::string name, std::string asset)
+    : index(startup().begin(std::move(name), std::move(asset)))
+{
+}
+
+Profiler::Scope::~Scope()
+{
+    stop();
+}
+
+void Profiler::Scope::stop()
+{
+    if (index != npos)
+    {
+        startup().end(index);
+        index = npos;
+    }
+}
+
+size_t Profiler::begin(std::string&& name, std::string&& asset)
+{
+    const Clock::time_point now = Clock::now();
+    std::lock_guard lock(mutex);
+    if (finished)
+    {
+        return npos;
+    }
+    const auto thread =
+        threads.try_emplace(std::this_thread::get_id(), static_cast<uint32_t>(threads.size())).first->second;
+    phases.emplace_back(Phase{
+        .name = std::move(name),
+        .asset = std::move(asset),
+        .thread = thread,
+        .depth = depth++,
+        .start = now,
+    });
+    return phases.size() - 1;
+}
+
+void Profiler::end(size_t index)
+{
+    const Clock::time_point now = Clock::now();
+    std::lock_guard lock(mutex);
+    depth--;
+    if (!finished)
+    {
+        phases[index].end = now;
+    }
+}
+
+Profiler& Profiler::startup()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::finish()
+{
+    const Clock::time_point now = Clock::now();
+    std::lock_guard lock(mutex);
+    if (finished)
+    {
+        return;
+    }
+    finished = true;
+
+    const auto milliseconds = [](Clock::duration duration) -> double {
+        return chrono::duration<double, std::milli>(duration).count();
+    };
+    const auto microseconds = [](Clock::duration duration) -> double {
+        return chrono::duration<double, std::micro>(duration).count();
+    };
+
+    // Tabulate the phases in start order, indented by their nesting depth,
+    // and the total time per phase, so that a regression can be attributed to a phase and then to an asset.
+    std::ostringstream table;
+    table << std::fixed << std::setprecision(1);
+    table << "Startup profile: " << milliseconds(now - start) << " ms until the first frame\n";
+    table << std::setw(10) << "start ms" << std::setw(10) << "time ms" << std::setw(8) << "thread"
+          << "  phase [asset]\n";
+    // phase name => total time, phase count
+    std::map<std::string, std::pair<Clock::duration, uint32_t>> totals;
+    for (const Phase& phase : phases)
+    {
+        if (phase.end == Clock::time_point{})
+        {
+            continue;
+        }
+        table << std::setw(10) << milliseconds(phase.start - start) << std::setw(10)
+              << milliseconds(phase.end - phase.start) << std::setw(8) << phase.thread << "  "
+              << std::string(2 * phase.depth, ' ') << phase.name
+              << (phase.asset.empty() ? "" : " [" + phase.asset + "]") << "\n";
+        auto& [time, count] = totals[phase.name];
+        time += phase.end - phase.start;
+        count++;
+    }
+    std::vector<std::pair<std::string, std::pair<Clock::duration, uint32_t>>> sortedTotals(totals.begin(),
+                                                                                          totals.end());
+    std::sort(sortedTotals.begin(), sortedTotals.end(),
+              [](const auto& a, const auto& b) -> bool { return a.second.first > b.second.first; });
+    table << std::setw(10) << "count" << std::setw(10) << "time ms" << "  phase (total over assets and threads)\n";
+    for (const auto& [name, total] : sortedTotals)
+    {
+        table << std::setw(10) << total.second << std::setw(10) << milliseconds(total.first) << "  " << name << "\n";
+    }
+
+    // Write the trace file, naming the threads and recording each phase as a complete event.
+    // The profile is diagnostic, so a failure to write the trace is reported without failing the demo.
+    const auto escape = [](const std::string& string) -> std::string {
+        std::string escaped;
+        for (char c : string)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    };
+    const fs::path path = profilePath("startup");
+    std::error_code error;
+    fs::create_directories(path.parent_path(), error);
+    std::ofstream file(path);
+    file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (uint32_t thread = 0; thread < threads.size(); thread++)
+    {
+        file << (thread == 0 ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread
+             << ",\"args\":{\"name\":\"" << (thread == 0 ? "main" : "worker " + std::to_string(thread)) << "\"}}";
+    }
+    for (const Phase& phase : phases)
+    {
+        if (phase.end == Clock::time_point{})
+        {
+            continue;
+        }
+        file << ",\n{\"name\":\"" << escape(phase.name) << "\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+             << phase.thread << ",\"ts\":" << microseconds(phase.start - start)
+             << ",\"dur\":" << microseconds(phase.end - phase.start) << ",\"args\":{\"asset\":\""
+             << escape(phase.asset) << "\"}}";
+    }
+    file << "\n]}\n";
+    file.close();
+    if (file.good())
+    {
+        table << "Startup trace written to " << path.string() << "\n";
+    }
+    else
+    {
+        table << "Failed to write startup trace to " << path.string() << "\n";
+    }
+    std::cout << table.str() << std::flush;
+}
\ No newline at end of file
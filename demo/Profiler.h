@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// startup profiler
+// Scoped timers measure the phases between the process start and the first frame on all threads.
+// The phases nest per thread and can be tagged with the asset they process, e.g. the model, texture, or shader.
+// At the first frame, the profile is finished: a summary table is printed and a trace file is written (see finish).
+class Profiler
+{
+  public:
+    // profiler clock
+    using Clock = std::chrono::steady_clock;
+
+    // scoped timer, measuring a phase from its construction to its destruction
+    class Scope
+    {
+      private:
+        // index of the timed phase, or npos if the timer is stopped
+        size_t index;
+
+      public:
+        // Start the timer of the phase with the given name, optionally tagged with the processed asset.
+        explicit Scope(std::string name, std::string asset = {});
+        // Stop the timer.
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        // Stop the timer before the end of the scope, so that consecutive phases can be timed in one scope.
+        void stop();
+    };
+
+  private:
+    // index of no phase
+    static constexpr size_t npos{std::numeric_limits<size_t>::max()};
+
+    // timed phase
+    struct Phase
+    {
+        // phase name
+        std::string name;
+        // processed asset (empty if untagged)
+        std::string asset;
+        // index of the thread in order of the first timed phase
+        uint32_t thread;
+        // nesting depth on the thread
+        uint32_t depth;
+        // start time
+        Clock::time_point start;
+        // end time (epoch while running)
+        Clock::time_point end{};
+    };
+
+    // profile start
+    const Clock::time_point start{Clock::now()};
+    // mutex of the phases, the threads, and the finished flag
+    std::mutex mutex;
+    // timed phases in start order
+    std::vector<Phase> phases;
+    // thread ID => thread index
+    std::unordered_map<std::thread::id, uint32_t> threads;
+    // Is the profile finished?
+    bool finished{};
+    // nesting depth of the running phases on the current thread
+    static inline thread_local uint32_t depth{};
+
+    // Construct the Profiler object.
+    Profiler() = default;
+
+    // Start timing a phase. Return the index of the phase, or npos if the profile is finished.
+    size_t begin(std::string&& name, std::string&& asset);
+    // Stop timing the phase with the given index.
+    void end(size_t index);
+
+  public:
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Return the startup profiler, which is started before main.
+    static Profiler& startup();
+    // Finish the profile, print the summary table and write the trace file (see profilePath).
+    // The table lists the phases in start order and the total time per phase, summed over the assets and threads.
+    // The trace is written in the Trace Event Format, so that it can be opened in Perfetto or chrome://tracing.
+    // Phases still running are left out, and phases started afterwards are not timed. Subsequent calls have no effect.
+    void finish();
+};
\ No newline at end of file
@@ -1,8 +1,13 @@
 #include "Shader.h"
 
+#include "Profiler.h"
 #include <codecvt>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <regex>
+#include <sstream>
+#include <thread>
 
 namespace fs = std::filesystem;
 using namespace std;
@@ -103,26 +108,124 @@ std::string Shader::stageSuffix() const
 
 ShaderCompiler::ShaderCompiler()
 {
-    status = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils));
+    instances.emplace_back(createInstance());
+
+    // Get the DXC version for the cache keys, so that a compiler update invalidates the cached shaders.
+    CComPtr<IDxcVersionInfo> versionInfo{};
+    HRESULT status = instances[0]->compiler->QueryInterface(IID_PPV_ARGS(&versionInfo));
+    if (FAILED(status) || FAILED(versionInfo->GetVersion(&dxcVersion.major, &dxcVersion.minor)))
+    {
+        throw runtime_error("Failed to get DXC version");
+    }
+    CComPtr<IDxcVersionInfo2> versionInfo2{};
+    char* commitHash{};
+    if (SUCCEEDED(versionInfo->QueryInterface(IID_PPV_ARGS(&versionInfo2))) &&
+        SUCCEEDED(versionInfo2->GetCommitInfo(&dxcVersion.patch, &commitHash)))
+    {
+        CoTaskMemFree(commitHash);
+    }
+}
+
+std::unique_ptr<ShaderCompiler::Instance> ShaderCompiler::createInstance()
+{
+    auto instance = make_unique<Instance>();
+    HRESULT status = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&instance->utils));
     if (FAILED(status))
     {
         throw runtime_error("Failed to create DXC utils");
     }
 
-    status = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
+    status = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&instance->compiler));
     if (FAILED(status))
     {
         throw runtime_error("Failed to create DXC compiler");
     }
 
-    status = utils->CreateDefaultIncludeHandler(&includeHandler);
+    status = instance->utils->CreateDefaultIncludeHandler(&instance->includeHandler);
     if (FAILED(status))
     {
         throw runtime_error("Failed to create DXC include handler");
     }
+    return instance;
+}
+
+// Hash the given bytes into the given hash value (64-bit FNV-1a).
+static void hashBytes(const void* data, size_t size, uint64_t& hash)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t b = 0; b < size; b++)
+    {
+        hash = (hash ^ bytes[b]) * 0x100000001b3;
+    }
 }
 
-void ShaderCompiler::compile(const Shader& shader)
+void ShaderCompiler::hashFile(const fs::path& file, uint64_t& hash, vector<fs::path>& hashedFiles)
+{
+    if (find(hashedFiles.begin(), hashedFiles.end(), file) != hashedFiles.end())
+    {
+        return;
+    }
+    hashedFiles.emplace_back(file);
+    ifstream input(file, ios::binary);
+    if (!input.is_open())
+    {
+        // Let the compiler report the missing include.
+        return;
+    }
+    const string source{istreambuf_iterator<char>(input), istreambuf_iterator<char>()};
+    const string filename = file.filename().string();
+    hashBytes(filename.data(), filename.size() + 1, hash);
+    hashBytes(source.data(), source.size(), hash);
+
+    // Hash the included files, which are searched next to the file and in the include path.
+    static const regex includeDirective{R"(^\s*#\s*include\s*[<"]([^>"]+)[>"])"};
+    istringstream lines(source);
+    string line;
+    smatch match;
+    while (getline(lines, line))
+    {
+        if (regex_search(line, match, includeDirective))
+        {
+            const fs::path local = file.parent_path() / match[1].str();
+            hashFile(fs::exists(local) ? local : includePath / match[1].str(), hash, hashedFiles);
+        }
+    }
+}
+
+void ShaderCompiler::compile(Shader& shader)
+{
+    Profiler::Scope scope("compile shader", shader.name + "." + shader.stageSuffix());
+    // Acquire an idle DXC instance, or create one if all instances are in use by other threads.
+    unique_ptr<Instance> instance;
+    {
+        lock_guard lock(instanceMutex);
+        if (!instances.empty())
+        {
+            instance = std::move(instances.back());
+            instances.pop_back();
+        }
+    }
+    if (!instance)
+    {
+        instance = createInstance();
+    }
+    const auto release = [&]() {
+        lock_guard lock(instanceMutex);
+        instances.emplace_back(std::move(instance));
+    };
+    try
+    {
+        compile(shader, *instance);
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+    release();
+}
+
+void ShaderCompiler::compile(Shader& shader, Instance& instance)
 {
     fs::path input = shader.path(false);
     wstring w_input = input.wstring();
@@ -141,6 +244,7 @@ void ShaderCompiler::compile(const Shader& shader)
         L"-I",      w_includePath.data(),
         L"-T",      w_targetProfile.data(),
         L"-spirv",
+        L"-fspv-target-env=vulkan1.2",
         // clang-format on
     };
     for (const wstring& w_macro : shader.macros)
@@ -149,9 +253,32 @@ void ShaderCompiler::compile(const Shader& shader)
         args.emplace_back(w_macro.data());
     }
 
+    // Derive the cache key from the DXC version, the compiler arguments (entry point, profile, macros, ...),
+    // the source and its includes. Skip the compilation if the shader is cached under the key.
+    uint64_t hash = 0xcbf29ce484222325;
+    hashBytes(&dxcVersion, sizeof(dxcVersion), hash);
+    for (LPCWSTR arg : args)
+    {
+        hashBytes(arg, (wcslen(arg) + 1) * sizeof(wchar_t), hash);
+    }
+    vector<fs::path> hashedFiles;
+    hashFile(input, hash, hashedFiles);
+    ostringstream key;
+    key << hex << setw(16) << setfill('0') << hash;
+    shader.key = key.str();
+    const fs::path output = shader.path();
+    {
+        lock_guard lock(cacheMutex);
+        usedShaders.insert(output);
+    }
+    if (fs::exists(output))
+    {
+        return;
+    }
+
     // Load the shader.
     CComPtr<IDxcBlobEncoding> inputBlob{};
-    status = utils->LoadFile(w_input.data(), {}, &inputBlob);
+    HRESULT status = instance.utils->LoadFile(w_input.data(), {}, &inputBlob);
     if (FAILED(status))
     {
         throw runtime_error("Failed to load shader [" + input.filename().string() + "]");
@@ -164,8 +291,8 @@ void ShaderCompiler::compile(const Shader& shader)
 
     // Compile the shader.
     CComPtr<IDxcResult> result{};
-    status = compiler->Compile(&source, args.data(), static_cast<uint32_t>(args.size()), includeHandler,
-                               IID_PPV_ARGS(&result));
+    status = instance.compiler->Compile(&source, args.data(), static_cast<uint32_t>(args.size()),
+                                        instance.includeHandler, IID_PPV_ARGS(&result));
     if (FAILED(status))
     {
         throw runtime_error("Failed to compile shader [" + input.filename().string() + "]");
@@ -192,8 +319,40 @@ void ShaderCompiler::compile(const Shader& shader)
     {
         throw runtime_error("Failed to get binary of shader [" + input.filename().string() + "]");
     }
-    ofstream file(shader.path(), ios::binary);
+    // Write it to a temporary file first, so that an interrupted write does not leave a corrupt cache entry.
+    // The temporary file is unique per thread, since threads may compile the same shader concurrently.
+    fs::create_directories(output.parent_path());
+    const fs::path temporary =
+        fs::path(output).concat("." + to_string(std::hash<thread::id>{}(this_thread::get_id())) + ".tmp");
+    ofstream file(temporary, ios::binary);
+    if (!file.is_open())
+    {
+        throw runtime_error("Failed to save shader to " + temporary.string());
+    }
     file.write(static_cast<const char*>(outputBlob->GetBufferPointer()),
                static_cast<streamsize>(outputBlob->GetBufferSize()));
     file.close();
+    fs::rename(temporary, output);
+
+    // Remove the stale variants, e.g. those compiled from an old source, which are never used again.
+    removeStaleShaders(shader);
+}
+
+void ShaderCompiler::removeStaleShaders(const Shader& shader)
+{
+    // The cached variants are named <name>.<stage suffix>.<key>.spv, see Shader::path.
+    // Temporary files of concurrent compilations have a different extension and are kept.
+    const fs::path cache = shader.path().parent_path();
+    const string prefix = shader.name + "." + shader.stageSuffix() + ".";
+    lock_guard lock(cacheMutex);
+    error_code error;
+    for (const fs::directory_entry& entry : fs::directory_iterator(cache, error))
+    {
+        const string stem = entry.path().stem().string();
+        if (entry.path().extension() == ".spv" && stem.size() == prefix.size() + shader.key.size() &&
+            stem.compare(0, prefix.size(), prefix) == 0 && !usedShaders.contains(entry.path()))
+        {
+            fs::remove(entry.path(), error);
+        }
+    }
 }
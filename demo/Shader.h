@@ -2,6 +2,8 @@
 
 #include "Utils.h"
 #include "VersionNumber.h"
+#include <mutex>
+#include <set>
 #include <vulkan/vulkan.hpp>
 
 #ifdef _WIN32
@@ -43,6 +45,8 @@ struct Shader
     std::vector<char> code;
     // macros (<identifier>=<value>) defined in the shader
     std::vector<std::wstring> macros;
+    // cache key of the compiled shader (hash of the compilation inputs)
+    std::string key;
 
     // Return true if the shader is compiled to SPIR-V. Return false otherwise.
     bool isCompiled();
@@ -53,10 +57,15 @@ struct Shader
     // Return the stage suffix of the shader file.
     std::string stageSuffix() const;
     // Return the path to the (compiled) shader file.
+    // The compiled shader is cached under its key, so that each variant of the shader is compiled once.
     inline std::filesystem::path path(bool compiled = true) const
     {
+        if (compiled)
+        {
+            return cachePath("shaders/" + name + "." + stageSuffix() + "." + key, "spv");
+        }
         return demoPath.parent_path().parent_path() / "demo" / "shaders" / name /
-               (name + "." + stageSuffix() + (compiled ? ".spv" : ".hlsl"));
+               (name + "." + stageSuffix() + ".hlsl");
     }
     // Return the wide-character macro string constructed from identifier and value.
     template <typename T> static std::wstring macro(const std::string& identifier, T value)
@@ -66,9 +75,21 @@ struct Shader
 };
 
 // shader compiler
+// Shaders can be compiled concurrently, each thread compiles with its own DXC instance.
 class ShaderCompiler
 {
   private:
+    // DXC instance
+    struct Instance
+    {
+        // DXC utils
+        CComPtr<IDxcUtils> utils{};
+        // DXC compiler
+        CComPtr<IDxcCompiler3> compiler{};
+        // DXC include handler
+        CComPtr<IDxcIncludeHandler> includeHandler{};
+    };
+
     // HLSL version
     const VersionNumber hlsl{.major = 2021};
     // include path
@@ -77,20 +98,33 @@ class ShaderCompiler
     }();
     // HLSL shader model
     const VersionNumber shaderModel{.major = 6, .minor = 6};
-    // compiler status
-    HRESULT status{S_OK};
-    // DXC utils
-    CComPtr<IDxcUtils> utils{};
-    // DXC compiler
-    CComPtr<IDxcCompiler3> compiler{};
-    // DXC include handler
-    CComPtr<IDxcIncludeHandler> includeHandler{};
+    // DXC version (the patch version is the commit count of the DXC build)
+    VersionNumber dxcVersion{};
+    // idle DXC instances
+    std::vector<std::unique_ptr<Instance>> instances;
+    // mutex of the idle DXC instances
+    std::mutex instanceMutex;
+    // paths to the compiled shaders used in this run
+    std::set<std::filesystem::path> usedShaders;
+    // mutex of the shader cache
+    std::mutex cacheMutex;
+
+    // Create a DXC instance.
+    static std::unique_ptr<Instance> createInstance();
+    // Compile the given shader with the given DXC instance.
+    void compile(Shader& shader, Instance& instance);
+    // Hash the given file and the files it includes into the given hash value.
+    void hashFile(const std::filesystem::path& file, uint64_t& hash, std::vector<std::filesystem::path>& hashedFiles);
+    // Remove the cached variants of the given shader that are not used in this run.
+    void removeStaleShaders(const Shader& shader);
 
   public:
     // Construct the shader compiler.
     ShaderCompiler();
     // Destruct the shader compiler.
     ~ShaderCompiler() = default;
-    // Compile the given shader from HLSL to SPIR-V.
-    void compile(const Shader& shader);
+    // Compile the given shader from HLSL to SPIR-V and set its cache key.
+    // The compilation is skipped if the shader is cached under the key,
+    // i.e. if neither the source, its includes, the compiler arguments, nor the DXC version changed.
+    void compile(Shader& shader);
 };
\ No newline at end of file
@@ -28,6 +28,17 @@ struct VolumeConstraint
     alignas(4) float alpha;
 };
 
+// long-range attachment constraint (unilateral tethers to the geodesically nearest static particles)
+struct LongRangeAttachment
+{
+    // particle index
+    alignas(4) glm::uint i;
+    // anchor particle indices (~0: none)
+    alignas(4) glm::uint a[2];
+    // maximum (geodesic) distances to the anchors
+    alignas(4) float d[2];
+};
+
 // spatial index
 struct Spatial
 {
@@ -37,6 +48,105 @@ struct Spatial
     alignas(4) glm::uint i;
 };
 
+// spatial index whose hash value changed since the last update
+struct SpatialMove
+{
+    // new hash value
+    alignas(4) glm::uint h;
+    // particle index
+    alignas(4) glm::uint i;
+    // position in the spatial indices sorted in the last update
+    alignas(4) glm::uint slot;
+};
+
+// spatial sort arguments
+struct SpatialSortArgs
+{
+    // moved spatial index count
+    alignas(4) glm::uint movedCount;
+    // indirect dispatch arguments of the full sort passes (fallback)
+    alignas(4) glm::uint rehash[3];
+    alignas(4) glm::uint sort[3];
+    alignas(4) glm::uint groupsort[3];
+    // indirect dispatch arguments of the merge passes
+    alignas(4) glm::uint merge[3];
+};
+
+// spatial table entry
+struct SpatialCell
+{
+    // spatial index range
+    alignas(4) glm::uint begin;
+    alignas(4) glm::uint end;
+    // generation stamp of the last update writing the entry
+    alignas(4) glm::uint stamp;
+};
+
+// simulation island (connected component of the constraint graph)
+struct Island
+{
+    // range of the island particle indices
+    alignas(4) glm::uint begin;
+    alignas(4) glm::uint end;
+    // consecutive updates at rest (the island sleeps once the rest count is reached)
+    alignas(4) glm::uint restCount;
+    // Is the island woken up in the next update? (non-zero)
+    alignas(4) glm::uint wake;
+};
+
+// simulated body (contiguous particle range bounded as a whole by the broadphase)
+struct Body
+{
+    // range of the body particle indices
+    alignas(4) glm::uint begin;
+    alignas(4) glm::uint end;
+};
+
+// range of body particles checked against the colliders overlapping the body
+struct ColliderChunk
+{
+    // range of the particle indices
+    alignas(4) glm::uint begin;
+    alignas(4) glm::uint end;
+    // collider group bits
+    alignas(4) glm::uint colliders;
+};
+
+// simulation statistics
+struct SimStats
+{
+    // particle count at the star
+    alignas(4) glm::uint counter;
+    // particle counts per state
+    alignas(4) glm::uint stateCounts[5];
+    // maximum distance constraint error
+    alignas(4) float maxConstrError;
+    // total energy of the free particles
+    alignas(4) float energy;
+    // collider chunk count of the body broadphase (first copy only)
+    alignas(4) glm::uint colliderChunks;
+    // count of the chunks whose moon test is culled by the moon shell test (first copy only)
+    alignas(4) glm::uint shellCulledChunks;
+};
+
+// collision group
+// A particle collision filter holds the group bits of the particle in the lower half
+// and the mask bits of the groups it collides with in the upper half.
+enum struct CollisionGroup : glm::uint
+{
+    BODY = 1,
+    STAR_PARTICLE = 2,
+    MOON = 4,
+    PLAYER = 8,
+    ALL = 0xFFFF,
+};
+
+// Return the collision filter given the group and mask bits.
+constexpr glm::uint collisionFilter(glm::uint group, glm::uint mask)
+{
+    return (group & 0xFFFF) | (mask << 16);
+}
+
 // particle state
 enum struct State : glm::uint
 {
@@ -44,4 +154,5 @@ enum struct State : glm::uint
     PLAYER = 1,
     STAR = 2,
     STATIC = 3,
+    SLEEP = 4,
 };
\ No newline at end of file
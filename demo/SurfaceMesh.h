@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Archive.h"
 #include "Utils.h"
 #include "Vertex.h"
 #include <tiny_obj_loader.h>
@@ -32,7 +33,17 @@ template <typename Index = uint32_t> struct SurfaceMesh
         std::vector<material_t> materials;
         std::string error;
         const std::string path = meshPath(name, extension).string();
-        if (!LoadObj(&attributes, &shapes, &materials, &error, path.data()))
+        bool success;
+        if (const Data blob = Archive::assets().find(path); blob.data)
+        {
+            Archive::Stream stream(blob);
+            success = LoadObj(&attributes, &shapes, &materials, &error, &stream);
+        }
+        else
+        {
+            success = LoadObj(&attributes, &shapes, &materials, &error, path.data());
+        }
+        if (!success)
         {
             throw std::runtime_error("Failed to load surface mesh [" + name + "]" +
                                      (error.empty() ? "" : (": " + error)));
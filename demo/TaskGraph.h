@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// graph of tasks with explicit dependencies, run on a pool of threads
+class TaskGraph
+{
+  private:
+    // task
+    struct Task
+    {
+        // work of the task
+        std::function<void()> work;
+        // indices of the tasks depending on the task
+        std::vector<uint32_t> dependents;
+        // count of unfinished dependencies
+        uint32_t pendingCount{};
+    };
+    // tasks
+    std::vector<Task> tasks;
+
+  public:
+    // Add a task given its work and the indices of the tasks it depends on. Return the index of the task.
+    // The dependencies are added before the task, so the graph is acyclic.
+    uint32_t add(std::function<void()> work, const std::vector<uint32_t>& dependencies = {})
+    {
+        const uint32_t index = static_cast<uint32_t>(tasks.size());
+        tasks.emplace_back(Task{
+            .work = std::move(work),
+            .pendingCount = static_cast<uint32_t>(dependencies.size()),
+        });
+        for (uint32_t dependency : dependencies)
+        {
+            tasks[dependency].dependents.emplace_back(index);
+        }
+        return index;
+    }
+
+    // Run the tasks on the given thread count, including the calling thread, and wait for them to finish.
+    // A task starts once all of its dependencies are finished. If a task throws, no further tasks are started
+    // and the exception is rethrown.
+    void run(uint32_t threadCount = std::thread::hardware_concurrency())
+    {
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::vector<uint32_t> ready;
+        for (uint32_t t = 0; t < tasks.size(); t++)
+        {
+            if (tasks[t].pendingCount == 0)
+            {
+                ready.emplace_back(t);
+            }
+        }
+        size_t finishedCount = 0;
+        std::exception_ptr exception;
+
+        const auto worker = [&]() {
+            std::unique_lock lock(mutex);
+            while (true)
+            {
+                condition.wait(lock, [&]() -> bool {
+                    return !ready.empty() || finishedCount == tasks.size() || exception;
+                });
+                if (ready.empty() || exception)
+                {
+                    return;
+                }
+                const uint32_t t = ready.back();
+                ready.pop_back();
+                lock.unlock();
+                try
+                {
+                    tasks[t].work();
+                }
+                catch (...)
+                {
+                    lock.lock();
+                    if (!exception)
+                    {
+                        exception = std::current_exception();
+                    }
+                    condition.notify_all();
+                    return;
+                }
+                lock.lock();
+                finishedCount++;
+                for (uint32_t dependent : tasks[t].dependents)
+                {
+                    if (--tasks[dependent].pendingCount == 0)
+                    {
+                        ready.emplace_back(dependent);
+                    }
+                }
+                condition.notify_all();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threadCount = std::min(std::max(threadCount, 1u), static_cast<uint32_t>(tasks.size()));
+        for (uint32_t i = 1; i < threadCount; i++)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        tasks.clear();
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+};
\ No newline at end of file
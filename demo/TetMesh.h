@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Utils.h"
+#include <glm/gtx/hash.hpp>
+#include <unordered_map>
+#include <unordered_set>
+
+// tetrahedral mesh
+struct TetMesh
+{
+    // node positions
+    std::vector<glm::float3> positions;
+    // element node indices
+    std::vector<glm::uvec4> elements;
+    // Is the node static?
+    std::vector<bool> fixed;
+
+    // Return six times the signed volume of the tetrahedron.
+    static float volume6(const glm::float3& x_i, const glm::float3& x_j, const glm::float3& x_k,
+                         const glm::float3& x_l)
+    {
+        return glm::dot(glm::cross(x_j - x_i, x_k - x_i), x_l - x_i);
+    }
+
+    // Return six times the signed volume of the given element.
+    float volume6(const glm::uvec4& element) const
+    {
+        return volume6(positions[element[0]], positions[element[1]], positions[element[2]], positions[element[3]]);
+    }
+
+    // Return true if the given element encloses the point. Return false otherwise.
+    bool encloses(const glm::uvec4& element, const glm::float3& x) const
+    {
+        const glm::float3& x_i = positions[element[0]];
+        const glm::float3& x_j = positions[element[1]];
+        const glm::float3& x_k = positions[element[2]];
+        const glm::float3& x_l = positions[element[3]];
+        const float V = volume6(x_i, x_j, x_k, x_l);
+        // The point is enclosed if all sub-tetrahedra have the same orientation as the element.
+        return volume6(x, x_j, x_k, x_l) * V >= 0.0f && volume6(x_i, x, x_k, x_l) * V >= 0.0f &&
+               volume6(x_i, x_j, x, x_l) * V >= 0.0f && volume6(x_i, x_j, x_k, x) * V >= 0.0f;
+    }
+
+    // Return the mean edge length.
+    float meanEdgeLength() const
+    {
+        std::unordered_set<glm::uvec2> edges{};
+        edges.reserve(6 * elements.size());
+        for (const glm::uvec4& element : elements)
+        {
+            for (uint32_t a = 0; a < 4; a++)
+            {
+                for (uint32_t b = a + 1; b < 4; b++)
+                {
+                    edges.emplace(glm::uvec2{std::min(element[a], element[b]), std::max(element[a], element[b])});
+                }
+            }
+        }
+        float d_mean = 0.0f;
+        for (const glm::uvec2& edge : edges)
+        {
+            d_mean += glm::distance(positions[edge[0]], positions[edge[1]]);
+        }
+        return d_mean / static_cast<float>(edges.size());
+    }
+
+    // Return a coarser level of detail via voxel remeshing.
+    // The elements are rasterized to a grid whose cell length is 2^level times the mean edge length.
+    // Each cell whose center is enclosed by an element is split into six positively oriented tetrahedra,
+    // which are conforming across cell faces.
+    TetMesh coarsen(uint32_t level) const
+    {
+        using namespace glm;
+
+        if (level == 0)
+        {
+            return *this;
+        }
+
+        // Determine the grid origin and cell length.
+        const float cellLength = std::ldexp(meanEdgeLength(), static_cast<int>(level));
+        float3 x_min{std::numeric_limits<float>::max()};
+        for (const float3& x : positions)
+        {
+            x_min = min(x_min, x);
+        }
+        const auto cellCenter = [&](const ivec3& c) -> float3 { return x_min + (float3(c) + 0.5f) * cellLength; };
+
+        // Rasterize the elements, i.e. collect the cells whose centers are enclosed.
+        std::unordered_set<ivec3> cellSet{};
+        std::vector<ivec3> cells{};
+        for (const uvec4& element : elements)
+        {
+            float3 e_min = positions[element[0]];
+            float3 e_max = positions[element[0]];
+            for (uint32_t a = 1; a < 4; a++)
+            {
+                e_min = min(e_min, positions[element[a]]);
+                e_max = max(e_max, positions[element[a]]);
+            }
+            const ivec3 c_min = ceil((e_min - x_min) / cellLength - 0.5f);
+            const ivec3 c_max = floor((e_max - x_min) / cellLength - 0.5f);
+            for (int cx = c_min.x; cx <= c_max.x; cx++)
+            {
+                for (int cy = c_min.y; cy <= c_max.y; cy++)
+                {
+                    for (int cz = c_min.z; cz <= c_max.z; cz++)
+                    {
+                        const ivec3 c{cx, cy, cz};
+                        if (!cellSet.contains(c) && encloses(element, cellCenter(c)))
+                        {
+                            cellSet.emplace(c);
+                            cells.emplace_back(c);
+                        }
+                    }
+                }
+            }
+        }
+        if (cells.empty())
+        {
+            throw std::runtime_error("Failed to coarsen tetrahedral mesh: no enclosed cells at level " +
+                                     std::to_string(level));
+        }
+
+        // Split the cells into tetrahedra along the main diagonal (Kuhn triangulation).
+        static constexpr std::array<uvec3, 6> axisPermutations{
+            uvec3{0, 1, 2}, uvec3{0, 2, 1}, uvec3{1, 0, 2}, uvec3{1, 2, 0}, uvec3{2, 0, 1}, uvec3{2, 1, 0},
+        };
+        TetMesh lod{};
+        std::unordered_map<ivec3, uint32_t> cornersToIndices{};
+        cornersToIndices.reserve(2 * cells.size());
+        lod.elements.reserve(6 * cells.size());
+        const auto corner = [&](const ivec3& c) -> uint32_t {
+            auto [it, inserted] = cornersToIndices.try_emplace(c, static_cast<uint32_t>(lod.positions.size()));
+            if (inserted)
+            {
+                lod.positions.emplace_back(x_min + float3(c) * cellLength);
+                lod.fixed.emplace_back(false);
+            }
+            return it->second;
+        };
+        for (const ivec3& c : cells)
+        {
+            for (const uvec3& axes : axisPermutations)
+            {
+                ivec3 c_a = c;
+                c_a[axes[0]]++;
+                ivec3 c_ab = c_a;
+                c_ab[axes[1]]++;
+                uvec4 element{corner(c), corner(c_a), corner(c_ab), corner(c + 1)};
+                if (lod.volume6(element) < 0.0f)
+                {
+                    std::swap(element[2], element[3]);
+                }
+                lod.elements.emplace_back(element);
+            }
+        }
+
+        // Fix the corners of the cells containing static nodes, or the nearest node if the cell is empty.
+        for (uint32_t i = 0; i < positions.size(); i++)
+        {
+            if (!fixed[i])
+            {
+                continue;
+            }
+            const ivec3 c0 = floor((positions[i] - x_min) / cellLength);
+            bool foundCorner = false;
+            for (uint32_t bits = 0; bits < 8; bits++)
+            {
+                const ivec3 c = c0 + ivec3(bits & 1, (bits >> 1) & 1, (bits >> 2) & 1);
+                if (cornersToIndices.contains(c))
+                {
+                    lod.fixed[cornersToIndices[c]] = true;
+                    foundCorner = true;
+                }
+            }
+            if (!foundCorner)
+            {
+                uint32_t nearest = 0;
+                for (uint32_t j = 1; j < lod.positions.size(); j++)
+                {
+                    if (distance(lod.positions[j], positions[i]) < distance(lod.positions[nearest], positions[i]))
+                    {
+                        nearest = j;
+                    }
+                }
+                lod.fixed[nearest] = true;
+            }
+        }
+
+        return lod;
+    }
+};
\ No newline at end of file
@@ -32,6 +32,24 @@ inline const std::filesystem::path demoPath = []() -> std::filesystem::path {
 #endif
 }();
 
+// Return the path to the specified asset archive file.
+inline std::filesystem::path archivePath(const std::string& name = "assets", const std::string& extension = "pak")
+{
+    return demoPath.parent_path() / (name + "." + extension);
+}
+
+// Return the path to the asset directory.
+inline std::filesystem::path assetDirectoryPath()
+{
+    return demoPath.parent_path().parent_path() / "demo";
+}
+
+// Return the path to the specified cache file.
+inline std::filesystem::path cachePath(const std::string& name, const std::string& extension = "cache")
+{
+    return demoPath.parent_path() / "cache" / (name + "." + extension);
+}
+
 // Return the path to the specified font file.
 inline std::filesystem::path fontPath(const std::string& name, const std::string& style = "Regular",
                                       const std::string& extension = "ttf")
@@ -65,6 +83,12 @@ inline std::filesystem::path modelTexturePath(const std::string& model, const st
     return demoPath.parent_path().parent_path() / "demo" / "models" / model / "textures" / (texture + "." + extension);
 }
 
+// Return the path to the specified profile file.
+inline std::filesystem::path profilePath(const std::string& name, const std::string& extension = "json")
+{
+    return demoPath.parent_path() / "profiles" / (name + "." + extension);
+}
+
 // Return the path to the specified sound file.
 inline std::filesystem::path soundPath(const std::string& name, const std::string& extension = "wav")
 {
@@ -132,6 +156,27 @@ inline vk::Format textureFormat(ColorSpace colorSpace)
     }
 }
 
+// Return the texture format corresponding to the given image format and color space.
+// The undefined image format denotes 8-bit RGBA.
+inline vk::Format textureFormat(vk::Format format, ColorSpace colorSpace)
+{
+    using namespace vk;
+
+    switch (format)
+    {
+    case Format::eUndefined:
+        return textureFormat(colorSpace);
+    case Format::eBc7UnormBlock:
+    case Format::eBc7SrgbBlock:
+        return (colorSpace == ColorSpace::sRGB) ? Format::eBc7SrgbBlock : Format::eBc7UnormBlock;
+    case Format::eEtc2R8G8B8A8UnormBlock:
+    case Format::eEtc2R8G8B8A8SrgbBlock:
+        return (colorSpace == ColorSpace::sRGB) ? Format::eEtc2R8G8B8A8SrgbBlock : Format::eEtc2R8G8B8A8UnormBlock;
+    default:
+        return format;
+    }
+}
+
 // Compose the transformation matrix from translation, rotation, and scale.
 inline glm::float4x4 compose(const glm::float3& translation, const glm::quat& rotation, const glm::float3& scale)
 {
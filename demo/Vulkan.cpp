@@ -1,7 +1,9 @@
 #include "Vulkan.h"
 
 #include "Demo.h"
+#include "Profiler.h"
 #include "SurfaceMesh.h"
+#include "TaskGraph.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 #include <set>
@@ -17,6 +19,9 @@ Vulkan::Vulkan(Engine& engine)
     : engine(engine),
       substepDeltaTime(engine.deltaTime / static_cast<float>(substepCount))
 {
+    Profiler::Scope scope("initialize Vulkan");
+    Profiler::Scope deviceScope("create device");
+
     // Initialize the dispatcher.
     DynamicLoader dynamicLoader;
     auto getInstanceProcAddr = dynamicLoader.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
@@ -86,6 +91,27 @@ Vulkan::Vulkan(Engine& engine)
         VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
         VK_KHR_SWAPCHAIN_EXTENSION_NAME,
     };
+    gpu = GPU::select(instance, surface, deviceExtensions);
+    gpu.checkPortabilitySubset(deviceExtensions);
+
+    // Select the block compression of the transcoded textures, preferring BC over ETC2.
+    const PhysicalDeviceFeatures gpuFeatures = gpu.device.getFeatures();
+    if (gpuFeatures.textureCompressionBC &&
+        gpu.supportsFormats({Format::eBc4UnormBlock, Format::eBc5UnormBlock, Format::eBc7UnormBlock,
+                             Format::eBc7SrgbBlock},
+                            ImageTiling::eOptimal, FormatFeatureFlagBits::eSampledImageFilterLinear))
+    {
+        textureCompression = TextureCompression::BC;
+    }
+    else if (gpuFeatures.textureCompressionETC2 &&
+             gpu.supportsFormats({Format::eEacR11UnormBlock, Format::eEacR11G11UnormBlock,
+                                  Format::eEtc2R8G8B8A8UnormBlock, Format::eEtc2R8G8B8A8SrgbBlock},
+                                 ImageTiling::eOptimal, FormatFeatureFlagBits::eSampledImageFilterLinear))
+    {
+        textureCompression = TextureCompression::ETC2;
+    }
+
+    // Create the logical device.
     PhysicalDeviceDynamicRenderingFeatures deviceDynamicRenderingFeatures{
         .dynamicRendering = true,
     };
@@ -99,12 +125,10 @@ Vulkan::Vulkan(Engine& engine)
             PhysicalDeviceFeatures{
                 .sampleRateShading = true,
                 .samplerAnisotropy = true,
+                .textureCompressionETC2 = (textureCompression == TextureCompression::ETC2),
+                .textureCompressionBC = (textureCompression == TextureCompression::BC),
             },
     };
-    gpu = GPU::select(instance, surface, deviceExtensions);
-    gpu.checkPortabilitySubset(deviceExtensions);
-
-    // Create the logical device.
     std::vector<DeviceQueueCreateInfo> deviceQueueCreateInfos;
     const std::set deviceQueueFamilyIndices{
         gpu.graphicsQueueFamilyIndex,
@@ -149,6 +173,9 @@ Vulkan::Vulkan(Engine& engine)
         .instance = instance,
         .vulkanApiVersion = applicationInfo.apiVersion,
     });
+    deviceScope.stop();
+
+    initializePipelineCache();
 
     // Create the command pools and persistent buffers.
     graphicsPool = device.createCommandPool(CommandPoolCreateInfo{
@@ -199,14 +226,20 @@ Vulkan::Vulkan(Engine& engine)
     varUniformBufferSize += gpu.alignedUniformSize(sizeof(ViewProjectionUniform));
 
     generateStarParticles();
+    Profiler::Scope particleScope("load surface mesh", "particle");
     auto particleMesh = SurfaceMesh<uint16_t>::load("particle");
+    particleScope.stop();
 
     // Load the models.
-    loadModel("astronaut");
-    loadModel("moon");
-    loadModel("ball", "gltf", {0.0f, 21.0f, 2.0f});
-    loadModel("flag", "gltf", {0.0f, 21.0f, -2.0f});
-    loadModel("star", "gltf", starPosition);
+    // The intro only shows the moon and the star, so the other models are streamed while it plays.
+    // Their layouts and simulated meshes are still loaded here, since they size the buffers and the simulation.
+    loadModels({
+        {.name = "astronaut", .streamed = true},
+        {.name = "moon"},
+        {.name = "ball", .translation = {0.0f, 21.0f, 2.0f}, .streamed = true},
+        {.name = "flag", .translation = {0.0f, 21.0f, -2.0f}, .streamed = true},
+        {.name = "star", .translation = starPosition},
+    });
 
     auto skyboxVertices = std::to_array<glm::float3>({
         {+1.0f, +1.0f, +1.0f}, // 0
@@ -262,8 +295,10 @@ Vulkan::Vulkan(Engine& engine)
     });
 
     initializeDescriptorPool();
+    initializeUploads();
 
     // Initialize the vertex, index, and uniform buffers.
+    Profiler::Scope bufferScope("initialize buffers");
     setupTransfer();
     vertexBuffer =
         createBuffer(vertexBufferSize, BufferUsageFlagBits::eVertexBuffer | BufferUsageFlagBits::eTransferDst);
@@ -278,6 +313,16 @@ Vulkan::Vulkan(Engine& engine)
     fillBuffer(indexBuffer, Data::of(particleMesh.indices), particleIndexOffset);
     fillBuffer(indexBuffer, Data::of(skyboxIndices), skyboxIndexOffset);
 
+    particleInstanceOffset = gpu.alignedStorageSize(sizeof(DrawIndexedIndirectCommand));
+    DrawIndexedIndirectCommand particleDraw{.indexCount = particleIndexCount};
+    for (AllocatedBuffer& particleCullBuffer : particleCullBuffers)
+    {
+        particleCullBuffer = createBuffer(particleInstanceOffset + starParticleCount * sizeof(glm::uint),
+                                          BufferUsageFlagBits::eStorageBuffer | BufferUsageFlagBits::eIndirectBuffer |
+                                              BufferUsageFlagBits::eTransferDst);
+        fillBuffer(particleCullBuffer, Data::of(particleDraw));
+    }
+
     constUniformBuffer =
         createBuffer(constUniformBufferSize, BufferUsageFlagBits::eUniformBuffer | BufferUsageFlagBits::eTransferDst);
     fillBuffer(constUniformBuffer, Data::zero(sizeof(SkinUniform)));
@@ -294,37 +339,67 @@ Vulkan::Vulkan(Engine& engine)
     whiteImage = initTextureImage(ImageUsageFlagBits::eSampled, {255, 255, 255, 255});
     blueImage = initTextureImage(ImageUsageFlagBits::eSampled, {128, 128, 255, 255});
     playGraphics();
+    bufferScope.stop();
 
     initializeModels();
 
     initializeSimulation();
 
-    // Initialize the pipelines.
-    initializeStarUpdatePipeline();
-    initializeSpatialHashPipeline();
-    initializeSpatialSortPipeline();
-    initializeSpatialGroupsortPipeline();
-    initializeSpatialCollectPipeline();
-    initializeXpbdPredictPipeline();
-    initializeXpbdObjcollPipeline();
-    initializeXpbdPcollPipeline();
-    initializeXpbdDistPipeline();
-    initializeXpbdVolPipeline();
-    initializeXpbdCorrectPipeline();
-    initializeDepthPipeline();
-    initializeParticleDepthPipeline();
-    initializeLightingPipeline();
-    initializeParticlePipeline();
-    initializeSkyboxPipeline();
-    initializePostPipeline();
+    // Initialize the pipelines concurrently, i.e. compile their shaders and create them on a pool of threads.
+    // The pipelines are independent, except where their initialization shares resources.
+    // Each pipeline is profiled by name, and its shaders by the shader compiler.
+    Profiler::Scope pipelineScope("initialize pipelines");
+    TaskGraph pipelineTasks;
+    const auto profiled = [this](const char* name, void (Vulkan::*initializePipeline)()) -> std::function<void()> {
+        return [this, name, initializePipeline]() {
+            Profiler::Scope scope("initialize pipeline", name);
+            (this->*initializePipeline)();
+        };
+    };
+    for (const auto& [name, initializePipeline] : std::initializer_list<std::pair<const char*, void (Vulkan::*)()>>{
+             {"star update", &Vulkan::initializeStarUpdatePipeline},
+             {"spatial hash", &Vulkan::initializeSpatialHashPipeline},
+             {"spatial sort", &Vulkan::initializeSpatialSortPipeline},
+             {"spatial groupsort", &Vulkan::initializeSpatialGroupsortPipeline},
+             {"spatial fixup", &Vulkan::initializeSpatialFixupPipeline},
+             {"spatial merge", &Vulkan::initializeSpatialMergePipeline},
+             {"spatial collect", &Vulkan::initializeSpatialCollectPipeline},
+             {"xpbd predict", &Vulkan::initializeXpbdPredictPipeline},
+             {"xpbd lra", &Vulkan::initializeXpbdLraPipeline},
+             {"body broadphase", &Vulkan::initializeBodyBroadphasePipeline},
+             {"xpbd objcoll", &Vulkan::initializeXpbdObjcollPipeline},
+             {"xpbd pcoll", &Vulkan::initializeXpbdPcollPipeline},
+             {"xpbd dist", &Vulkan::initializeXpbdDistPipeline},
+             {"xpbd vol", &Vulkan::initializeXpbdVolPipeline},
+             {"xpbd correct", &Vulkan::initializeXpbdCorrectPipeline},
+             {"island sleep", &Vulkan::initializeIslandSleepPipeline},
+             {"sim stats", &Vulkan::initializeSimStatsPipeline},
+             {"depth", &Vulkan::initializeDepthPipeline},
+             {"particle cull", &Vulkan::initializeParticleCullPipeline},
+             {"post", &Vulkan::initializePostPipeline},
+         })
+    {
+        pipelineTasks.add(profiled(name, initializePipeline));
+    }
+    // The particle depth pipeline shares the vertex shader of the particle pipeline, so it is compiled once.
+    const uint32_t particleTask = pipelineTasks.add(profiled("particle", &Vulkan::initializeParticlePipeline));
+    pipelineTasks.add(profiled("particle depth", &Vulkan::initializeParticleDepthPipeline), {particleTask});
+    // The lighting and skybox pipelines upload their images with the graphics command buffer.
+    const uint32_t lightingTask = pipelineTasks.add(profiled("lighting", &Vulkan::initializeLightingPipeline));
+    pipelineTasks.add(profiled("skybox", &Vulkan::initializeSkyboxPipeline), {lightingTask});
+    pipelineTasks.run();
+    pipelineScope.stop();
 
     // Create the semaphores and fences.
-    constexpr SemaphoreTypeCreateInfo simCompleteType{
+    constexpr SemaphoreTypeCreateInfo timelineSemaphoreType{
         .semaphoreType = SemaphoreType::eTimeline,
         .initialValue = 0,
     };
     simComplete = device.createSemaphore(SemaphoreCreateInfo{
-        .pNext = &simCompleteType,
+        .pNext = &timelineSemaphoreType,
+    });
+    renderRead = device.createSemaphore(SemaphoreCreateInfo{
+        .pNext = &timelineSemaphoreType,
     });
     for (uint32_t i = 0; i < frameCount; i++)
     {
@@ -337,6 +412,8 @@ Vulkan::Vulkan(Engine& engine)
             .flags = FenceCreateFlagBits::eSignaled,
         });
     }
+
+    startStreaming();
 }
 
 void Vulkan::deviceWaitIdle()
@@ -346,6 +423,7 @@ void Vulkan::deviceWaitIdle()
 
 Vulkan::~Vulkan()
 {
+    terminateStreaming();
     terminateSwapchain();
     for (Model& model : models)
     {
@@ -376,8 +454,12 @@ Vulkan::~Vulkan()
         destroyImage(image);
     }
     destroyBuffer(storageBuffer);
-    unmapBuffer(counterBuffer);
-    destroyBuffer(counterBuffer);
+    destroyBuffer(statsBuffer);
+    for (AllocatedBuffer& statsReadbackBuffer : statsReadbackBuffers)
+    {
+        unmapBuffer(statsReadbackBuffer);
+        destroyBuffer(statsReadbackBuffer);
+    }
     for (AllocatedBuffer& buffer : {
              std::ref(vertexBuffer),
              std::ref(indexBuffer),
@@ -390,6 +472,7 @@ Vulkan::~Vulkan()
     {
         unmapBuffer(varUniformBuffers[i]);
         destroyBuffer(varUniformBuffers[i]);
+        destroyBuffer(particleCullBuffers[i]);
         if (guiVertexBuffers[i]())
         {
             unmapBuffer(guiVertexBuffers[i]);
@@ -408,6 +491,9 @@ Vulkan::~Vulkan()
         device.destroyCommandPool(renderPools[i]);
     }
     device.destroySemaphore(simComplete);
+    device.destroySemaphore(renderRead);
+    device.destroyQueryPool(batchTimestampPool);
+    terminateUploads();
     for (CommandPool& commandPool : {
              std::ref(graphicsPool),
              std::ref(transferPool),
@@ -416,14 +502,18 @@ Vulkan::~Vulkan()
         device.destroyCommandPool(commandPool);
     }
     device.destroyDescriptorPool(descPool);
+    savePipelineCache();
+    device.destroyPipelineCache(pipelineCache);
     for (Pipeline& pipeline : {
-             std::ref(starUpdatePipeline),       std::ref(spatialHashPipeline),    std::ref(spatialSortPipeline),
-             std::ref(spatialGroupsortPipeline), std::ref(spatialCollectPipeline), std::ref(xpbdPredictPipeline),
-             std::ref(xpbdObjcollPipeline),      std::ref(xpbdPcollPipeline),      std::ref(xpbdDistPipeline),
-             std::ref(xpbdVolPipeline),          std::ref(xpbdCorrectPipeline),    std::ref(depthPipeline),
-             std::ref(particleDepthPipeline),    std::ref(lightingPipeline),       std::ref(particlePipeline),
-             std::ref(skyboxPipeline),           std::ref(postPipeline),           std::ref(guiPipeline),
-             std::ref(shadowPipeline),
+             std::ref(starUpdatePipeline),       std::ref(spatialHashPipeline),   std::ref(spatialSortPipeline),
+             std::ref(spatialGroupsortPipeline), std::ref(spatialFixupPipeline),  std::ref(spatialMergePipeline),
+             std::ref(spatialCollectPipeline),   std::ref(xpbdPredictPipeline),   std::ref(xpbdLraPipeline),
+             std::ref(bodyBroadphasePipeline),   std::ref(xpbdObjcollPipeline),   std::ref(xpbdPcollPipeline),
+             std::ref(xpbdDistPipeline),         std::ref(xpbdVolPipeline),       std::ref(xpbdCorrectPipeline),
+             std::ref(islandSleepPipeline),      std::ref(simStatsPipeline),      std::ref(depthPipeline),
+             std::ref(particleCullPipeline),     std::ref(particleDepthPipeline), std::ref(lightingPipeline),
+             std::ref(particlePipeline),         std::ref(skyboxPipeline),        std::ref(postPipeline),
+             std::ref(guiPipeline),              std::ref(shadowPipeline),
          })
     {
         device.destroyPipeline(pipeline);
@@ -433,14 +523,21 @@ Vulkan::~Vulkan()
              std::ref(spatialHashPipelineLayout),
              std::ref(spatialSortPipelineLayout),
              std::ref(spatialGroupsortPipelineLayout),
+             std::ref(spatialFixupPipelineLayout),
+             std::ref(spatialMergePipelineLayout),
              std::ref(spatialCollectPipelineLayout),
              std::ref(xpbdPredictPipelineLayout),
+             std::ref(xpbdLraPipelineLayout),
+             std::ref(bodyBroadphasePipelineLayout),
              std::ref(xpbdObjcollPipelineLayout),
              std::ref(xpbdPcollPipelineLayout),
              std::ref(xpbdDistPipelineLayout),
              std::ref(xpbdVolPipelineLayout),
              std::ref(xpbdCorrectPipelineLayout),
+             std::ref(islandSleepPipelineLayout),
+             std::ref(simStatsPipelineLayout),
              std::ref(depthPipelineLayout),
+             std::ref(particleCullPipelineLayout),
              std::ref(particleDepthPipelineLayout),
              std::ref(lightingPipelineLayout),
              std::ref(particlePipelineLayout),
@@ -456,14 +553,21 @@ Vulkan::~Vulkan()
              std::ref(spatialHashDescLayout),
              std::ref(spatialSortDescLayout),
              std::ref(spatialGroupsortDescLayout),
+             std::ref(spatialFixupDescLayout),
+             std::ref(spatialMergeDescLayout),
              std::ref(spatialCollectDescLayout),
              std::ref(xpbdPredictDescLayout),
+             std::ref(xpbdLraDescLayout),
+             std::ref(bodyBroadphaseDescLayout),
              std::ref(xpbdObjcollDescLayout),
              std::ref(xpbdPcollDescLayout),
              std::ref(xpbdDistDescLayout),
              std::ref(xpbdVolDescLayout),
              std::ref(xpbdCorrectDescLayout),
+             std::ref(islandSleepDescLayout),
+             std::ref(simStatsDescLayout),
              std::ref(depthDescLayout),
+             std::ref(particleCullDescLayout),
              std::ref(sceneDescLayout),
              std::ref(materialDescLayout),
              std::ref(skinDescLayout),
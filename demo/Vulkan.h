@@ -6,7 +6,14 @@
 #include "Model.h"
 #include "Shader.h"
 #include "Storage.h"
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <glm/gtx/hash.hpp>
+#include <mutex>
 #include <tiny_gltf.h>
+#include <unordered_set>
 
 class Engine;
 union DescriptorInfo;
@@ -25,14 +32,98 @@ class Vulkan
     static constexpr uint32_t starParticleCount{8192};
     // star particle radius
     static constexpr float starParticleRadius{0.05f};
+    // star particle collision filter
+    static constexpr glm::uint starParticleCollisionFilter{collisionFilter(
+        static_cast<glm::uint>(CollisionGroup::STAR_PARTICLE), static_cast<glm::uint>(CollisionGroup::ALL))};
+    // default collision filter of the simulated bodies
+    static constexpr glm::uint bodyCollisionFilter{
+        collisionFilter(static_cast<glm::uint>(CollisionGroup::BODY), static_cast<glm::uint>(CollisionGroup::ALL))};
     // attachment count
     static constexpr uint32_t attachmentCount{2};
-    // XPBD substep count
+    // simulation statistics readback count (exceeds the in-flight update count)
+    static constexpr uint32_t readbackCount{frameCount + 1};
+    // rendered particle position buffer count (ping-pong: the simulation writes one while the other is rendered)
+    static constexpr uint32_t positionBufferCount{2};
+    // level of detail bias of the tetrahedral simulation meshes (opt-in through the MESH_LOD_BIAS build option)
+#ifdef MESH_LOD_BIAS
+    static constexpr uint32_t meshLodBias{MESH_LOD_BIAS};
+#else
+    static constexpr uint32_t meshLodBias{0};
+#endif
+    // spatial table size (independent of the particle count)
+    static constexpr uint32_t spatialTableSize{1 << 17};
+    // Maintain the sorted spatial indices incrementally between updates?
+    // Only the indices whose hash value changed are sorted and merged, unless they exceed the capacity.
+    static constexpr bool incrementalSpatialSort{true};
+    // maximum kinetic energy per unit mass of a particle at rest
+    static constexpr float restEnergy{0.5f * 0.05f * 0.05f};
+    // consecutive updates at rest after which an island sleeps
+    static constexpr uint32_t restCount{60};
+    // simulation variant of a batched copy of the simulated meshes
+    struct SimVariant
+    {
+        // compliance scale
+        float complianceScale;
+        // density scale
+        float densityScale;
+    };
+    // simulation variants for parameter sweeps
+    // The simulated meshes are copied for each variant and all copies are simulated in the same dispatches.
+    // Only the first copy is rendered and interacts with the star particles, the copies do not collide with each other.
+    // The sweep is enabled with the SIM_SWEEP build option, otherwise only the rendered copy is simulated.
+#ifdef SIM_SWEEP
+    static constexpr std::array simVariants{
+        SimVariant{.complianceScale = 1.0f, .densityScale = 1.0f},
+        SimVariant{.complianceScale = 0.5f, .densityScale = 1.0f},
+        SimVariant{.complianceScale = 2.0f, .densityScale = 1.0f},
+        SimVariant{.complianceScale = 1.0f, .densityScale = 0.5f},
+        SimVariant{.complianceScale = 1.0f, .densityScale = 2.0f},
+    };
+#else
+    static constexpr std::array simVariants{
+        SimVariant{.complianceScale = 1.0f, .densityScale = 1.0f},
+    };
+#endif
+    // batched copy count
+    static constexpr uint32_t batchSize{simVariants.size()};
+    // update interval of the batch reports
+    static constexpr uint32_t batchReportInterval{60};
+    // XPBD substep count (shared by the batched copies)
     static constexpr uint32_t substepCount{20};
+    // maximum particle count per collider chunk of a body
+    static constexpr uint32_t bodyChunkSize{256};
+    // body bounding box margin covering the particle displacement during an update
+    // (twice the clamped displacement per substep, since the position corrections are not clamped)
+    static constexpr float bodyMargin{2.0f * substepCount * 0.01f};
     // XPBD substep delta time
     const float substepDeltaTime;
     // shadow resolution
     static constexpr uint32_t shadowRes{8192};
+    // radius of the star core hiding the particles parked at the star
+    static constexpr float starCoreRadius{0.9f};
+    // simulation kernel
+    enum struct SimKernel : uint32_t
+    {
+        starUpdate,
+        spatialHash,
+        spatialSort,
+        spatialGroupsort,
+        spatialFixup,
+        spatialMerge,
+        spatialCollect,
+        xpbdPredict,
+        xpbdLra,
+        bodyBroadphase,
+        xpbdObjcoll,
+        xpbdPcoll,
+        xpbdDist,
+        xpbdVol,
+        xpbdCorrect,
+        islandSleep,
+        simStats,
+    };
+    // simulation kernel count
+    static constexpr uint32_t simKernelCount{17};
 
   public:
     // star position
@@ -40,8 +131,8 @@ class Vulkan
 
     // === Vulkan.cpp ==============================================================================================
   private:
-    // result
-    vk::Result result;
+    // result (per thread, since the pipelines are initialized concurrently)
+    static inline thread_local vk::Result result{};
     // instance
     vk::Instance instance;
     // debug messenger
@@ -50,6 +141,8 @@ class Vulkan
     vk::SurfaceKHR surface;
     // GPU (physical device)
     GPU gpu;
+    // block compression of the transcoded textures
+    TextureCompression textureCompression{};
     // logical device
     vk::Device device;
     // device queues
@@ -89,6 +182,10 @@ class Vulkan
     // mesh buffers
     AllocatedBuffer vertexBuffer, indexBuffer;
     std::array<AllocatedBuffer, frameCount> guiVertexBuffers, guiIndexBuffers;
+    // offset of the visible particle indices in the particle cull buffers
+    vk::DeviceSize particleInstanceOffset{-1u};
+    // particle cull buffers (indexed indirect draw arguments followed by the visible particle indices)
+    std::array<AllocatedBuffer, frameCount> particleCullBuffers;
     // samplers
     vk::Sampler linearClampSampler, linearClampAniSampler, linearRepeatSampler, linearRepeatAniSampler,
         nearestClampSampler, shadowSampler;
@@ -96,7 +193,7 @@ class Vulkan
     AllocatedImage brdfImage, irradianceImage, radianceImage, whiteImage, blueImage, skyboxImage, fontImage,
         shadowImage;
     // semaphores
-    vk::Semaphore simComplete;
+    vk::Semaphore simComplete, renderRead;
     std::array<vk::Semaphore, frameCount> imageAcquired, renderComplete;
     // fences
     std::array<vk::Fence, frameCount> updateInFlight, frameInFlight;
@@ -122,12 +219,15 @@ class Vulkan
     std::vector<vk::DescriptorPoolSize> descPoolSizes;
     // descriptor set layouts
     vk::DescriptorSetLayout starUpdateDescLayout, spatialHashDescLayout, spatialSortDescLayout,
-        spatialGroupsortDescLayout, spatialCollectDescLayout, xpbdPredictDescLayout, xpbdObjcollDescLayout,
-        xpbdPcollDescLayout, xpbdDistDescLayout, xpbdVolDescLayout, xpbdCorrectDescLayout, depthDescLayout,
-        sceneDescLayout, materialDescLayout, skinDescLayout, particleDescLayout, skyboxDescLayout, postDescLayout,
-        guiDescLayout;
+        spatialGroupsortDescLayout, spatialFixupDescLayout, spatialMergeDescLayout, spatialCollectDescLayout,
+        xpbdPredictDescLayout, xpbdLraDescLayout, bodyBroadphaseDescLayout, xpbdObjcollDescLayout, xpbdPcollDescLayout,
+        xpbdDistDescLayout, xpbdVolDescLayout, xpbdCorrectDescLayout, islandSleepDescLayout, simStatsDescLayout,
+        depthDescLayout, particleCullDescLayout, sceneDescLayout, materialDescLayout, skinDescLayout,
+        particleDescLayout, skyboxDescLayout, postDescLayout, guiDescLayout;
     // descriptor pool
     vk::DescriptorPool descPool;
+    // mutex of the descriptor pool
+    std::mutex descPoolMutex;
 
     // Initialize a descriptor set layout from the given bindings.
     // Optionally specify how many descriptor sets should be reserved for each frame.
@@ -158,17 +258,89 @@ class Vulkan
 
     // === VulkanMemory.cpp ========================================================================================
   private:
+    // staging ring size
+    static constexpr vk::DeviceSize stagingRingSize{64 << 20};
+    // staging alignment (multiple of the texel block sizes)
+    static constexpr vk::DeviceSize stagingAlignment{16};
+    // staging space of an upload
+    struct Staging
+    {
+        // staging buffer
+        vk::Buffer buffer;
+        // offset of the staging space in the staging buffer
+        vk::DeviceSize offset;
+        // mapped staging space
+        uint8_t* data;
+        // dedicated staging buffer owned by the caller (empty if the space is in the staging ring), see releaseStaging
+        AllocatedBuffer dedicated{};
+    };
+    // texture read into staging space
+    struct StagedTexture
+    {
+        // layout of the texture images in the staging space
+        TextureLayout layout;
+        // staging space
+        Staging staging;
+    };
+    // submitted upload batch
+    struct UploadBatch
+    {
+        // upload timeline value signaled once the batch is complete
+        uint64_t value;
+        // staging ring head after the batch
+        vk::DeviceSize stagingEnd;
+        // command pool of the command buffer
+        vk::CommandPool commandPool;
+        // recorded command buffer
+        vk::CommandBuffer commandBuffer;
+        // dedicated staging buffers
+        std::vector<AllocatedBuffer> stagingBuffers;
+    };
     // active command buffer
     vk::CommandBuffer activeBuffer{};
-    // staging buffers
-    std::vector<AllocatedBuffer> stagingBuffers;
+    // persistently mapped staging ring
+    AllocatedBuffer stagingRing;
+    // staging ring head and tail, which increase monotonically and are wrapped around the staging ring
+    vk::DeviceSize stagingHead{}, stagingTail{};
+    // dedicated staging buffers read by the active command buffer, released with its upload batch
+    // (only accessed by the recording thread)
+    std::vector<AllocatedBuffer> activeStagingBuffers;
+    // upload timeline semaphore, signaled with the upload batch count
+    vk::Semaphore uploadComplete;
+    // submitted upload batch count
+    uint64_t uploadCount{};
+    // upload batches in flight, in submission order
+    std::deque<UploadBatch> uploadBatches;
+    // mutex of the staging ring and the upload batches
+    std::mutex stagingMutex;
 
+    // Initialize the staging ring and the upload timeline semaphore.
+    void initializeUploads();
+    // Wait for the upload batches and destroy the staging ring and the upload timeline semaphore.
+    void terminateUploads();
     // Activate the given command buffer. All commands are recorded to the active command buffer.
     void activate(vk::CommandBuffer& commandBuffer);
     // Setup command recording by allocating memory from the pool and activating the buffer.
     void setup(vk::CommandPool& commandPool, vk::CommandBuffer& commandBuffer);
-    // Play the recorded commands by submitting the buffer to the queue and returning the memory to the pool.
+    // Play the recorded commands by submitting the buffer to the queue as an upload batch.
+    // The batch is not waited for, its command buffer and staging space are reclaimed once it is complete.
     void play(vk::Queue& queue, vk::CommandPool& commandPool, vk::CommandBuffer& commandBuffer);
+    // Reclaim the command buffers and staging space of the complete upload batches.
+    // Optionally wait until the upload timeline reaches the given value first.
+    void reclaimUploads(uint64_t value = 0);
+    // Wait for all submitted upload batches.
+    void waitUploads();
+    // Reserve staging space for the recorded uploads. This is thread-safe.
+    // The space is taken from the staging ring, waiting for old upload batches if necessary.
+    // If the recorded uploads still occupy the ring, the space is a dedicated staging buffer owned by the caller.
+    Staging reserveStaging(vk::DeviceSize size);
+    // Create a dedicated staging buffer for the recorded uploads, owned by the caller. This is thread-safe.
+    Staging dedicatedStaging(vk::DeviceSize size);
+    // Release the dedicated staging buffer of the staging space (if any) once the upload batch of the active command
+    // buffer is complete. This must be called by the recording thread after the copies from the space are recorded.
+    void releaseStaging(const Staging& staging);
+    // Stage the data for the recorded uploads.
+    Staging stage(Data data);
     // Setup the graphics buffer for recording.
     void setupGraphics();
     // Play the recorded graphics commands.
@@ -191,8 +363,6 @@ class Vulkan
     void fillStagingBuffer(AllocatedBuffer& buffer, Data data, vk::DeviceSize offset = 0);
     // Fill the staging buffer with data from multiple sources. Optionally align the data.
     void fillStagingBuffer(AllocatedBuffer& buffer, std::vector<Data> data, bool align = false);
-    // Initialize a staging buffer with data.
-    AllocatedBuffer initStagingBuffer(vk::BufferUsageFlags usage, Data data);
     // Create a readback buffer.
     AllocatedBuffer createReadbackBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage);
     // Copy the source buffer to the destination buffer.
@@ -224,9 +394,9 @@ class Vulkan
     // Transition the layout of the given image.
     void transitionImageLayout(AllocatedImage& image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
                                uint32_t mipLevel = 0, uint32_t levelCount = 0);
-    // Copy the buffer to the image.
-    void copyBufferToImage(AllocatedBuffer& buffer, AllocatedImage& image, uint32_t width, uint32_t height,
-                           uint32_t mipLevel = 0, uint32_t layer = 0);
+    // Copy the buffer to the image, starting at the given buffer offset.
+    void copyBufferToImage(vk::Buffer& buffer, AllocatedImage& image, uint32_t width, uint32_t height,
+                           uint32_t mipLevel = 0, uint32_t layer = 0, vk::DeviceSize offset = 0);
     // Copy the image to the buffer.
     void copyImageToBuffer(AllocatedImage& image, AllocatedBuffer& buffer, uint32_t width, uint32_t height,
                            uint32_t mipLevel = 0, uint32_t layer = 0);
@@ -237,11 +407,15 @@ class Vulkan
                                     ColorSpace colorSpace = ColorSpace::sRGB);
     // Initialize a texture image with a constant color.
     AllocatedImage initTextureImage(vk::ImageUsageFlags usage, const glm::u8vec4& color);
-    // Initialize a texture mipmap.
-    AllocatedImage initTextureMipmap(vk::ImageUsageFlags usage, std::vector<ImageData> data,
-                                     ColorSpace colorSpace = ColorSpace::sRGB);
-    // Initialize a texture cubemap.
-    AllocatedImage initTextureCubemap(vk::ImageUsageFlags usage, std::vector<std::vector<ImageData>> data,
+    // Read the specified Khronos texture (KTX 2.0) straight into staging space. This is thread-safe.
+    // Textures staged while other uploads are submitted must be staged into a dedicated staging buffer,
+    // since the staging ring is released in submission order.
+    StagedTexture stageKhronosTexture(const std::string& name, const std::string& model = {}, bool dedicated = false);
+    // Initialize a texture image or cubemap from the staged texture, copying all of its images at once.
+    AllocatedImage initTexture(vk::ImageUsageFlags usage, const StagedTexture& texture,
+                               ColorSpace colorSpace = ColorSpace::sRGB);
+    // Initialize a texture image or cubemap from the specified Khronos texture (KTX 2.0).
+    AllocatedImage initKhronosTexture(vk::ImageUsageFlags usage, const std::string& name, const std::string& model = {},
                                       ColorSpace colorSpace = ColorSpace::sRGB);
     // Destroy the given image.
     void destroyImage(AllocatedImage& image);
@@ -251,6 +425,48 @@ class Vulkan
 
     // === VulkanModels.cpp ========================================================================================
   private:
+    // model source and initial transformation
+    struct ModelSource
+    {
+        // model name
+        std::string name;
+        // model file extension
+        std::string extension{"gltf"};
+        // initial translation
+        glm::float3 translation{};
+        // initial rotation
+        glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+        // initial scale
+        glm::float3 scale{1.0f};
+        // Is the model streamed, i.e. preprocessed in the background after the essential models?
+        bool streamed{};
+    };
+    // preprocessed mesh data to upload
+    struct MeshUpload
+    {
+        // index data and its offset in the index buffer
+        std::pair<Data, vk::DeviceSize> indices;
+        // vertex attribute data and their offsets in the vertex buffer
+        std::vector<std::pair<Data, vk::DeviceSize>> vertices;
+    };
+    // model streamed in the background
+    struct StreamedModel
+    {
+        // model index
+        uint32_t model;
+        // staged images
+        std::vector<StagedTexture> images;
+        // preprocessed meshes
+        std::vector<MeshUpload> meshUploads;
+        // skinning data (joints, weights) per mesh, embedded before the simulation meshes are released
+        // (empty for meshes without embedding or once taken over by the preprocessed mesh)
+        std::vector<std::pair<Data, Data>> embeddings;
+        // Are the images and meshes preprocessed?
+        std::atomic<bool> preprocessed{};
+        // Is the model uploaded?
+        bool uploaded{};
+    };
+
     // glTF models
     std::vector<tinygltf::Model> _models;
     // 3D models
@@ -261,12 +477,39 @@ class Vulkan
     uint32_t skinCount{};
     // material count
     uint32_t materialCount{};
+    // streamed models (stable, since they are preprocessed in place)
+    std::deque<StreamedModel> streamedModels;
+    // background preprocessing of the streamed models
+    std::future<void> streaming;
 
-    // Load a model and define its initial transformation.
-    void loadModel(const std::string& name, const std::string& extension = "gltf", const glm::float3& translation = {},
-                   const glm::quat& rotation = {1.0f, 0.0f, 0.0f, 0.0f}, const glm::float3& scale = glm::float3{1.0f});
+    // Parse the specified glTF model.
+    static tinygltf::Model parseModel(const std::string& name, const std::string& extension);
+    // Load the models and define their initial transformations.
+    // Parse them concurrently, then load them in order.
+    void loadModels(const std::vector<ModelSource>& sources);
+    // Load a model from its parsed glTF model and define its initial transformation.
+    void loadModel(const ModelSource& source, tinygltf::Model&& parsedModel);
     // Initialize the models.
+    // Preprocess the images and meshes of the essential models concurrently, then upload them and write their
+    // descriptors. The streamed models are initialized except for their images, meshes and materials.
     void initializeModels();
+    // Upload the preprocessed images and meshes of the model, and initialize its samplers and materials.
+    // Release the glTF model afterwards.
+    void uploadModel(uint32_t modelIndex, std::vector<StagedTexture>& images, std::vector<MeshUpload>& meshUploads);
+    // Start preprocessing the streamed models in the background.
+    void startStreaming();
+    // Upload the streamed models preprocessed since the last call, and make the uploaded models resident once their
+    // uploads are complete. Rethrow the exception of a failed preprocessing.
+    void updateStreaming();
+    // Wait for the background preprocessing and release the streamed models that are not uploaded.
+    void terminateStreaming();
+    // Preprocess the specified mesh for upload, i.e. convert its vertex attributes and generate its tangents and its
+    // embedding. Meshes may be preprocessed concurrently once the model nodes are initialized.
+    // A precomputed embedding (see embedModelMesh) is taken over instead of embedding the mesh.
+    MeshUpload preprocessMesh(uint32_t modelIndex, uint32_t meshIndex, std::pair<Data, Data>* embedding = nullptr);
+    // Embed the specified mesh from its positions only. Return the joint and weight data for barycentric skinning.
+    // This must be done while the simulation meshes are loaded, i.e. before initializeSimulation releases them.
+    std::pair<Data, Data> embedModelMesh(uint32_t modelIndex, uint32_t meshIndex);
     // Get the specified model.
     Model& getModel(const std::string& name);
     // Destroy the given model.
@@ -276,27 +519,50 @@ class Vulkan
   private:
     // shader compiler
     ShaderCompiler shaderCompiler;
+    // pipeline cache (persistent across runs)
+    vk::PipelineCache pipelineCache;
     // shader modules
     std::vector<vk::ShaderModule> shaderModules;
+    // mutex of the shader modules
+    std::mutex shaderModuleMutex;
     // pipeline layouts
     vk::PipelineLayout starUpdatePipelineLayout, spatialHashPipelineLayout, spatialSortPipelineLayout,
-        spatialGroupsortPipelineLayout, spatialCollectPipelineLayout, xpbdPredictPipelineLayout,
+        spatialGroupsortPipelineLayout, spatialFixupPipelineLayout, spatialMergePipelineLayout,
+        spatialCollectPipelineLayout, xpbdPredictPipelineLayout, xpbdLraPipelineLayout, bodyBroadphasePipelineLayout,
         xpbdObjcollPipelineLayout, xpbdPcollPipelineLayout, xpbdDistPipelineLayout, xpbdVolPipelineLayout,
-        xpbdCorrectPipelineLayout, depthPipelineLayout, particleDepthPipelineLayout, lightingPipelineLayout,
-        particlePipelineLayout, skyboxPipelineLayout, postPipelineLayout, guiPipelineLayout;
+        xpbdCorrectPipelineLayout, islandSleepPipelineLayout, simStatsPipelineLayout, depthPipelineLayout,
+        particleCullPipelineLayout, particleDepthPipelineLayout, lightingPipelineLayout, particlePipelineLayout,
+        skyboxPipelineLayout, postPipelineLayout, guiPipelineLayout;
     // pipelines
     vk::Pipeline starUpdatePipeline, spatialHashPipeline, spatialSortPipeline, spatialGroupsortPipeline,
-        spatialCollectPipeline, xpbdPredictPipeline, xpbdObjcollPipeline, xpbdPcollPipeline, xpbdDistPipeline,
-        xpbdVolPipeline, xpbdCorrectPipeline, depthPipeline, particleDepthPipeline, lightingPipeline, particlePipeline,
-        skyboxPipeline, postPipeline, guiPipeline, shadowPipeline;
+        spatialFixupPipeline, spatialMergePipeline, spatialCollectPipeline, xpbdPredictPipeline, xpbdLraPipeline,
+        bodyBroadphasePipeline, xpbdObjcollPipeline, xpbdPcollPipeline, xpbdDistPipeline, xpbdVolPipeline,
+        xpbdCorrectPipeline, islandSleepPipeline, simStatsPipeline, depthPipeline, particleCullPipeline,
+        particleDepthPipeline, lightingPipeline, particlePipeline, skyboxPipeline, postPipeline, guiPipeline,
+        shadowPipeline;
     // descriptor sets
     std::array<vk::DescriptorSet, frameCount> starUpdateDescSets, spatialHashDescSets, spatialSortDescSets,
-        spatialGroupsortDescSets, spatialCollectDescSets, xpbdPredictDescSets, xpbdObjcollDescSets, xpbdPcollDescSets,
-        xpbdDistDescSets, xpbdVolDescSets, xpbdCorrectDescSets, depthDescSets, shadowDescSets, sceneDescSets,
-        inactiveSkinDescSets, particleDescSets, skyboxDescSets, postDescSets, guiDescSets;
+        spatialGroupsortDescSets, spatialFixupDescSets, spatialMergeDescSets, spatialCollectDescSets,
+        xpbdPredictDescSets, xpbdLraDescSets, bodyBroadphaseDescSets, xpbdObjcollDescSets, xpbdPcollDescSets,
+        xpbdDistDescSets, xpbdVolDescSets, xpbdCorrectDescSets, islandSleepDescSets, simStatsDescSets,
+        inactiveSkinDescSets, skyboxDescSets, postDescSets, guiDescSets;
+    // particle cull workgroup dimensions
+    WorkgroupDimensions particleCullWorkgroup{};
+    // descriptor sets per rendered particle position buffer
+    std::array<std::array<vk::DescriptorSet, frameCount>, positionBufferCount> depthDescSets, shadowDescSets,
+        particleCullDescSets, sceneDescSets, particleDescSets;
 
+    // Initialize the pipeline cache from the cache file, if it was saved for the same device.
+    void initializePipelineCache();
+    // Save the pipeline cache to the cache file.
+    void savePipelineCache();
     // Initialize the given shaders.
     std::vector<vk::PipelineShaderStageCreateInfo> initializeShaders(std::vector<Shader>& shaders);
+    // Return the shader of the given simulation kernel compiled for the given workgroup size.
+    Shader simShader(SimKernel kernel, uint32_t groupSize);
+    // Create the compute pipeline of the given simulation kernel with its current workgroup size.
+    // Specialize the simulation constants of the scene.
+    vk::Pipeline createSimPipeline(SimKernel kernel);
     // Initialize the star update pipeline.
     void initializeStarUpdatePipeline();
     // Initialize the spatial hash pipeline.
@@ -305,10 +571,18 @@ class Vulkan
     void initializeSpatialSortPipeline();
     // Initialize the spatial groupsort pipeline.
     void initializeSpatialGroupsortPipeline();
+    // Initialize the spatial fixup pipeline.
+    void initializeSpatialFixupPipeline();
+    // Initialize the spatial merge pipeline.
+    void initializeSpatialMergePipeline();
     // Initialize the spatial collect pipeline.
     void initializeSpatialCollectPipeline();
     // Initialize the XPBD predict pipeline.
     void initializeXpbdPredictPipeline();
+    // Initialize the XPBD long-range attachment pipeline.
+    void initializeXpbdLraPipeline();
+    // Initialize the body broadphase pipeline.
+    void initializeBodyBroadphasePipeline();
     // Initialize the XPBD object collide pipeline.
     void initializeXpbdObjcollPipeline();
     // Initialize the XPBD particle collide pipeline.
@@ -319,8 +593,14 @@ class Vulkan
     void initializeXpbdVolPipeline();
     // Initialize the XPBD correct pipeline.
     void initializeXpbdCorrectPipeline();
+    // Initialize the island sleep pipeline.
+    void initializeIslandSleepPipeline();
+    // Initialize the simulation statistics pipeline.
+    void initializeSimStatsPipeline();
     // Initialize the depth pipeline.
     void initializeDepthPipeline();
+    // Initialize the particle cull pipeline.
+    void initializeParticleCullPipeline();
     // Initialize the particle depth pipeline.
     void initializeParticleDepthPipeline();
     // Initialize the lighting pipeline.
@@ -368,6 +648,10 @@ class Vulkan
     glm::float4x4 skyboxModelViewProjection{1.0f};
     // render frame index
     uint32_t frameIndex{};
+    // total submitted render frame count
+    uint64_t renderCount{};
+    // render frame count of the last frame reading each rendered particle position buffer
+    std::array<uint64_t, positionBufferCount> positionReadCounts{};
 
     // Initialize the swapchain.
     void initializeSwapchain();
@@ -401,13 +685,18 @@ class Vulkan
         // storage buffer offsets
         struct
         {
-            vk::DeviceSize x{-1u}, x_{-1u}, dx{-1u}, dxE7{-1u}, v{-1u}, spat{-1u}, cell{-1u}, r{-1u}, w{-1u},
-                state{-1u}, distConstr{-1u}, volConstr{-1u};
+            std::array<vk::DeviceSize, positionBufferCount> xr{};
+            vk::DeviceSize x{-1u}, x_{-1u}, dx{-1u}, dxE7{-1u}, v{-1u}, spat{-1u}, spatMoved{-1u}, spatMerged{-1u},
+                spatArgs{-1u}, key{-1u}, cell{-1u}, r{-1u}, w{-1u}, state{-1u}, filter{-1u}, distConstr{-1u},
+                volConstr{-1u}, lraConstr{-1u}, island{-1u}, islands{-1u}, islandIdx{-1u}, bodies{-1u}, chunks{-1u},
+                args{-1u};
         } offset{};
         // storage data sizes
         struct
         {
-            vk::DeviceSize x{}, x_{}, dx{}, dxE7{}, v{}, spat{}, cell{}, r{}, w{}, state{}, distConstr{}, volConstr{};
+            vk::DeviceSize xr{}, x{}, x_{}, dx{}, dxE7{}, v{}, spat{}, spatMoved{}, spatMerged{}, spatArgs{}, key{},
+                cell{}, r{}, w{}, state{}, filter{}, distConstr{}, volConstr{}, lraConstr{}, island{}, islands{},
+                islandIdx{}, bodies{}, chunks{}, args{};
         } size{};
         // particle positions
         std::vector<glm::float4> x{};
@@ -419,10 +708,22 @@ class Vulkan
         std::vector<float> w{};
         // particle states
         std::vector<glm::uint> state{};
+        // particle collision filters
+        std::vector<glm::uint> filter{};
         // distance constraints
         std::vector<DistanceConstraint> distConstr{};
         // volume constraints
         std::vector<VolumeConstraint> volConstr{};
+        // long-range attachment constraints
+        std::vector<LongRangeAttachment> lraConstr{};
+        // particle island indices (~0: no island)
+        std::vector<glm::uint> island{};
+        // islands
+        std::vector<Island> islands{};
+        // particle indices sorted by island
+        std::vector<glm::uint> islandIdx{};
+        // bodies
+        std::vector<Body> bodies{};
     } storage{};
     // mesh data
     struct Mesh
@@ -439,10 +740,12 @@ class Vulkan
     // <model name>/<mesh name> => mesh data
     std::unordered_map<std::string, Mesh> _meshes{};
     // entity counts
-    uint32_t particleCount{}, spatCount{}, distCount{}, volCount{};
-    // workgroup dimensions
-    WorkgroupDimensions starWorkgroup{}, particleWorkgroup{}, spatWorkgroup{}, sharedSpatWorkgroup{}, distWorkgroup{},
-        volWorkgroup{};
+    uint32_t particleCount{}, spatCount{}, distCount{}, volCount{}, lraCount{}, islandCount{}, bodyCount{},
+        chunkCount{};
+    // entity counts of a batched copy of the simulated meshes
+    uint32_t batchParticleCount{}, batchDistCount{};
+    // workgroup dimensions of the simulation kernels
+    std::array<WorkgroupDimensions, simKernelCount> simWorkgroups{};
     // maximum particle radius
     float r_max{};
     // spatial grid cell size
@@ -451,10 +754,20 @@ class Vulkan
     vk::DeviceSize storageBufferSize{};
     // storage buffer
     AllocatedBuffer storageBuffer{};
-    // counter buffer size
-    vk::DeviceSize counterBufferSize{};
-    // counter buffer
-    AllocatedBuffer counterBuffer{};
+    // statistics buffer size
+    vk::DeviceSize statsBufferSize{};
+    // statistics buffer
+    AllocatedBuffer statsBuffer{};
+    // statistics readback buffers
+    std::array<AllocatedBuffer, readbackCount> statsReadbackBuffers{};
+    // update count of the last read statistics
+    uint64_t statsUpdateCount{};
+    // simulation statistics of the batched copies of the last completed update
+    std::array<SimStats, batchSize> batchSimStats{};
+    // timestamp query pool of the batched updates (2 timestamps per readback buffer, only exists if batched)
+    vk::QueryPool batchTimestampPool;
+    // batch report file, a table of the statistics per batched copy (only open if batched)
+    std::ofstream batchReport;
     // player model nodes used for collision
     std::array<Model::Node*, 18> playerCollisionNodes{};
     // player collision uniform
@@ -463,8 +776,8 @@ class Vulkan
     std::array<Model::Node*, attachmentCount> playerAttachmentNodes{};
     // attachment particle indices (initial: node tags)
     std::array<uint32_t, attachmentCount> attachmentIndices{11533, 24011};
-    // buffer copies used to update attachments
-    std::array<vk::BufferCopy, attachmentCount> attachmentCopies{};
+    // buffer copies used to update attachments (per batched copy)
+    std::vector<vk::BufferCopy> attachmentCopies{};
     // local attachment positions
     std::array<glm::float4, attachmentCount> attachmentDeltas{
         glm::float4{3.0f, -22.0f, -8.0f, 1.0f},
@@ -472,6 +785,12 @@ class Vulkan
     };
     // attachment positions
     std::array<glm::float4, attachmentCount> attachmentPositions{};
+    // islands of the attached particles per batched copy (~0: no island)
+    std::vector<uint32_t> attachmentIslands{};
+    // attachment positions when the attachment island was last woken up
+    std::array<glm::float4, attachmentCount> attachmentWakePositions{};
+    // attachment displacement waking up the attachment island
+    static constexpr float attachmentWakeDistance{1e-3f};
     // Activate the star particles?
     bool starParticlesActive{};
     // Should the star attract all star particles?
@@ -483,21 +802,90 @@ class Vulkan
 
     // Generate the star particles.
     void generateStarParticles();
-    // Load the specified mesh.
+    // Load the specified mesh. Optionally replace a tetrahedral mesh with a coarser level of detail.
+    // The particles of the mesh use the given collision filter.
     MeshEmbedding loadMesh(const std::string& model, const std::string& mesh, float compliance = 0.0f,
                            float density = 1000.0f, const std::vector<uint32_t>& staticNodes = {},
-                           const glm::float4x4& transformation = glm::float4x4{1.0f});
+                           const glm::float4x4& transformation = glm::float4x4{1.0f}, uint32_t lod = 0,
+                           glm::uint filter = bodyCollisionFilter);
+    // Generate long-range attachment constraints for the free nodes of the given (triangular) mesh node range,
+    // i.e. tethers to the static nodes with the geodesic distances along the given edges.
+    void generateLongRangeAttachments(size_t nodeOffset, size_t nodeCount, const std::unordered_set<glm::uvec2>& edges);
     // Embed the specified mesh. Fill the joint and weight data for barycentric skinning.
     void embedMesh(const std::string& model, const std::string& mesh, Data positionData, Data& jointData,
                    Data& weightData);
+    // Copy the simulated meshes for the simulation variants and apply their parameters.
+    void batchSimulation();
+    // Partition the constrained particles into islands, i.e. the connected components of the constraint graph.
+    void initializeIslands();
     // Initialize the simulation.
     void initializeSimulation();
     // Update the player.
     void updatePlayer();
+    // Return the workgroup dimensions of the given simulation kernel.
+    WorkgroupDimensions& workgroup(SimKernel kernel);
+    // Record the dispatch of the given simulation kernel to the given sim buffer.
+    // Optionally read the workgroup count from the storage buffer at the given offset (indirect dispatch).
+    void dispatch(vk::CommandBuffer& simBuffer, SimKernel kernel, vk::DeviceSize indirectOffset = -1u);
     // Record the simulation commands to the given sim buffer.
     void recordSimulation(vk::CommandBuffer& simBuffer);
+    // Read the statistics of the last completed simulation update without waiting.
+    void readSimStats();
+    // Write the statistics and the duration of the batched copies of the given completed update to the batch report.
+    void reportSimBatch(uint64_t completedUpdateCount);
 
   public:
+    // simulation statistics of the last completed update
+    SimStats simStats{};
+
     // Simulate the next update.
     void sim();
+
+    // === VulkanTuning.cpp ========================================================================================
+  private:
+    // simulation kernel description
+    struct SimKernelInfo
+    {
+        // shader name
+        std::string name;
+        // invocation count
+        uint32_t invocationCount;
+        // desired group size of the heuristic selection
+        uint32_t desiredGroupSize;
+        // shared memory size per invocation
+        uint32_t sharedSizePerInvocation;
+        // Is the group size tunable independently of other kernels?
+        bool tunable;
+        // pipeline
+        vk::Pipeline* pipeline;
+        // pipeline layout
+        vk::PipelineLayout* layout;
+    };
+    // timed simulation update count per workgroup size candidate (after one warm-up update)
+    static constexpr uint32_t tuningUpdateCount{4};
+    // initial timestamp capacity of the query pool (grown to the timed dispatches of an update)
+    static constexpr uint32_t initialTimestampCapacity{1024};
+    // Is the group size of the simulation kernel cached (or not tunable)?
+    std::array<bool, simKernelCount> cachedSimWorkgroups{};
+    // timestamp query pool (only exists while tuning)
+    vk::QueryPool timestampPool;
+    // timestamp capacity of the query pool
+    uint32_t timestampCapacity{};
+    // timestamp count of the recorded simulation update
+    uint32_t timestampCount{};
+    // timestamp count required to time all dispatches of the recorded simulation update
+    uint32_t requiredTimestampCount{};
+    // simulation kernels of the timed dispatches
+    std::vector<SimKernel> timedKernels;
+
+    // Return the description of the given simulation kernel.
+    SimKernelInfo simKernelInfo(SimKernel kernel);
+    // Return the path to the workgroup cache of the GPU, keyed by vendor, device, and driver version.
+    std::filesystem::path workgroupCachePath();
+    // Select the workgroup dimensions of the simulation kernels.
+    // Use the cached group sizes if available, or fall back to the heuristic selection.
+    void selectSimWorkgroups();
+    // Time the simulation kernels with all candidate group sizes and cache the fastest ones.
+    // Skip tuning if all group sizes are cached or if the compute queue does not support timestamps.
+    void tuneSimWorkgroups();
 };
\ No newline at end of file
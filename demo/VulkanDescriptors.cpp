@@ -82,6 +82,24 @@ void Vulkan::initializeDescriptorPool()
             .descriptorCount = 1,
             .stageFlags = ShaderStageFlagBits::eCompute,
         },
+        DescriptorSetLayoutBinding{
+            .binding = 3,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 4,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 5,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
     });
     spatialSortDescLayout = initDescriptorSetLayout({
         DescriptorSetLayoutBinding{
@@ -99,6 +117,46 @@ void Vulkan::initializeDescriptorPool()
             .stageFlags = ShaderStageFlagBits::eCompute,
         },
     });
+    spatialFixupDescLayout = initDescriptorSetLayout({
+        DescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+    });
+    spatialMergeDescLayout = initDescriptorSetLayout({
+        DescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 2,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 3,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+    });
     spatialCollectDescLayout = initDescriptorSetLayout({
         DescriptorSetLayoutBinding{
             .binding = 0,
@@ -132,6 +190,76 @@ void Vulkan::initializeDescriptorPool()
             .descriptorCount = 1,
             .stageFlags = ShaderStageFlagBits::eCompute,
         },
+        DescriptorSetLayoutBinding{
+            .binding = 3,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+    });
+    xpbdLraDescLayout = initDescriptorSetLayout({
+        DescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 2,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 3,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+    });
+    bodyBroadphaseDescLayout = initDescriptorSetLayout({
+        DescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = DescriptorType::eUniformBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 2,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 3,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 4,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 5,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
     });
     xpbdObjcollDescLayout = initDescriptorSetLayout({
         DescriptorSetLayoutBinding{
@@ -158,6 +286,36 @@ void Vulkan::initializeDescriptorPool()
             .descriptorCount = 1,
             .stageFlags = ShaderStageFlagBits::eCompute,
         },
+        DescriptorSetLayoutBinding{
+            .binding = 4,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 5,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 6,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 7,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 8,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
     });
     xpbdPcollDescLayout = initDescriptorSetLayout({
         DescriptorSetLayoutBinding{
@@ -202,6 +360,30 @@ void Vulkan::initializeDescriptorPool()
             .descriptorCount = 1,
             .stageFlags = ShaderStageFlagBits::eCompute,
         },
+        DescriptorSetLayoutBinding{
+            .binding = 7,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 8,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 9,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 10,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
     });
     xpbdDistDescLayout = initDescriptorSetLayout({
         DescriptorSetLayoutBinding{
@@ -228,6 +410,12 @@ void Vulkan::initializeDescriptorPool()
             .descriptorCount = 1,
             .stageFlags = ShaderStageFlagBits::eCompute,
         },
+        DescriptorSetLayoutBinding{
+            .binding = 4,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
     });
     xpbdVolDescLayout = initDescriptorSetLayout({
         DescriptorSetLayoutBinding{
@@ -254,6 +442,12 @@ void Vulkan::initializeDescriptorPool()
             .descriptorCount = 1,
             .stageFlags = ShaderStageFlagBits::eCompute,
         },
+        DescriptorSetLayoutBinding{
+            .binding = 4,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
     });
     xpbdCorrectDescLayout = initDescriptorSetLayout({
         DescriptorSetLayoutBinding{
@@ -293,76 +487,164 @@ void Vulkan::initializeDescriptorPool()
             .stageFlags = ShaderStageFlagBits::eCompute,
         },
     });
-    depthDescLayout = initDescriptorSetLayout(
-        {
-            DescriptorSetLayoutBinding{
-                .binding = 0,
-                .descriptorType = DescriptorType::eUniformBuffer,
-                .descriptorCount = 1,
-                .stageFlags = ShaderStageFlagBits::eVertex,
-            },
-            DescriptorSetLayoutBinding{
-                .binding = 1,
-                .descriptorType = DescriptorType::eStorageBuffer,
-                .descriptorCount = 1,
-                .stageFlags = ShaderStageFlagBits::eVertex,
-            },
-        },
-        2);
-    sceneDescLayout = initDescriptorSetLayout({
+    islandSleepDescLayout = initDescriptorSetLayout({
         DescriptorSetLayoutBinding{
             .binding = 0,
-            .descriptorType = DescriptorType::eUniformBuffer,
+            .descriptorType = DescriptorType::eStorageBuffer,
             .descriptorCount = 1,
-            .stageFlags = ShaderStageFlagBits::eFragment,
+            .stageFlags = ShaderStageFlagBits::eCompute,
         },
         DescriptorSetLayoutBinding{
             .binding = 1,
-            .descriptorType = DescriptorType::eCombinedImageSampler,
+            .descriptorType = DescriptorType::eStorageBuffer,
             .descriptorCount = 1,
-            .stageFlags = ShaderStageFlagBits::eFragment,
-            .pImmutableSamplers = &linearClampSampler,
+            .stageFlags = ShaderStageFlagBits::eCompute,
         },
         DescriptorSetLayoutBinding{
             .binding = 2,
-            .descriptorType = DescriptorType::eCombinedImageSampler,
+            .descriptorType = DescriptorType::eStorageBuffer,
             .descriptorCount = 1,
-            .stageFlags = ShaderStageFlagBits::eFragment,
-            .pImmutableSamplers = &linearClampSampler,
+            .stageFlags = ShaderStageFlagBits::eCompute,
         },
         DescriptorSetLayoutBinding{
             .binding = 3,
-            .descriptorType = DescriptorType::eCombinedImageSampler,
+            .descriptorType = DescriptorType::eStorageBuffer,
             .descriptorCount = 1,
-            .stageFlags = ShaderStageFlagBits::eFragment,
-            .pImmutableSamplers = &linearClampSampler,
+            .stageFlags = ShaderStageFlagBits::eCompute,
         },
+    });
+    simStatsDescLayout = initDescriptorSetLayout({
         DescriptorSetLayoutBinding{
-            .binding = 4,
-            .descriptorType = DescriptorType::eUniformBuffer,
+            .binding = 0,
+            .descriptorType = DescriptorType::eStorageBuffer,
             .descriptorCount = 1,
-            .stageFlags = ShaderStageFlagBits::eVertex,
+            .stageFlags = ShaderStageFlagBits::eCompute,
         },
         DescriptorSetLayoutBinding{
-            .binding = 5,
-            .descriptorType = DescriptorType::eSampledImage,
+            .binding = 1,
+            .descriptorType = DescriptorType::eStorageBuffer,
             .descriptorCount = 1,
-            .stageFlags = ShaderStageFlagBits::eFragment,
+            .stageFlags = ShaderStageFlagBits::eCompute,
         },
         DescriptorSetLayoutBinding{
-            .binding = 6,
-            .descriptorType = DescriptorType::eSampler,
+            .binding = 2,
+            .descriptorType = DescriptorType::eStorageBuffer,
             .descriptorCount = 1,
-            .stageFlags = ShaderStageFlagBits::eFragment,
-            .pImmutableSamplers = &shadowSampler,
+            .stageFlags = ShaderStageFlagBits::eCompute,
         },
         DescriptorSetLayoutBinding{
-            .binding = 7,
+            .binding = 3,
             .descriptorType = DescriptorType::eStorageBuffer,
             .descriptorCount = 1,
-            .stageFlags = ShaderStageFlagBits::eVertex,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 4,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
+        },
+        DescriptorSetLayoutBinding{
+            .binding = 5,
+            .descriptorType = DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = ShaderStageFlagBits::eCompute,
         },
     });
+    depthDescLayout = initDescriptorSetLayout(
+        {
+            DescriptorSetLayoutBinding{
+                .binding = 0,
+                .descriptorType = DescriptorType::eUniformBuffer,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eVertex,
+            },
+            DescriptorSetLayoutBinding{
+                .binding = 1,
+                .descriptorType = DescriptorType::eStorageBuffer,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eVertex,
+            },
+        },
+        2 * positionBufferCount);
+    particleCullDescLayout = initDescriptorSetLayout(
+        {
+            DescriptorSetLayoutBinding{
+                .binding = 0,
+                .descriptorType = DescriptorType::eStorageBuffer,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eCompute,
+            },
+            DescriptorSetLayoutBinding{
+                .binding = 1,
+                .descriptorType = DescriptorType::eStorageBuffer,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eCompute,
+            },
+            DescriptorSetLayoutBinding{
+                .binding = 2,
+                .descriptorType = DescriptorType::eStorageBuffer,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eCompute,
+            },
+        },
+        positionBufferCount);
+    sceneDescLayout = initDescriptorSetLayout(
+        {
+            DescriptorSetLayoutBinding{
+                .binding = 0,
+                .descriptorType = DescriptorType::eUniformBuffer,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eFragment,
+            },
+            DescriptorSetLayoutBinding{
+                .binding = 1,
+                .descriptorType = DescriptorType::eCombinedImageSampler,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eFragment,
+                .pImmutableSamplers = &linearClampSampler,
+            },
+            DescriptorSetLayoutBinding{
+                .binding = 2,
+                .descriptorType = DescriptorType::eCombinedImageSampler,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eFragment,
+                .pImmutableSamplers = &linearClampSampler,
+            },
+            DescriptorSetLayoutBinding{
+                .binding = 3,
+                .descriptorType = DescriptorType::eCombinedImageSampler,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eFragment,
+                .pImmutableSamplers = &linearClampSampler,
+            },
+            DescriptorSetLayoutBinding{
+                .binding = 4,
+                .descriptorType = DescriptorType::eUniformBuffer,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eVertex,
+            },
+            DescriptorSetLayoutBinding{
+                .binding = 5,
+                .descriptorType = DescriptorType::eSampledImage,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eFragment,
+            },
+            DescriptorSetLayoutBinding{
+                .binding = 6,
+                .descriptorType = DescriptorType::eSampler,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eFragment,
+                .pImmutableSamplers = &shadowSampler,
+            },
+            DescriptorSetLayoutBinding{
+                .binding = 7,
+                .descriptorType = DescriptorType::eStorageBuffer,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eVertex,
+            },
+        },
+        positionBufferCount);
     materialDescLayout = initDescriptorSetLayout(
         {
             DescriptorSetLayoutBinding{
@@ -413,14 +695,22 @@ void Vulkan::initializeDescriptorPool()
             },
         },
         skinCount + 1);
-    particleDescLayout = initDescriptorSetLayout({
-        DescriptorSetLayoutBinding{
-            .binding = 0,
-            .descriptorType = DescriptorType::eStorageBuffer,
-            .descriptorCount = 1,
-            .stageFlags = ShaderStageFlagBits::eVertex,
+    particleDescLayout = initDescriptorSetLayout(
+        {
+            DescriptorSetLayoutBinding{
+                .binding = 0,
+                .descriptorType = DescriptorType::eStorageBuffer,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eVertex,
+            },
+            DescriptorSetLayoutBinding{
+                .binding = 1,
+                .descriptorType = DescriptorType::eStorageBuffer,
+                .descriptorCount = 1,
+                .stageFlags = ShaderStageFlagBits::eVertex,
+            },
         },
-    });
+        positionBufferCount);
     skyboxDescLayout = initDescriptorSetLayout({
         DescriptorSetLayoutBinding{
             .binding = 0,
@@ -473,6 +763,7 @@ void Vulkan::initializeDescriptorPool()
 
 vk::DescriptorSet Vulkan::initDescriptorSet(vk::DescriptorSetLayout& layout)
 {
+    std::lock_guard lock(descPoolMutex);
     return device.allocateDescriptorSets(DescriptorSetAllocateInfo{
         .descriptorPool = descPool,
         .descriptorSetCount = 1,
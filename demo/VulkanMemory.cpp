@@ -1,5 +1,6 @@
 #include "Vulkan.h"
 
+#include "Profiler.h"
 #include "Utils.h"
 #include <set>
 
@@ -9,6 +10,27 @@
 using namespace vk;
 using namespace vma;
 
+void Vulkan::initializeUploads()
+{
+    stagingRing = createStagingBuffer(stagingRingSize, BufferUsageFlagBits::eTransferSrc);
+    mapBuffer(stagingRing);
+    constexpr SemaphoreTypeCreateInfo timelineSemaphoreType{
+        .semaphoreType = SemaphoreType::eTimeline,
+        .initialValue = 0,
+    };
+    uploadComplete = device.createSemaphore(SemaphoreCreateInfo{
+        .pNext = &timelineSemaphoreType,
+    });
+}
+
+void Vulkan::terminateUploads()
+{
+    waitUploads();
+    unmapBuffer(stagingRing);
+    destroyBuffer(stagingRing);
+    device.destroySemaphore(uploadComplete);
+}
+
 void Vulkan::activate(vk::CommandBuffer& commandBuffer)
 {
     activeBuffer = commandBuffer;
@@ -30,17 +52,137 @@ void Vulkan::setup(vk::CommandPool& commandPool, vk::CommandBuffer& commandBuffe
 void Vulkan::play(vk::Queue& queue, vk::CommandPool& commandPool, vk::CommandBuffer& commandBuffer)
 {
     commandBuffer.end();
+
+    // Wait for the previous batch, s.t. the upload timeline increases monotonically across the queues.
+    const uint64_t waitSemaphoreValue = uploadCount;
+    uploadCount++;
+    const uint64_t signalSemaphoreValue = uploadCount;
+    const TimelineSemaphoreSubmitInfo semaphoreValues{
+        .waitSemaphoreValueCount = 1,
+        .pWaitSemaphoreValues = &waitSemaphoreValue,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &signalSemaphoreValue,
+    };
+    constexpr PipelineStageFlags waitDstStage{PipelineStageFlagBits::eAllCommands};
     queue.submit(SubmitInfo{
+        .pNext = &semaphoreValues,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &uploadComplete,
+        .pWaitDstStageMask = &waitDstStage,
         .commandBufferCount = 1,
         .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &uploadComplete,
     });
-    queue.waitIdle();
-    device.freeCommandBuffers(commandPool, commandBuffer);
-    for (AllocatedBuffer& buffer : stagingBuffers)
     {
-        destroyBuffer(buffer);
+        std::lock_guard lock(stagingMutex);
+        uploadBatches.emplace_back(UploadBatch{
+            .value = signalSemaphoreValue,
+            .stagingEnd = stagingHead,
+            .commandPool = commandPool,
+            .commandBuffer = commandBuffer,
+            .stagingBuffers = std::move(activeStagingBuffers),
+        });
+        activeStagingBuffers.clear();
     }
-    stagingBuffers.clear();
+    reclaimUploads();
+}
+
+void Vulkan::reclaimUploads(uint64_t value)
+{
+    if (value > 0)
+    {
+        result = device.waitSemaphores(
+            SemaphoreWaitInfo{
+                .semaphoreCount = 1,
+                .pSemaphores = &uploadComplete,
+                .pValues = &value,
+            },
+            UINT64_MAX);
+    }
+    const uint64_t completeValue = device.getSemaphoreCounterValue(uploadComplete);
+    std::lock_guard lock(stagingMutex);
+    while (!uploadBatches.empty() && uploadBatches.front().value <= completeValue)
+    {
+        UploadBatch& batch = uploadBatches.front();
+        stagingTail = batch.stagingEnd;
+        device.freeCommandBuffers(batch.commandPool, batch.commandBuffer);
+        for (AllocatedBuffer& buffer : batch.stagingBuffers)
+        {
+            unmapBuffer(buffer);
+            destroyBuffer(buffer);
+        }
+        uploadBatches.pop_front();
+    }
+}
+
+void Vulkan::waitUploads()
+{
+    reclaimUploads(uploadCount);
+}
+
+Vulkan::Staging Vulkan::reserveStaging(vk::DeviceSize size)
+{
+    // Reserve the space after the ring head, or at the ring start if the space would wrap around the ring end.
+    // Wait for the oldest upload batches until they release enough space.
+    std::unique_lock lock(stagingMutex);
+    DeviceSize offset;
+    while (true)
+    {
+        offset = alignedSize(stagingHead, stagingAlignment);
+        if (offset % stagingRingSize + size > stagingRingSize)
+        {
+            offset = alignedSize(offset, stagingRingSize);
+        }
+        if (size > stagingRingSize || offset + size - stagingTail <= stagingRingSize || uploadBatches.empty())
+        {
+            break;
+        }
+        const uint64_t value = uploadBatches.front().value;
+        lock.unlock();
+        reclaimUploads(value);
+        lock.lock();
+    }
+    // Fall back to a dedicated staging buffer if the space is still occupied by the recorded uploads.
+    // The buffer is handed to the caller, since the uploads may be recorded on another thread than the staging.
+    if (size > stagingRingSize || offset + size - stagingTail > stagingRingSize)
+    {
+        lock.unlock();
+        return dedicatedStaging(size);
+    }
+    stagingHead = offset + size;
+    return Staging{
+        .buffer = stagingRing(),
+        .offset = offset % stagingRingSize,
+        .data = static_cast<uint8_t*>(stagingRing.data) + offset % stagingRingSize,
+    };
+}
+
+Vulkan::Staging Vulkan::dedicatedStaging(vk::DeviceSize size)
+{
+    AllocatedBuffer buffer = createStagingBuffer(size, BufferUsageFlagBits::eTransferSrc);
+    mapBuffer(buffer);
+    return Staging{
+        .buffer = buffer(),
+        .offset = 0,
+        .data = static_cast<uint8_t*>(buffer.data),
+        .dedicated = buffer,
+    };
+}
+
+void Vulkan::releaseStaging(const Staging& staging)
+{
+    if (staging.dedicated.buffer)
+    {
+        activeStagingBuffers.emplace_back(staging.dedicated);
+    }
+}
+
+Vulkan::Staging Vulkan::stage(Data data)
+{
+    Staging staging = reserveStaging(data.size);
+    memcpy(staging.data, data(), data.size);
+    return staging;
 }
 
 void Vulkan::setupGraphics()
@@ -142,13 +284,6 @@ void Vulkan::fillStagingBuffer(AllocatedBuffer& buffer, std::vector<Data> data,
     }
 }
 
-AllocatedBuffer Vulkan::initStagingBuffer(vk::BufferUsageFlags usage, Data data)
-{
-    AllocatedBuffer buffer = createStagingBuffer(data.size, usage);
-    fillStagingBuffer(buffer, data);
-    return buffer;
-}
-
 AllocatedBuffer Vulkan::createReadbackBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage)
 {
     return createBuffer(size, usage, AllocationCreateFlagBits::eHostAccessRandom);
@@ -165,11 +300,16 @@ void Vulkan::copyBuffer(AllocatedBuffer& srcBuffer, AllocatedBuffer& dstBuffer,
 
 void Vulkan::fillBuffer(AllocatedBuffer& buffer, Data data, vk::DeviceSize offset)
 {
-    AllocatedBuffer stagingBuffer = initStagingBuffer(BufferUsageFlagBits::eTransferSrc, data);
-    stagingBuffers.emplace_back(stagingBuffer);
+    Staging staging = stage(data);
+    activeBuffer.copyBuffer(staging.buffer, buffer(),
+                            BufferCopy{
+                                .srcOffset = staging.offset,
+                                .dstOffset = offset,
+                                .size = data.size,
+                            });
+    releaseStaging(staging);
     if (data.alloc)
         data.free();
-    copyBuffer(stagingBuffer, buffer, offset);
 }
 
 AllocatedBuffer Vulkan::initBuffer(vk::BufferUsageFlags usage, Data data)
@@ -187,10 +327,19 @@ AllocatedBuffer Vulkan::initBuffer(vk::BufferUsageFlags usage, std::vector<Data>
         size += d.size;
     }
     AllocatedBuffer buffer = createBuffer(size, usage | BufferUsageFlagBits::eTransferDst);
-    AllocatedBuffer stagingBuffer = createStagingBuffer(size, BufferUsageFlagBits::eTransferSrc);
-    fillStagingBuffer(stagingBuffer, data);
-    stagingBuffers.emplace_back(stagingBuffer);
-    copyBuffer(stagingBuffer, buffer);
+    Staging staging = reserveStaging(size);
+    uint8_t* dst = staging.data;
+    for (Data& d : data)
+    {
+        memcpy(dst, d(), d.size);
+        dst += d.size;
+    }
+    activeBuffer.copyBuffer(staging.buffer, buffer(),
+                            BufferCopy{
+                                .srcOffset = staging.offset,
+                                .size = size,
+                            });
+    releaseStaging(staging);
     return buffer;
 }
 
@@ -418,12 +567,12 @@ void Vulkan::transitionImageLayout(AllocatedImage& image, vk::ImageLayout oldLay
                                  });
 }
 
-void Vulkan::copyBufferToImage(AllocatedBuffer& buffer, AllocatedImage& image, uint32_t width, uint32_t height,
-                               uint32_t mipLevel, uint32_t layer)
+void Vulkan::copyBufferToImage(vk::Buffer& buffer, AllocatedImage& image, uint32_t width, uint32_t height,
+                               uint32_t mipLevel, uint32_t layer, vk::DeviceSize offset)
 {
-    activeBuffer.copyBufferToImage(buffer(), image(), ImageLayout::eTransferDstOptimal,
+    activeBuffer.copyBufferToImage(buffer, image(), ImageLayout::eTransferDstOptimal,
                                    BufferImageCopy{
-                                       .bufferOffset = 0,
+                                       .bufferOffset = offset,
                                        .bufferRowLength = 0,
                                        .bufferImageHeight = 0,
                                        .imageSubresource =
@@ -460,18 +609,19 @@ void Vulkan::copyImageToBuffer(AllocatedImage& image, AllocatedBuffer& buffer, u
 
 void Vulkan::fillImage(AllocatedImage& image, ImageData data, uint32_t mipLevel, uint32_t layer)
 {
-    AllocatedBuffer stagingBuffer = initStagingBuffer(BufferUsageFlagBits::eTransferSrc, data);
-    stagingBuffers.emplace_back(stagingBuffer);
+    Staging staging = stage(data);
     if (data.alloc)
         data.free();
-    copyBufferToImage(stagingBuffer, image, data.width, data.height, mipLevel, layer);
+    copyBufferToImage(staging.buffer, image, data.width, data.height, mipLevel, layer, staging.offset);
+    releaseStaging(staging);
 }
 
 AllocatedImage Vulkan::initTextureImage(vk::ImageUsageFlags usage, ImageData data, ColorSpace colorSpace)
 {
     AllocatedImage image =
         createImage(ImageViewType::e2D, data.width, data.height, 1, 1, SampleCountFlagBits::e1,
-                    textureFormat(colorSpace), ImageTiling::eOptimal, usage | ImageUsageFlagBits::eTransferDst);
+                    textureFormat(data.format, colorSpace), ImageTiling::eOptimal,
+                    usage | ImageUsageFlagBits::eTransferDst);
     transitionImageLayout(image, ImageLayout::eUndefined, ImageLayout::eTransferDstOptimal);
     fillImage(image, data);
     transitionImageLayout(image, ImageLayout::eTransferDstOptimal, ImageLayout::eShaderReadOnlyOptimal);
@@ -491,40 +641,65 @@ AllocatedImage Vulkan::initTextureImage(vk::ImageUsageFlags usage, const glm::u8
     return initTextureImage(usage, data, ColorSpace::linear);
 }
 
-AllocatedImage Vulkan::initTextureMipmap(vk::ImageUsageFlags usage, std::vector<ImageData> data, ColorSpace colorSpace)
+Vulkan::StagedTexture Vulkan::stageKhronosTexture(const std::string& name, const std::string& model, bool dedicated)
 {
-    const uint32_t mipLevelCount = data.size();
-    AllocatedImage image =
-        createImage(ImageViewType::e2D, data[0].width, data[0].height, mipLevelCount, 1, SampleCountFlagBits::e1,
-                    textureFormat(colorSpace), ImageTiling::eOptimal, usage | ImageUsageFlagBits::eTransferDst);
-    transitionImageLayout(image, ImageLayout::eUndefined, ImageLayout::eTransferDstOptimal);
-    for (uint32_t i = 0; i < mipLevelCount; i++)
-    {
-        fillImage(image, data[i], i);
-    }
-    transitionImageLayout(image, ImageLayout::eTransferDstOptimal, ImageLayout::eShaderReadOnlyOptimal);
-    return image;
+    Profiler::Scope scope("stage texture", model.empty() ? name : model + "/" + name);
+    StagedTexture texture;
+    texture.layout = ImageData::readKhronosTexture(
+        name, model, textureCompression, [this, &texture, dedicated](size_t size) -> uint8_t* {
+            texture.staging = dedicated ? dedicatedStaging(size) : reserveStaging(size);
+            return texture.staging.data;
+        });
+    return texture;
 }
 
-AllocatedImage Vulkan::initTextureCubemap(vk::ImageUsageFlags usage, std::vector<std::vector<ImageData>> data,
-                                          ColorSpace colorSpace)
+AllocatedImage Vulkan::initTexture(vk::ImageUsageFlags usage, const StagedTexture& texture, ColorSpace colorSpace)
 {
-    const uint32_t mipLevelCount = data[0].size();
-    AllocatedImage image = createImage(ImageViewType::eCube, data[0][0].width, data[0][0].height, mipLevelCount, 6,
-                                       SampleCountFlagBits::e1, textureFormat(colorSpace), ImageTiling::eOptimal,
+    const TextureLayout& layout = texture.layout;
+    const uint32_t faceCount = layout.offsets.size();
+    const uint32_t mipLevelCount = layout.offsets[0].size();
+    AllocatedImage image = createImage((faceCount == 6) ? ImageViewType::eCube : ImageViewType::e2D, layout.width,
+                                       layout.height, mipLevelCount, faceCount, SampleCountFlagBits::e1,
+                                       textureFormat(layout.format, colorSpace), ImageTiling::eOptimal,
                                        usage | ImageUsageFlagBits::eTransferDst);
-    transitionImageLayout(image, ImageLayout::eUndefined, ImageLayout::eTransferDstOptimal);
-    for (uint32_t i = 0; i < 6; i++)
+
+    // Copy the images from the staging space with one region per face and mip level.
+    std::vector<BufferImageCopy> regions;
+    regions.reserve(faceCount * mipLevelCount);
+    for (uint32_t face = 0; face < faceCount; face++)
     {
-        for (uint32_t j = 0; j < mipLevelCount; j++)
+        for (uint32_t mipLevel = 0; mipLevel < mipLevelCount; mipLevel++)
         {
-            fillImage(image, data[i][j], j, i);
+            regions.emplace_back(BufferImageCopy{
+                .bufferOffset = texture.staging.offset + layout.offsets[face][mipLevel],
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource =
+                    ImageSubresourceLayers{
+                        .aspectMask = ImageAspectFlagBits::eColor,
+                        .mipLevel = mipLevel,
+                        .baseArrayLayer = face,
+                        .layerCount = 1,
+                    },
+                .imageOffset = {0, 0, 0},
+                .imageExtent = {static_cast<uint32_t>(std::max(layout.width >> mipLevel, 1)),
+                                static_cast<uint32_t>(std::max(layout.height >> mipLevel, 1)), 1},
+            });
         }
     }
+    transitionImageLayout(image, ImageLayout::eUndefined, ImageLayout::eTransferDstOptimal);
+    activeBuffer.copyBufferToImage(texture.staging.buffer, image(), ImageLayout::eTransferDstOptimal, regions);
     transitionImageLayout(image, ImageLayout::eTransferDstOptimal, ImageLayout::eShaderReadOnlyOptimal);
+    releaseStaging(texture.staging);
     return image;
 }
 
+AllocatedImage Vulkan::initKhronosTexture(vk::ImageUsageFlags usage, const std::string& name, const std::string& model,
+                                          ColorSpace colorSpace)
+{
+    return initTexture(usage, stageKhronosTexture(name, model), colorSpace);
+}
+
 void Vulkan::destroyImage(AllocatedImage& image)
 {
     device.destroyImageView(image.view);
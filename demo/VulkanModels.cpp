@@ -1,6 +1,10 @@
 #include "Vulkan.h"
 
+#include "Archive.h"
+#include "MappedFile.h"
+#include "Profiler.h"
 #include "TangentSpace.h"
+#include "TaskGraph.h"
 #include "Vertex.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
@@ -11,22 +15,36 @@
 namespace fs = std::filesystem;
 using namespace vk;
 
-void Vulkan::loadModel(const std::string& name, const std::string& extension, const glm::float3& translation,
-                       const glm::quat& rotation, const glm::float3& scale)
+tinygltf::Model Vulkan::parseModel(const std::string& name, const std::string& extension)
 {
-    // Load the glTF model.
+    Profiler::Scope scope("parse model", name);
     bool success;
     tinygltf::TinyGLTF tinyGLTF;
     tinygltf::Model _model;
     std::string error, warning;
     const std::string path = modelPath(name, extension).string();
-    if (extension == "gltf")
+    if (const Data blob = Archive::assets().find(path); blob.data)
     {
-        success = tinyGLTF.LoadASCIIFromFile(&_model, &error, &warning, path);
+        // The archived model is baked to binary glTF with embedded buffers.
+        success = tinyGLTF.LoadBinaryFromMemory(&_model, &error, &warning, static_cast<const unsigned char*>(blob.data),
+                                                static_cast<unsigned int>(blob.size));
     }
     else if (extension == "glb")
     {
-        success = tinyGLTF.LoadBinaryFromFile(&_model, &error, &warning, path);
+        // Map the binary glTF instead of reading it into a temporary copy.
+        const MappedFile file(path);
+        const Data data = file.data();
+        if (!data.data)
+        {
+            throw std::runtime_error("Failed to load model [" + name + "]: missing file " + path);
+        }
+        success = tinyGLTF.LoadBinaryFromMemory(&_model, &error, &warning, static_cast<const unsigned char*>(data.data),
+                                                static_cast<unsigned int>(data.size),
+                                                fs::path(path).parent_path().string());
+    }
+    else if (extension == "gltf")
+    {
+        success = tinyGLTF.LoadASCIIFromFile(&_model, &error, &warning, path);
     }
     else
     {
@@ -40,16 +58,42 @@ void Vulkan::loadModel(const std::string& name, const std::string& extension, co
     {
         throw std::runtime_error("Failed to load model [" + name + "]" + (error.empty() ? "" : (": " + error)));
     }
-    _models.emplace_back(_model);
+    return _model;
+}
+
+void Vulkan::loadModels(const std::vector<ModelSource>& sources)
+{
+    Profiler::Scope scope("load models");
+    // Parse the glTF models concurrently on a pool of threads.
+    std::vector<tinygltf::Model> parsedModels(sources.size());
+    TaskGraph parsing;
+    for (uint32_t i = 0; i < sources.size(); i++)
+    {
+        parsing.add([&, i]() { parsedModels[i] = parseModel(sources[i].name, sources[i].extension); });
+    }
+    parsing.run();
+
+    // Load the models in order, since they reserve consecutive buffer ranges and simulation storage.
+    for (uint32_t i = 0; i < sources.size(); i++)
+    {
+        loadModel(sources[i], std::move(parsedModels[i]));
+    }
+}
+
+void Vulkan::loadModel(const ModelSource& source, tinygltf::Model&& parsedModel)
+{
+    Profiler::Scope scope("load model", source.name);
+    _models.emplace_back(std::move(parsedModel));
+    const tinygltf::Model& _model = _models.back();
 
     // Create the 3D model.
     Model model{
-        .name = name,
-        .translation = translation,
-        .rotation = rotation,
-        .scale = scale,
+        .name = source.name,
+        .translation = source.translation,
+        .rotation = source.rotation,
+        .scale = source.scale,
     };
-    modelNamesToIndices[name] = models.size();
+    modelNamesToIndices[model.name] = models.size();
 
     // Create the meshes.
     model.meshes.reserve(_model.meshes.size());
@@ -87,8 +131,24 @@ void Vulkan::loadModel(const std::string& name, const std::string& extension, co
                     staticNodes.emplace_back(staticValues.Get(i).GetNumberAsInt());
                 }
             }
+            uint32_t lod{};
+            if (extras.Has("lod"))
+            {
+                lod = extras.Get("lod").GetNumberAsInt();
+            }
+            glm::uint collisionGroup{static_cast<glm::uint>(CollisionGroup::BODY)};
+            if (extras.Has("collisionGroup"))
+            {
+                collisionGroup = extras.Get("collisionGroup").GetNumberAsInt();
+            }
+            glm::uint collisionMask{static_cast<glm::uint>(CollisionGroup::ALL)};
+            if (extras.Has("collisionMask"))
+            {
+                collisionMask = extras.Get("collisionMask").GetNumberAsInt();
+            }
             mesh.embedding = loadMesh(model.name, mesh.name, compliance, density, staticNodes,
-                                      compose(translation, rotation, scale));
+                                      compose(model.translation, model.rotation, model.scale), lod + meshLodBias,
+                                      collisionFilter(collisionGroup, collisionMask));
         }
         if (_mesh.primitives.size() != 1)
         {
@@ -197,20 +257,22 @@ void Vulkan::loadModel(const std::string& name, const std::string& extension, co
         model.animations.emplace_back(animation);
     }
 
+    // Register the streamed model, it is preprocessed in the background (see startStreaming).
+    if (source.streamed)
+    {
+        streamedModels.emplace_back().model = static_cast<uint32_t>(models.size());
+    }
     models.emplace_back(model);
 }
 
 void Vulkan::initializeModels()
 {
-    SMikkTSpaceInterface tsInterface = TangentSpace::Interface();
-
-    setupGraphics();
+    Profiler::Scope scope("initialize models");
+    // Initialize the nodes, which the mesh embeddings depend on.
     for (uint32_t i = 0; i < models.size(); i++)
     {
         tinygltf::Model& _model = _models[i];
         Model& model = models[i];
-
-        // Initialize the nodes.
         for (uint32_t j = 0; j < model.nodes.size(); j++)
         {
             const tinygltf::Node& _node = _model.nodes[j];
@@ -258,523 +320,18 @@ void Vulkan::initializeModels()
             model.root = &model.nodes[0];
         }
         model.update();
-
-        // Initialize the samplers.
-        model.samplers.reserve(_model.samplers.size());
-        for (const tinygltf::Sampler& _sampler : _model.samplers)
-        {
-            SamplerCreateInfo sampler = gpu.sampler();
-            if (_sampler.magFilter == TINYGLTF_TEXTURE_FILTER_NEAREST)
-            {
-                sampler.magFilter = Filter::eNearest;
-            }
-            if (_sampler.minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST ||
-                _sampler.minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST ||
-                _sampler.minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR)
-            {
-                sampler.minFilter = Filter::eNearest;
-            }
-            if (_sampler.minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST ||
-                _sampler.minFilter == TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST)
-            {
-                sampler.mipmapMode = SamplerMipmapMode::eNearest;
-            }
-            if (_sampler.wrapS == TINYGLTF_TEXTURE_WRAP_MIRRORED_REPEAT)
-            {
-                sampler.addressModeU = SamplerAddressMode::eMirroredRepeat;
-            }
-            else if (_sampler.wrapS == TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE)
-            {
-                sampler.addressModeU = SamplerAddressMode::eClampToEdge;
-            }
-            if (_sampler.wrapT == TINYGLTF_TEXTURE_WRAP_MIRRORED_REPEAT)
-            {
-                sampler.addressModeV = sampler.addressModeW = SamplerAddressMode::eMirroredRepeat;
-            }
-            else if (_sampler.wrapT == TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE)
-            {
-                sampler.addressModeV = sampler.addressModeW = SamplerAddressMode::eClampToEdge;
-            }
-            model.samplers.emplace_back(device.createSampler(sampler));
-        }
-
-        // Load the image data.
-        std::vector<std::vector<ImageData>> images;
-        images.reserve(_model.images.size());
-        for (const tinygltf::Image& _image : _model.images)
-        {
-            const std::string name = fs::path(_image.uri).stem().string();
-            images.emplace_back(ImageData::loadKhronosTexture(name, model.name)[0]);
-        }
-        model.images.resize(images.size());
-        std::vector<bool> initializedImage(images.size(), false);
-
-        // Load the texture infos.
-        struct Texture
-        {
-            vk::Sampler& sampler;
-            uint32_t image;
-        };
-        std::vector<Texture> textures;
-        textures.reserve(_model.textures.size());
-        for (const tinygltf::Texture& _texture : _model.textures)
-        {
-            if (_texture.source == -1)
-            {
-                throw std::runtime_error("Failed to initialize model [" + model.name + "]: texture without source");
-            }
-            textures.emplace_back(Texture{
-                .sampler = (_texture.sampler == -1) ? linearRepeatAniSampler : model.samplers[_texture.sampler],
-                .image = static_cast<uint32_t>(_texture.source),
-            });
-        }
-
-        // Initialize the textures and the materials.
-        for (uint32_t j = 0; j < model.materials.size(); j++)
-        {
-            const tinygltf::Material& _material = _model.materials[j];
-            Model::Material& material = model.materials[j];
-            material.name = _material.name;
-            model.materialNamesToIndices[material.name] = j;
-            material.descSets = initDescriptorSets(materialDescLayout);
-            const auto initializeMaterialTexture = [&](uint32_t index, uint32_t binding,
-                                                       ColorSpace colorSpace = ColorSpace::sRGB) -> void {
-                uint32_t image = textures[index].image;
-                if (!initializedImage[image])
-                {
-                    model.images[image] = initTextureMipmap(ImageUsageFlagBits::eSampled, images[image], colorSpace);
-                    initializedImage[image] = true;
-                }
-                for (DescriptorSet& set : material.descSets)
-                {
-                    setCombinedImageSampler(textures[index].sampler, model.images[image], set, binding);
-                }
-            };
-            const auto initializeWhiteTexture = [&](uint32_t binding) -> void {
-                for (DescriptorSet& set : material.descSets)
-                {
-                    setCombinedImageSampler(linearRepeatSampler, whiteImage, set, binding);
-                }
-            };
-            // pbrSpecularGlossiness
-            if (_material.extensions.contains("KHR_materials_pbrSpecularGlossiness"))
-            {
-                material.uniform.workflow = static_cast<glm::uint>(MaterialUniform::PbrWorkflow::SpecularGlossiness);
-                const auto& pbrSpecularGlossiness = _material.extensions.at("KHR_materials_pbrSpecularGlossiness");
-                // diffuseFactor
-                if (pbrSpecularGlossiness.Has("diffuseFactor"))
-                {
-                    const auto& diffuseFactor = pbrSpecularGlossiness.Get("diffuseFactor");
-                    for (uint32_t i = 0; i < 4; i++)
-                    {
-                        material.uniform.colorFactor[i] = diffuseFactor.Get(i).GetNumberAsDouble();
-                    }
-                }
-                // diffuseTexture
-                if (pbrSpecularGlossiness.Has("diffuseTexture"))
-                {
-                    const auto& diffuseTexture = pbrSpecularGlossiness.Get("diffuseTexture");
-                    uint32_t index = diffuseTexture.Get("index").GetNumberAsInt();
-                    initializeMaterialTexture(index, 0, ColorSpace::sRGB);
-                    if (diffuseTexture.Has("texCoord"))
-                    {
-                        material.uniform.colorTexcoord = diffuseTexture.Get("texCoord").GetNumberAsInt();
-                    }
-                }
-                else
-                {
-                    initializeWhiteTexture(0);
-                }
-                // specularFactor
-                if (pbrSpecularGlossiness.Has("specularFactor"))
-                {
-                    const auto& specularFactor = pbrSpecularGlossiness.Get("specularFactor");
-                    for (uint32_t i = 0; i < 3; i++)
-                    {
-                        material.uniform.pbrFactor[i] = specularFactor.Get(i).GetNumberAsDouble();
-                    }
-                }
-                // glossinessFactor
-                if (pbrSpecularGlossiness.Has("glossinessFactor"))
-                {
-                    const auto& glossinessFactor = pbrSpecularGlossiness.Get("glossinessFactor");
-                    material.uniform.pbrFactor[3] = glossinessFactor.GetNumberAsDouble();
-                }
-                // specularGlossinessTexture
-                if (pbrSpecularGlossiness.Has("specularGlossinessTexture"))
-                {
-                    const auto& specularGlossinessTexture = pbrSpecularGlossiness.Get("specularGlossinessTexture");
-                    uint32_t index = specularGlossinessTexture.Get("index").GetNumberAsInt();
-                    initializeMaterialTexture(index, 1, ColorSpace::sRGB);
-                    if (specularGlossinessTexture.Has("texCoord"))
-                    {
-                        material.uniform.pbrTexcoord = specularGlossinessTexture.Get("texCoord").GetNumberAsInt();
-                    }
-                }
-                else
-                {
-                    initializeWhiteTexture(1);
-                }
-            }
-            // pbrMetallicRoughness
-            else
-            {
-                material.uniform.workflow = static_cast<glm::uint>(MaterialUniform::PbrWorkflow::MetallicRoughness);
-                const tinygltf::PbrMetallicRoughness& pbrMetallicRoughness = _material.pbrMetallicRoughness;
-                // baseColorFactor
-                for (uint32_t i = 0; i < 4; i++)
-                {
-                    material.uniform.colorFactor[i] = pbrMetallicRoughness.baseColorFactor[i];
-                }
-                // baseColorTexture
-                if (pbrMetallicRoughness.baseColorTexture.index != -1)
-                {
-                    initializeMaterialTexture(pbrMetallicRoughness.baseColorTexture.index, 0, ColorSpace::sRGB);
-                }
-                else
-                {
-                    initializeWhiteTexture(0);
-                }
-                material.uniform.colorTexcoord = pbrMetallicRoughness.baseColorTexture.texCoord;
-                // metallicFactor
-                material.uniform.pbrFactor.b = pbrMetallicRoughness.metallicFactor;
-                // roughnessFactor
-                material.uniform.pbrFactor.g = pbrMetallicRoughness.roughnessFactor;
-                // metallicRoughnessTexture
-                if (pbrMetallicRoughness.metallicRoughnessTexture.index != -1)
-                {
-                    initializeMaterialTexture(pbrMetallicRoughness.metallicRoughnessTexture.index, 1,
-                                              ColorSpace::linear);
-                }
-                else
-                {
-                    initializeWhiteTexture(1);
-                }
-                material.uniform.pbrTexcoord = pbrMetallicRoughness.metallicRoughnessTexture.texCoord;
-            }
-            // normalTexture
-            if (_material.normalTexture.index != -1)
-            {
-                initializeMaterialTexture(_material.normalTexture.index, 2, ColorSpace::linear);
-            }
-            else
-            {
-                for (DescriptorSet& set : material.descSets)
-                {
-                    setCombinedImageSampler(linearRepeatSampler, blueImage, set, 2);
-                }
-            }
-            material.uniform.normalTexcoord = _material.normalTexture.texCoord;
-            material.uniform.normalScale = _material.normalTexture.scale;
-            // occlusionTexture
-            if (_material.occlusionTexture.index != -1)
-            {
-                initializeMaterialTexture(_material.occlusionTexture.index, 3, ColorSpace::linear);
-            }
-            else
-            {
-                initializeWhiteTexture(3);
-            }
-            material.uniform.occlusionTexcoord = _material.occlusionTexture.texCoord;
-            material.uniform.occlusionStrength = _material.occlusionTexture.strength;
-            // emissiveTexture
-            if (_material.emissiveTexture.index != -1)
-            {
-                initializeMaterialTexture(_material.emissiveTexture.index, 4, ColorSpace::sRGB);
-            }
-            else
-            {
-                initializeWhiteTexture(4);
-            }
-            material.uniform.emissiveTexcoord = _material.emissiveTexture.texCoord;
-            // emissiveFactor
-            for (uint32_t i = 0; i < 3; i++)
-            {
-                material.uniform.emissiveFactor[i] = _material.emissiveFactor[i];
-            }
-
-            // Initialize the uniforms.
-            if (material.variable)
-            {
-                for (uint32_t k = 0; k < frameCount; k++)
-                {
-                    setUniformBuffer(varUniformBuffers[k], material.uniformOffset, sizeof(MaterialUniform),
-                                     material.descSets[k], 5);
-                    varUniformBuffers[k].set(material.uniform, material.uniformOffset);
-                }
-            }
-            else
-            {
-                fillBuffer(constUniformBuffer, Data::of(material.uniform), material.uniformOffset);
-                for (DescriptorSet& set : material.descSets)
-                {
-                    setUniformBuffer(constUniformBuffer, material.uniformOffset, sizeof(MaterialUniform), set, 5);
-                }
-            }
-        }
-
-        // Initialize the meshes.
         for (uint32_t j = 0; j < model.meshes.size(); j++)
         {
-            const tinygltf::Mesh& _mesh = _model.meshes[j];
-            Model::Mesh& mesh = model.meshes[j];
-            model.meshNamesToIndices[mesh.name] = j;
-            const tinygltf::Primitive& _primitive = _mesh.primitives[0];
-            TangentSpace::UserData tsData;
-            if (_primitive.material != -1)
-            {
-                mesh.material = &model.materials[_primitive.material];
-            }
-            else
-            {
-                throw std::runtime_error("Failed to initialize model [" + model.name + "]: missing material");
-            }
-            if (_primitive.mode != TINYGLTF_MODE_TRIANGLES)
-            {
-                throw std::runtime_error("Failed to initialize model [" + model.name +
-                                         "]: unsupported primitive topology");
-            }
-            // Initialize the indices.
-            if (_primitive.indices != -1)
-            {
-                const tinygltf::Accessor& _accessor = _model.accessors[_primitive.indices];
-                tsData.faceCount = mesh.indexCount / 3;
-                switch (_accessor.componentType)
-                {
-                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-                    mesh.indexType = IndexType::eUint32;
-                    tsData.indexSize = 4;
-                    break;
-                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                    mesh.indexType = IndexType::eUint16;
-                    tsData.indexSize = 2;
-                    break;
-                default:
-                    throw std::runtime_error("Failed to initialize model [" + model.name + "]: unsupported index type");
-                }
-                const tinygltf::BufferView& _bufferView = _model.bufferViews[_accessor.bufferView];
-                tinygltf::Buffer& _buffer = _model.buffers[_bufferView.buffer];
-                tsData.indices = Data{
-                    .data = &_buffer.data[_accessor.byteOffset + _bufferView.byteOffset],
-                    .size = mesh.indexCount * tsData.indexSize,
-                };
-                fillBuffer(indexBuffer, tsData.indices, mesh.indexOffset);
-            }
-            else
-            {
-                throw std::runtime_error("Failed to initialize model [" + model.name + "]: missing indices");
-            }
-            // Initialize the vertex attributes.
-            const auto initializeVertexAttribute =
-                [&]<typename srcValT, typename dstVecT>(const std::string& name, DeviceSize offset,
-                                                        dstVecT (*make_vec)(const srcValT* const)) -> void {
-                const tinygltf::Accessor& _accessor = _model.accessors[_primitive.attributes.at(name)];
-                const tinygltf::BufferView& _bufferView = _model.bufferViews[_accessor.bufferView];
-                tinygltf::Buffer& _buffer = _model.buffers[_bufferView.buffer];
-                const size_t stride = _accessor.ByteStride(_bufferView) / sizeof(srcValT);
-                const size_t size = mesh.vertexCount * sizeof(dstVecT);
-                Data data = Data::allocate(size);
-                srcValT* src = reinterpret_cast<srcValT*>(&_buffer.data[_accessor.byteOffset + _bufferView.byteOffset]);
-                dstVecT* dst = static_cast<dstVecT*>(data());
-                for (uint32_t k = 0; k < mesh.vertexCount; k++)
-                {
-                    dst[k] = make_vec(&src[k * stride]);
-                }
-                if (name == "POSITION" || name == "NORMAL" ||
-                    name == ("TEXCOORD_" + std::to_string(mesh.material->uniform.normalTexcoord)))
-                {
-                    data.alloc = false;
-                    if (name == "POSITION")
-                        tsData.positions = data;
-                    else if (name == "NORMAL")
-                        tsData.normals = data;
-                    else
-                        tsData.texcoords = data;
-                }
-                fillBuffer(vertexBuffer, data, offset);
-            };
-            // position
-            if (_primitive.attributes.contains("POSITION"))
-            {
-                initializeVertexAttribute("POSITION", mesh.positionOffset, glm::make_vec3<float>);
-            }
-            else
-            {
-                throw std::runtime_error("Failed to initialize model [" + model.name + "]: missing positions");
-            }
-            // normal
-            if (_primitive.attributes.contains("NORMAL"))
-            {
-                initializeVertexAttribute("NORMAL", mesh.normalOffset, glm::make_vec3<float>);
-            }
-            else
-            {
-                throw std::runtime_error("Failed to initialize model [" + model.name + "]: missing normals");
-            }
-            // texcoord
-            for (uint32_t k = 0; k < 5; k++)
-            {
-                const std::string name = "TEXCOORD_" + std::to_string(k);
-                if (_primitive.attributes.contains(name))
-                {
-                    const tinygltf::Accessor& _accessor = _model.accessors[_primitive.attributes.at(name)];
-                    switch (_accessor.componentType)
-                    {
-                    case TINYGLTF_COMPONENT_TYPE_FLOAT:
-                        initializeVertexAttribute(name, mesh.texcoordOffset[k], glm::make_vec2<float>);
-                        break;
-                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-                        initializeVertexAttribute(
-                            name, mesh.texcoordOffset[k], +[](const uint8_t* const ptr) -> glm::float2 {
-                                return glm::float2(glm::make_vec2(ptr)) / 255.0f;
-                            });
-                        break;
-                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                        initializeVertexAttribute(
-                            name, mesh.texcoordOffset[k], +[](const uint16_t* const ptr) -> glm::float2 {
-                                return glm::float2(glm::make_vec2(ptr)) / 65535.0f;
-                            });
-                        break;
-                    default:
-                        throw std::runtime_error("Failed to initialize model [" + model.name +
-                                                 "]: unsupported texcoord type");
-                    }
-                }
-                else
-                {
-                    mesh.texcoordOffset[k] = whiteVertexOffset;
-                }
-            }
-            // tangent
-            tsData.tangents = Data::allocate(mesh.vertexCount * sizeof(Vertex::tangent));
-            TangentSpace::generate(tsInterface, tsData);
-            fillBuffer(vertexBuffer, tsData.tangents, mesh.tangentOffset);
-            if (mesh.embedding == MeshEmbedding::none)
-            {
-                tsData.positions.free();
-            }
-            tsData.normals.free();
-            tsData.texcoords.free();
-            // color
-            if (_primitive.attributes.contains("COLOR_0"))
-            {
-                const tinygltf::Accessor& _accessor = _model.accessors[_primitive.attributes.at("COLOR_0")];
-                const bool hasAlpha = (_accessor.type == TINYGLTF_TYPE_VEC4);
-                switch (_accessor.componentType)
-                {
-                case TINYGLTF_COMPONENT_TYPE_FLOAT:
-                    initializeVertexAttribute(
-                        "COLOR_0", mesh.colorOffset,
-                        hasAlpha ? +[](const float* const ptr) -> glm::float4 { return glm::make_vec4(ptr); }
-                                 : +[](const float* const ptr) -> glm::float4 {
-                                       return {glm::make_vec3(ptr), 1.0f};
-                                   });
-                    break;
-                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-                    initializeVertexAttribute(
-                        "COLOR_0", mesh.colorOffset,
-                        hasAlpha ? +[](const uint8_t* const ptr)
-                                       -> glm::float4 { return glm::float4(glm::make_vec4(ptr)) / 255.0f; }
-                                 : +[](const uint8_t* const ptr) -> glm::float4 {
-                                       return {glm::float3(glm::make_vec3(ptr)) / 255.0f, 1.0f};
-                                   });
-                    break;
-                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                    initializeVertexAttribute(
-                        "COLOR_0", mesh.colorOffset,
-                        hasAlpha ? +[](const uint16_t* const ptr)
-                                       -> glm::float4 { return glm::float4(glm::make_vec4(ptr)) / 65535.0f; }
-                                 : +[](const uint16_t* const ptr) -> glm::float4 {
-                                       return {glm::float3(glm::make_vec3(ptr)) / 65535.0f, 1.0f};
-                                   });
-                    break;
-                default:
-                    throw std::runtime_error("Failed to initialize model [" + model.name + "]: unsupported color type");
-                }
-            }
-            else
-            {
-                mesh.colorOffset = whiteVertexOffset;
-            }
-            if (mesh.embedding != MeshEmbedding::none)
-            {
-                // Generate the mesh embedding.
-                Data jointData, weightData;
-                embedMesh(model.name, mesh.name, tsData.positions, jointData, weightData);
-                fillBuffer(vertexBuffer, jointData, mesh.jointsOffset);
-                fillBuffer(vertexBuffer, weightData, mesh.weightsOffset);
-                tsData.positions.free();
-            }
-            else
-            {
-                // joints
-                if (_primitive.attributes.contains("JOINTS_0"))
-                {
-                    const tinygltf::Accessor& _accessor = _model.accessors[_primitive.attributes.at("JOINTS_0")];
-                    switch (_accessor.componentType)
-                    {
-                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-                        initializeVertexAttribute(
-                            "JOINTS_0", mesh.jointsOffset,
-                            +[](const uint8_t* const ptr) -> glm::uvec4 { return glm::make_vec4(ptr); });
-                        break;
-                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                        initializeVertexAttribute(
-                            "JOINTS_0", mesh.jointsOffset,
-                            +[](const uint16_t* const ptr) -> glm::uvec4 { return glm::make_vec4(ptr); });
-                        break;
-                    default:
-                        throw std::runtime_error("Failed to initialize model [" + model.name +
-                                                 "]: unsupported joints type");
-                    }
-                }
-                else
-                {
-                    mesh.jointsOffset = whiteVertexOffset;
-                }
-                // weights
-                if (_primitive.attributes.contains("WEIGHTS_0"))
-                {
-                    const tinygltf::Accessor& _accessor = _model.accessors[_primitive.attributes.at("WEIGHTS_0")];
-                    switch (_accessor.componentType)
-                    {
-                    case TINYGLTF_COMPONENT_TYPE_FLOAT:
-                        initializeVertexAttribute("WEIGHTS_0", mesh.weightsOffset, glm::make_vec4<float>);
-                        break;
-                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-                        initializeVertexAttribute(
-                            "WEIGHTS_0", mesh.weightsOffset, +[](const uint8_t* const ptr) -> glm::float4 {
-                                return glm::float4(glm::make_vec4(ptr)) / 255.0f;
-                            });
-                        break;
-                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                        initializeVertexAttribute(
-                            "WEIGHTS_0", mesh.weightsOffset, +[](const uint16_t* const ptr) -> glm::float4 {
-                                return glm::float4(glm::make_vec4(ptr)) / 65535.0f;
-                            });
-                        break;
-                    default:
-                        throw std::runtime_error("Failed to initialize model [" + model.name +
-                                                 "]: unsupported weights type");
-                    }
-                }
-                else
-                {
-                    mesh.weightsOffset = whiteVertexOffset;
-                }
-            }
+            model.meshNamesToIndices[model.meshes[j].name] = j;
         }
+    }
 
-        // Initialize the node back references.
-        for (uint32_t j = 0; j < model.nodes.size(); j++)
-        {
-            const tinygltf::Node& _node = _model.nodes[j];
-            Model::Node& node = model.nodes[j];
-            if (_node.mesh != -1)
-            {
-                node.mesh->material->nodes.emplace_back(&node);
-            }
-        }
+    // Initialize the skins and the animations of all models,
+    // since the simulation and the player animation use them before the streamed models are resident.
+    for (uint32_t i = 0; i < models.size(); i++)
+    {
+        tinygltf::Model& _model = _models[i];
+        Model& model = models[i];
 
         // Initialize the skins.
         for (uint32_t j = 0; j < model.skins.size(); j++)
@@ -918,10 +475,778 @@ void Vulkan::initializeModels()
             animation.time = animation.start;
         }
     }
+
+    // Preprocess the images and the meshes of the essential models concurrently on a pool of threads,
+    // i.e. read the textures straight into staging space, convert the vertex attributes, and generate the tangents
+    // and the mesh embeddings.
+    // Only the uploads and the descriptor writes are recorded on this thread afterwards.
+    // The meshes of the streamed models are only embedded, since the embedding needs the simulation meshes,
+    // which are released before the streamed models are preprocessed in the background.
+    std::vector<bool> streamed(models.size(), false);
+    for (const StreamedModel& streamedModel : streamedModels)
+    {
+        streamed[streamedModel.model] = true;
+    }
+    std::vector<std::vector<StagedTexture>> images(models.size());
+    std::vector<std::vector<MeshUpload>> meshUploads(models.size());
+    TaskGraph preprocessing;
+    for (uint32_t i = 0; i < models.size(); i++)
+    {
+        if (streamed[i])
+        {
+            continue;
+        }
+        images[i].resize(_models[i].images.size());
+        for (uint32_t j = 0; j < images[i].size(); j++)
+        {
+            preprocessing.add([this, &images, i, j]() {
+                const std::string name = fs::path(_models[i].images[j].uri).stem().string();
+                images[i][j] = stageKhronosTexture(name, models[i].name);
+            });
+        }
+        meshUploads[i].resize(models[i].meshes.size());
+        for (uint32_t j = 0; j < meshUploads[i].size(); j++)
+        {
+            preprocessing.add([this, &meshUploads, i, j]() { meshUploads[i][j] = preprocessMesh(i, j); });
+        }
+    }
+    for (StreamedModel& streamedModel : streamedModels)
+    {
+        const uint32_t i = streamedModel.model;
+        streamedModel.embeddings.resize(models[i].meshes.size());
+        for (uint32_t j = 0; j < streamedModel.embeddings.size(); j++)
+        {
+            if (models[i].meshes[j].embedding != MeshEmbedding::none)
+            {
+                preprocessing.add(
+                    [this, &streamedModel, i, j]() { streamedModel.embeddings[j] = embedModelMesh(i, j); });
+            }
+        }
+    }
+    preprocessing.run();
+
+    setupGraphics();
+    for (uint32_t i = 0; i < models.size(); i++)
+    {
+        if (!streamed[i])
+        {
+            uploadModel(i, images[i], meshUploads[i]);
+        }
+    }
     playGraphics();
+    for (uint32_t i = 0; i < models.size(); i++)
+    {
+        if (!streamed[i])
+        {
+            models[i].residency = Model::Residency::uploading;
+            models[i].uploadValue = uploadCount;
+        }
+    }
+}
+
+void Vulkan::uploadModel(uint32_t modelIndex, std::vector<StagedTexture>& images, std::vector<MeshUpload>& meshUploads)
+{
+    tinygltf::Model& _model = _models[modelIndex];
+    Model& model = models[modelIndex];
+
+    // Initialize the samplers.
+    model.samplers.reserve(_model.samplers.size());
+    for (const tinygltf::Sampler& _sampler : _model.samplers)
+    {
+        SamplerCreateInfo sampler = gpu.sampler();
+        if (_sampler.magFilter == TINYGLTF_TEXTURE_FILTER_NEAREST)
+        {
+            sampler.magFilter = Filter::eNearest;
+        }
+        if (_sampler.minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST ||
+            _sampler.minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST ||
+            _sampler.minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR)
+        {
+            sampler.minFilter = Filter::eNearest;
+        }
+        if (_sampler.minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST ||
+            _sampler.minFilter == TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST)
+        {
+            sampler.mipmapMode = SamplerMipmapMode::eNearest;
+        }
+        if (_sampler.wrapS == TINYGLTF_TEXTURE_WRAP_MIRRORED_REPEAT)
+        {
+            sampler.addressModeU = SamplerAddressMode::eMirroredRepeat;
+        }
+        else if (_sampler.wrapS == TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE)
+        {
+            sampler.addressModeU = SamplerAddressMode::eClampToEdge;
+        }
+        if (_sampler.wrapT == TINYGLTF_TEXTURE_WRAP_MIRRORED_REPEAT)
+        {
+            sampler.addressModeV = sampler.addressModeW = SamplerAddressMode::eMirroredRepeat;
+        }
+        else if (_sampler.wrapT == TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE)
+        {
+            sampler.addressModeV = sampler.addressModeW = SamplerAddressMode::eClampToEdge;
+        }
+        model.samplers.emplace_back(device.createSampler(sampler));
+    }
+
+    model.images.resize(images.size());
+    std::vector<bool> initializedImage(images.size(), false);
+
+    // Load the texture infos.
+    struct Texture
+    {
+        vk::Sampler& sampler;
+        uint32_t image;
+    };
+    std::vector<Texture> textures;
+    textures.reserve(_model.textures.size());
+    for (const tinygltf::Texture& _texture : _model.textures)
+    {
+        if (_texture.source == -1)
+        {
+            throw std::runtime_error("Failed to initialize model [" + model.name + "]: texture without source");
+        }
+        textures.emplace_back(Texture{
+            .sampler = (_texture.sampler == -1) ? linearRepeatAniSampler : model.samplers[_texture.sampler],
+            .image = static_cast<uint32_t>(_texture.source),
+        });
+    }
+
+    // Initialize the textures and the materials.
+    for (uint32_t j = 0; j < model.materials.size(); j++)
+    {
+        const tinygltf::Material& _material = _model.materials[j];
+        Model::Material& material = model.materials[j];
+        material.name = _material.name;
+        model.materialNamesToIndices[material.name] = j;
+        material.descSets = initDescriptorSets(materialDescLayout);
+        const auto initializeMaterialTexture = [&](uint32_t index, uint32_t binding,
+                                                   ColorSpace colorSpace = ColorSpace::sRGB) -> void {
+            uint32_t image = textures[index].image;
+            if (!initializedImage[image])
+            {
+                model.images[image] = initTexture(ImageUsageFlagBits::eSampled, images[image], colorSpace);
+                initializedImage[image] = true;
+            }
+            for (DescriptorSet& set : material.descSets)
+            {
+                setCombinedImageSampler(textures[index].sampler, model.images[image], set, binding);
+            }
+        };
+        const auto initializeWhiteTexture = [&](uint32_t binding) -> void {
+            for (DescriptorSet& set : material.descSets)
+            {
+                setCombinedImageSampler(linearRepeatSampler, whiteImage, set, binding);
+            }
+        };
+        // pbrSpecularGlossiness
+        if (_material.extensions.contains("KHR_materials_pbrSpecularGlossiness"))
+        {
+            material.uniform.workflow = static_cast<glm::uint>(MaterialUniform::PbrWorkflow::SpecularGlossiness);
+            const auto& pbrSpecularGlossiness = _material.extensions.at("KHR_materials_pbrSpecularGlossiness");
+            // diffuseFactor
+            if (pbrSpecularGlossiness.Has("diffuseFactor"))
+            {
+                const auto& diffuseFactor = pbrSpecularGlossiness.Get("diffuseFactor");
+                for (uint32_t i = 0; i < 4; i++)
+                {
+                    material.uniform.colorFactor[i] = diffuseFactor.Get(i).GetNumberAsDouble();
+                }
+            }
+            // diffuseTexture
+            if (pbrSpecularGlossiness.Has("diffuseTexture"))
+            {
+                const auto& diffuseTexture = pbrSpecularGlossiness.Get("diffuseTexture");
+                uint32_t index = diffuseTexture.Get("index").GetNumberAsInt();
+                initializeMaterialTexture(index, 0, ColorSpace::sRGB);
+                if (diffuseTexture.Has("texCoord"))
+                {
+                    material.uniform.colorTexcoord = diffuseTexture.Get("texCoord").GetNumberAsInt();
+                }
+            }
+            else
+            {
+                initializeWhiteTexture(0);
+            }
+            // specularFactor
+            if (pbrSpecularGlossiness.Has("specularFactor"))
+            {
+                const auto& specularFactor = pbrSpecularGlossiness.Get("specularFactor");
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    material.uniform.pbrFactor[i] = specularFactor.Get(i).GetNumberAsDouble();
+                }
+            }
+            // glossinessFactor
+            if (pbrSpecularGlossiness.Has("glossinessFactor"))
+            {
+                const auto& glossinessFactor = pbrSpecularGlossiness.Get("glossinessFactor");
+                material.uniform.pbrFactor[3] = glossinessFactor.GetNumberAsDouble();
+            }
+            // specularGlossinessTexture
+            if (pbrSpecularGlossiness.Has("specularGlossinessTexture"))
+            {
+                const auto& specularGlossinessTexture = pbrSpecularGlossiness.Get("specularGlossinessTexture");
+                uint32_t index = specularGlossinessTexture.Get("index").GetNumberAsInt();
+                initializeMaterialTexture(index, 1, ColorSpace::sRGB);
+                if (specularGlossinessTexture.Has("texCoord"))
+                {
+                    material.uniform.pbrTexcoord = specularGlossinessTexture.Get("texCoord").GetNumberAsInt();
+                }
+            }
+            else
+            {
+                initializeWhiteTexture(1);
+            }
+        }
+        // pbrMetallicRoughness
+        else
+        {
+            material.uniform.workflow = static_cast<glm::uint>(MaterialUniform::PbrWorkflow::MetallicRoughness);
+            const tinygltf::PbrMetallicRoughness& pbrMetallicRoughness = _material.pbrMetallicRoughness;
+            // baseColorFactor
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                material.uniform.colorFactor[i] = pbrMetallicRoughness.baseColorFactor[i];
+            }
+            // baseColorTexture
+            if (pbrMetallicRoughness.baseColorTexture.index != -1)
+            {
+                initializeMaterialTexture(pbrMetallicRoughness.baseColorTexture.index, 0, ColorSpace::sRGB);
+            }
+            else
+            {
+                initializeWhiteTexture(0);
+            }
+            material.uniform.colorTexcoord = pbrMetallicRoughness.baseColorTexture.texCoord;
+            // metallicFactor
+            material.uniform.pbrFactor.b = pbrMetallicRoughness.metallicFactor;
+            // roughnessFactor
+            material.uniform.pbrFactor.g = pbrMetallicRoughness.roughnessFactor;
+            // metallicRoughnessTexture
+            if (pbrMetallicRoughness.metallicRoughnessTexture.index != -1)
+            {
+                initializeMaterialTexture(pbrMetallicRoughness.metallicRoughnessTexture.index, 1,
+                                          ColorSpace::linear);
+            }
+            else
+            {
+                initializeWhiteTexture(1);
+            }
+            material.uniform.pbrTexcoord = pbrMetallicRoughness.metallicRoughnessTexture.texCoord;
+        }
+        // normalTexture
+        if (_material.normalTexture.index != -1)
+        {
+            initializeMaterialTexture(_material.normalTexture.index, 2, ColorSpace::linear);
+        }
+        else
+        {
+            for (DescriptorSet& set : material.descSets)
+            {
+                setCombinedImageSampler(linearRepeatSampler, blueImage, set, 2);
+            }
+        }
+        material.uniform.normalTexcoord = _material.normalTexture.texCoord;
+        material.uniform.normalScale = _material.normalTexture.scale;
+        // occlusionTexture
+        if (_material.occlusionTexture.index != -1)
+        {
+            initializeMaterialTexture(_material.occlusionTexture.index, 3, ColorSpace::linear);
+        }
+        else
+        {
+            initializeWhiteTexture(3);
+        }
+        material.uniform.occlusionTexcoord = _material.occlusionTexture.texCoord;
+        material.uniform.occlusionStrength = _material.occlusionTexture.strength;
+        // emissiveTexture
+        if (_material.emissiveTexture.index != -1)
+        {
+            initializeMaterialTexture(_material.emissiveTexture.index, 4, ColorSpace::sRGB);
+        }
+        else
+        {
+            initializeWhiteTexture(4);
+        }
+        material.uniform.emissiveTexcoord = _material.emissiveTexture.texCoord;
+        // emissiveFactor
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            material.uniform.emissiveFactor[i] = _material.emissiveFactor[i];
+        }
+
+        // Initialize the uniforms.
+        if (material.variable)
+        {
+            for (uint32_t k = 0; k < frameCount; k++)
+            {
+                setUniformBuffer(varUniformBuffers[k], material.uniformOffset, sizeof(MaterialUniform),
+                                 material.descSets[k], 5);
+                varUniformBuffers[k].set(material.uniform, material.uniformOffset);
+            }
+        }
+        else
+        {
+            fillBuffer(constUniformBuffer, Data::of(material.uniform), material.uniformOffset);
+            for (DescriptorSet& set : material.descSets)
+            {
+                setUniformBuffer(constUniformBuffer, material.uniformOffset, sizeof(MaterialUniform), set, 5);
+            }
+        }
+    }
+
+    // Upload the preprocessed meshes.
+    for (MeshUpload& upload : meshUploads)
+    {
+        fillBuffer(indexBuffer, upload.indices.first, upload.indices.second);
+        for (auto& [data, offset] : upload.vertices)
+        {
+            fillBuffer(vertexBuffer, data, offset);
+        }
+    }
+
+    // Initialize the node back references.
+    for (uint32_t j = 0; j < model.nodes.size(); j++)
+    {
+        const tinygltf::Node& _node = _model.nodes[j];
+        Model::Node& node = model.nodes[j];
+        if (_node.mesh != -1)
+        {
+            node.mesh->material->nodes.emplace_back(&node);
+        }
+    }
+
+    // Release the glTF model, its data is staged.
+    _models[modelIndex] = {};
+}
+
+void Vulkan::startStreaming()
+{
+    if (streamedModels.empty())
+    {
+        // Destroy the glTF models.
+        _models.clear();
+        return;
+    }
+
+    // Preprocess the streamed models on a pool of background threads, leaving a core to the game loop.
+    // The textures are staged into dedicated staging buffers, since uploads are submitted meanwhile.
+    // A model is preprocessed once all of its images and meshes are.
+    streaming = std::async(std::launch::async, [this]() {
+        TaskGraph preprocessing;
+        for (StreamedModel& streamedModel : streamedModels)
+        {
+            const uint32_t i = streamedModel.model;
+            std::vector<uint32_t> tasks;
+            streamedModel.images.resize(_models[i].images.size());
+            for (uint32_t j = 0; j < streamedModel.images.size(); j++)
+            {
+                tasks.emplace_back(preprocessing.add([this, &streamedModel, i, j]() {
+                    const std::string name = fs::path(_models[i].images[j].uri).stem().string();
+                    streamedModel.images[j] = stageKhronosTexture(name, models[i].name, true);
+                }));
+            }
+            streamedModel.meshUploads.resize(models[i].meshes.size());
+            for (uint32_t j = 0; j < streamedModel.meshUploads.size(); j++)
+            {
+                tasks.emplace_back(preprocessing.add(
+                    [this, &streamedModel, i, j]() {
+                        streamedModel.meshUploads[j] = preprocessMesh(i, j, &streamedModel.embeddings[j]);
+                    }));
+            }
+            preprocessing.add([&streamedModel]() { streamedModel.preprocessed = true; }, tasks);
+        }
+        preprocessing.run(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    });
+}
+
+void Vulkan::updateStreaming()
+{
+    // Check if the background preprocessing is finished, so that all streamed models are preprocessed.
+    const bool finished =
+        streaming.valid() && streaming.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    if (finished)
+    {
+        streaming.get();
+    }
+
+    // Upload the streamed models preprocessed since the last call.
+    std::vector<uint32_t> uploadedModels;
+    for (StreamedModel& streamedModel : streamedModels)
+    {
+        if (!streamedModel.uploaded && streamedModel.preprocessed)
+        {
+            if (uploadedModels.empty())
+            {
+                setupGraphics();
+            }
+            uploadModel(streamedModel.model, streamedModel.images, streamedModel.meshUploads);
+            streamedModel.uploaded = true;
+            uploadedModels.emplace_back(streamedModel.model);
+        }
+    }
+    if (!uploadedModels.empty())
+    {
+        playGraphics();
+        for (uint32_t i : uploadedModels)
+        {
+            models[i].residency = Model::Residency::uploading;
+            models[i].uploadValue = uploadCount;
+        }
+    }
+    if (finished)
+    {
+        streamedModels.clear();
+        // Destroy the glTF models.
+        _models.clear();
+    }
+
+    // Make the uploaded models resident once their uploads are complete.
+    const uint64_t completeValue = device.getSemaphoreCounterValue(uploadComplete);
+    for (Model& model : models)
+    {
+        if (model.residency == Model::Residency::uploading && model.uploadValue <= completeValue)
+        {
+            model.residency = Model::Residency::resident;
+        }
+    }
+}
+
+void Vulkan::terminateStreaming()
+{
+    // Wait for the background preprocessing, ignoring its exception on teardown.
+    if (streaming.valid())
+    {
+        streaming.wait();
+    }
+    for (StreamedModel& streamedModel : streamedModels)
+    {
+        if (streamedModel.uploaded)
+        {
+            continue;
+        }
+        for (StagedTexture& image : streamedModel.images)
+        {
+            if (image.staging.dedicated())
+            {
+                unmapBuffer(image.staging.dedicated);
+                destroyBuffer(image.staging.dedicated);
+            }
+        }
+        for (MeshUpload& upload : streamedModel.meshUploads)
+        {
+            for (auto& [data, offset] : upload.vertices)
+            {
+                if (data.alloc)
+                {
+                    data.free();
+                }
+            }
+        }
+        for (auto& [jointData, weightData] : streamedModel.embeddings)
+        {
+            if (jointData.alloc)
+            {
+                jointData.free();
+            }
+            if (weightData.alloc)
+            {
+                weightData.free();
+            }
+        }
+    }
+    streamedModels.clear();
+}
+
+Vulkan::MeshUpload Vulkan::preprocessMesh(uint32_t modelIndex, uint32_t meshIndex, std::pair<Data, Data>* embedding)
+{
+    SMikkTSpaceInterface tsInterface = TangentSpace::Interface();
+
+    tinygltf::Model& _model = _models[modelIndex];
+    Model& model = models[modelIndex];
+    const tinygltf::Mesh& _mesh = _model.meshes[meshIndex];
+    Model::Mesh& mesh = model.meshes[meshIndex];
+    const tinygltf::Primitive& _primitive = _mesh.primitives[0];
+    Profiler::Scope scope("preprocess mesh", model.name + "/" + mesh.name);
+    MeshUpload upload;
+    TangentSpace::UserData tsData;
+    if (_primitive.material != -1)
+    {
+        mesh.material = &model.materials[_primitive.material];
+    }
+    else
+    {
+        throw std::runtime_error("Failed to initialize model [" + model.name + "]: missing material");
+    }
+    if (_primitive.mode != TINYGLTF_MODE_TRIANGLES)
+    {
+        throw std::runtime_error("Failed to initialize model [" + model.name + "]: unsupported primitive topology");
+    }
+    // Initialize the indices.
+    if (_primitive.indices != -1)
+    {
+        const tinygltf::Accessor& _accessor = _model.accessors[_primitive.indices];
+        tsData.faceCount = mesh.indexCount / 3;
+        switch (_accessor.componentType)
+        {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+            mesh.indexType = IndexType::eUint32;
+            tsData.indexSize = 4;
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            mesh.indexType = IndexType::eUint16;
+            tsData.indexSize = 2;
+            break;
+        default:
+            throw std::runtime_error("Failed to initialize model [" + model.name + "]: unsupported index type");
+        }
+        const tinygltf::BufferView& _bufferView = _model.bufferViews[_accessor.bufferView];
+        tinygltf::Buffer& _buffer = _model.buffers[_bufferView.buffer];
+        tsData.indices = Data{
+            .data = &_buffer.data[_accessor.byteOffset + _bufferView.byteOffset],
+            .size = mesh.indexCount * tsData.indexSize,
+        };
+        upload.indices = {tsData.indices, mesh.indexOffset};
+    }
+    else
+    {
+        throw std::runtime_error("Failed to initialize model [" + model.name + "]: missing indices");
+    }
+    // Initialize the vertex attributes.
+    // An attribute stored tightly packed in the vertex layout is read in place, otherwise it is converted.
+    // The converted data is freed once it is uploaded, the tangent space generation only references it.
+    const std::string normalTexcoord =
+        "TEXCOORD_" + std::to_string(_model.materials[_primitive.material].normalTexture.texCoord);
+    const auto initializeVertexAttribute =
+        [&]<typename srcValT, typename dstVecT>(const std::string& name, DeviceSize offset,
+                                                dstVecT (*make_vec)(const srcValT* const)) -> void {
+        const tinygltf::Accessor& _accessor = _model.accessors[_primitive.attributes.at(name)];
+        const tinygltf::BufferView& _bufferView = _model.bufferViews[_accessor.bufferView];
+        tinygltf::Buffer& _buffer = _model.buffers[_bufferView.buffer];
+        const size_t stride = _accessor.ByteStride(_bufferView) / sizeof(srcValT);
+        const size_t size = mesh.vertexCount * sizeof(dstVecT);
+        srcValT* src = reinterpret_cast<srcValT*>(&_buffer.data[_accessor.byteOffset + _bufferView.byteOffset]);
+        Data data{
+            .data = src,
+            .size = size,
+        };
+        if (!std::is_same_v<srcValT, typename dstVecT::value_type> || stride * sizeof(srcValT) != sizeof(dstVecT))
+        {
+            data = Data::allocate(size);
+            dstVecT* dst = static_cast<dstVecT*>(data());
+            for (uint32_t k = 0; k < mesh.vertexCount; k++)
+            {
+                dst[k] = make_vec(&src[k * stride]);
+            }
+        }
+        Data reference = data;
+        reference.alloc = false;
+        if (name == "POSITION")
+            tsData.positions = reference;
+        else if (name == "NORMAL")
+            tsData.normals = reference;
+        else if (name == normalTexcoord)
+            tsData.texcoords = reference;
+        upload.vertices.emplace_back(data, offset);
+    };
+    // position
+    if (_primitive.attributes.contains("POSITION"))
+    {
+        initializeVertexAttribute("POSITION", mesh.positionOffset, glm::make_vec3<float>);
+    }
+    else
+    {
+        throw std::runtime_error("Failed to initialize model [" + model.name + "]: missing positions");
+    }
+    // normal
+    if (_primitive.attributes.contains("NORMAL"))
+    {
+        initializeVertexAttribute("NORMAL", mesh.normalOffset, glm::make_vec3<float>);
+    }
+    else
+    {
+        throw std::runtime_error("Failed to initialize model [" + model.name + "]: missing normals");
+    }
+    // texcoord
+    for (uint32_t k = 0; k < 5; k++)
+    {
+        const std::string name = "TEXCOORD_" + std::to_string(k);
+        if (_primitive.attributes.contains(name))
+        {
+            const tinygltf::Accessor& _accessor = _model.accessors[_primitive.attributes.at(name)];
+            switch (_accessor.componentType)
+            {
+            case TINYGLTF_COMPONENT_TYPE_FLOAT:
+                initializeVertexAttribute(name, mesh.texcoordOffset[k], glm::make_vec2<float>);
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                initializeVertexAttribute(
+                    name, mesh.texcoordOffset[k], +[](const uint8_t* const ptr) -> glm::float2 {
+                        return glm::float2(glm::make_vec2(ptr)) / 255.0f;
+                    });
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+                initializeVertexAttribute(
+                    name, mesh.texcoordOffset[k], +[](const uint16_t* const ptr) -> glm::float2 {
+                        return glm::float2(glm::make_vec2(ptr)) / 65535.0f;
+                    });
+                break;
+            default:
+                throw std::runtime_error("Failed to initialize model [" + model.name + "]: unsupported texcoord type");
+            }
+        }
+        else
+        {
+            mesh.texcoordOffset[k] = whiteVertexOffset;
+        }
+    }
+    // tangent
+    tsData.tangents = Data::allocate(mesh.vertexCount * sizeof(Vertex::tangent));
+    Profiler::Scope tangentScope("generate tangents", model.name + "/" + mesh.name);
+    TangentSpace::generate(tsInterface, tsData);
+    tangentScope.stop();
+    upload.vertices.emplace_back(tsData.tangents, mesh.tangentOffset);
+    // color
+    if (_primitive.attributes.contains("COLOR_0"))
+    {
+        const tinygltf::Accessor& _accessor = _model.accessors[_primitive.attributes.at("COLOR_0")];
+        const bool hasAlpha = (_accessor.type == TINYGLTF_TYPE_VEC4);
+        switch (_accessor.componentType)
+        {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT:
+            initializeVertexAttribute(
+                "COLOR_0", mesh.colorOffset,
+                hasAlpha ? +[](const float* const ptr) -> glm::float4 { return glm::make_vec4(ptr); }
+                         : +[](const float* const ptr) -> glm::float4 {
+                               return {glm::make_vec3(ptr), 1.0f};
+                           });
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            initializeVertexAttribute(
+                "COLOR_0", mesh.colorOffset,
+                hasAlpha ? +[](const uint8_t* const ptr)
+                               -> glm::float4 { return glm::float4(glm::make_vec4(ptr)) / 255.0f; }
+                         : +[](const uint8_t* const ptr) -> glm::float4 {
+                               return {glm::float3(glm::make_vec3(ptr)) / 255.0f, 1.0f};
+                           });
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            initializeVertexAttribute(
+                "COLOR_0", mesh.colorOffset,
+                hasAlpha ? +[](const uint16_t* const ptr)
+                               -> glm::float4 { return glm::float4(glm::make_vec4(ptr)) / 65535.0f; }
+                         : +[](const uint16_t* const ptr) -> glm::float4 {
+                               return {glm::float3(glm::make_vec3(ptr)) / 65535.0f, 1.0f};
+                           });
+            break;
+        default:
+            throw std::runtime_error("Failed to initialize model [" + model.name + "]: unsupported color type");
+        }
+    }
+    else
+    {
+        mesh.colorOffset = whiteVertexOffset;
+    }
+    if (mesh.embedding != MeshEmbedding::none)
+    {
+        // Generate the mesh embedding, unless it is precomputed.
+        Data jointData, weightData;
+        if (embedding && embedding->first())
+        {
+            std::tie(jointData, weightData) = std::exchange(*embedding, {});
+        }
+        else
+        {
+            embedMesh(model.name, mesh.name, tsData.positions, jointData, weightData);
+        }
+        upload.vertices.emplace_back(jointData, mesh.jointsOffset);
+        upload.vertices.emplace_back(weightData, mesh.weightsOffset);
+    }
+    else
+    {
+        // joints
+        if (_primitive.attributes.contains("JOINTS_0"))
+        {
+            const tinygltf::Accessor& _accessor = _model.accessors[_primitive.attributes.at("JOINTS_0")];
+            switch (_accessor.componentType)
+            {
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                initializeVertexAttribute(
+                    "JOINTS_0", mesh.jointsOffset,
+                    +[](const uint8_t* const ptr) -> glm::uvec4 { return glm::make_vec4(ptr); });
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+                initializeVertexAttribute(
+                    "JOINTS_0", mesh.jointsOffset,
+                    +[](const uint16_t* const ptr) -> glm::uvec4 { return glm::make_vec4(ptr); });
+                break;
+            default:
+                throw std::runtime_error("Failed to initialize model [" + model.name + "]: unsupported joints type");
+            }
+        }
+        else
+        {
+            mesh.jointsOffset = whiteVertexOffset;
+        }
+        // weights
+        if (_primitive.attributes.contains("WEIGHTS_0"))
+        {
+            const tinygltf::Accessor& _accessor = _model.accessors[_primitive.attributes.at("WEIGHTS_0")];
+            switch (_accessor.componentType)
+            {
+            case TINYGLTF_COMPONENT_TYPE_FLOAT:
+                initializeVertexAttribute("WEIGHTS_0", mesh.weightsOffset, glm::make_vec4<float>);
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                initializeVertexAttribute(
+                    "WEIGHTS_0", mesh.weightsOffset, +[](const uint8_t* const ptr) -> glm::float4 {
+                        return glm::float4(glm::make_vec4(ptr)) / 255.0f;
+                    });
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+                initializeVertexAttribute(
+                    "WEIGHTS_0", mesh.weightsOffset, +[](const uint16_t* const ptr) -> glm::float4 {
+                        return glm::float4(glm::make_vec4(ptr)) / 65535.0f;
+                    });
+                break;
+            default:
+                throw std::runtime_error("Failed to initialize model [" + model.name + "]: unsupported weights type");
+            }
+        }
+        else
+        {
+            mesh.weightsOffset = whiteVertexOffset;
+        }
+    }
+    return upload;
+}
+
+std::pair<Data, Data> Vulkan::embedModelMesh(uint32_t modelIndex, uint32_t meshIndex)
+{
+    const tinygltf::Model& _model = _models[modelIndex];
+    const Model& model = models[modelIndex];
+    const Model::Mesh& mesh = model.meshes[meshIndex];
+    const tinygltf::Primitive& _primitive = _model.meshes[meshIndex].primitives[0];
+    if (!_primitive.attributes.contains("POSITION"))
+    {
+        throw std::runtime_error("Failed to initialize model [" + model.name + "]: missing positions");
+    }
+
+    // Gather the positions, which may be interleaved with other attributes.
+    const tinygltf::Accessor& _accessor = _model.accessors[_primitive.attributes.at("POSITION")];
+    const tinygltf::BufferView& _bufferView = _model.bufferViews[_accessor.bufferView];
+    const tinygltf::Buffer& _buffer = _model.buffers[_bufferView.buffer];
+    const size_t stride = _accessor.ByteStride(_bufferView);
+    const uint8_t* src = &_buffer.data[_accessor.byteOffset + _bufferView.byteOffset];
+    std::vector<glm::float3> positions(mesh.vertexCount);
+    for (uint32_t k = 0; k < mesh.vertexCount; k++)
+    {
+        positions[k] = glm::make_vec3(reinterpret_cast<const float*>(src + k * stride));
+    }
 
-    // Destroy the glTF models.
-    _models.clear();
+    std::pair<Data, Data> embedding;
+    embedMesh(model.name, mesh.name, Data::of(positions), embedding.first, embedding.second);
+    return embedding;
 }
 
 Vulkan::Model& Vulkan::getModel(const std::string& name)
@@ -1,43 +1,166 @@
 #include "Vulkan.h"
 
 #include "GUI.h"
+#include "Profiler.h"
 #include "Vertex.h"
+#include <cstring>
+#include <fstream>
 
+namespace fs = std::filesystem;
 using namespace vk;
 
+void Vulkan::initializePipelineCache()
+{
+    Profiler::Scope scope("load pipeline cache");
+    // Load the cache data of the previous run.
+    std::vector<char> data;
+    std::ifstream file(cachePath("pipelines"), std::ios::ate | std::ios::binary);
+    if (file.is_open())
+    {
+        data.resize(file.tellg());
+        file.seekg(0);
+        file.read(data.data(), static_cast<std::streamsize>(data.size()));
+        file.close();
+    }
+
+    // Discard the data unless its header matches the device, since the driver might reject or misinterpret it.
+    VkPipelineCacheHeaderVersionOne header{};
+    if (data.size() >= sizeof(header))
+    {
+        std::memcpy(&header, data.data(), sizeof(header));
+    }
+    if (data.size() < sizeof(header) || header.headerSize < sizeof(header) ||
+        header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || header.vendorID != gpu.properties.vendorID ||
+        header.deviceID != gpu.properties.deviceID ||
+        std::memcmp(header.pipelineCacheUUID, gpu.properties.pipelineCacheUUID.data(), VK_UUID_SIZE) != 0)
+    {
+        data.clear();
+    }
+
+    pipelineCache = device.createPipelineCache(PipelineCacheCreateInfo{
+        .initialDataSize = data.size(),
+        .pInitialData = data.data(),
+    });
+}
+
+void Vulkan::savePipelineCache()
+{
+    // Write the cache data to a temporary file first, so that an interrupted write does not corrupt the cache.
+    // The cache is optional, so it is not saved if the file cannot be written.
+    const std::vector<uint8_t> data = device.getPipelineCacheData(pipelineCache);
+    const fs::path path = cachePath("pipelines");
+    const fs::path temporary = fs::path(path).concat(".tmp");
+    std::error_code error;
+    fs::create_directories(path.parent_path(), error);
+    std::ofstream file(temporary, std::ios::binary);
+    if (!file.is_open())
+    {
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    file.close();
+    if (file.good())
+    {
+        fs::rename(temporary, path, error);
+    }
+}
+
 std::vector<vk::PipelineShaderStageCreateInfo> Vulkan::initializeShaders(std::vector<Shader>& shaders)
 {
     std::vector<PipelineShaderStageCreateInfo> shaderStages;
-    shaderModules.reserve(shaderModules.size() + shaders.size());
     shaderStages.reserve(shaders.size());
     for (Shader& shader : shaders)
     {
         shaderCompiler.compile(shader);
         shader.load();
-        shaderModules.emplace_back(device.createShaderModule(ShaderModuleCreateInfo{
+        const ShaderModule shaderModule = device.createShaderModule(ShaderModuleCreateInfo{
             .codeSize = shader.code.size(),
             .pCode = reinterpret_cast<const uint32_t*>(shader.code.data()),
-        }));
+        });
+        {
+            std::lock_guard lock(shaderModuleMutex);
+            shaderModules.emplace_back(shaderModule);
+        }
         shaderStages.emplace_back(PipelineShaderStageCreateInfo{
             .stage = shader.stageBit(),
-            .module = shaderModules.back(),
+            .module = shaderModule,
             .pName = "main",
         });
     }
     return shaderStages;
 }
 
-void Vulkan::initializeStarUpdatePipeline()
+Shader Vulkan::simShader(SimKernel kernel, uint32_t groupSize)
 {
-    std::vector shaders{
-        Shader{
-            .name = "star-update",
-            .stage = ShaderStage::Compute,
-            .macros = {Shader::macro("g_n", starWorkgroup.size)},
+    // The group size remains a macro, since it sizes the workgroup and the group-shared arrays.
+    return Shader{
+        .name = simKernelInfo(kernel).name,
+        .stage = ShaderStage::Compute,
+        .macros = {Shader::macro("g_n", groupSize), Shader::macro("WAVE", gpu.supportsWaveOps(groupSize) ? 1 : 0)},
+    };
+}
+
+vk::Pipeline Vulkan::createSimPipeline(SimKernel kernel)
+{
+    const SimKernelInfo info = simKernelInfo(kernel);
+    Shader shader = simShader(kernel, workgroup(kernel).size);
+    shaderCompiler.compile(shader);
+    shader.load();
+    const ShaderModule shaderModule = device.createShaderModule(ShaderModuleCreateInfo{
+        .codeSize = shader.code.size(),
+        .pCode = reinterpret_cast<const uint32_t*>(shader.code.data()),
+    });
+
+    // Specialize the simulation constants (see shaders/constants.hlsl).
+    // The constants not declared by the kernel are ignored.
+    struct SimConstants
+    {
+        float substepDeltaTime;
+        glm::uint spatialTableSize;
+    };
+    const SimConstants constants{substepDeltaTime, spatialTableSize};
+    constexpr std::array<SpecializationMapEntry, 2> constantEntries{
+        SpecializationMapEntry{
+            .constantID = 0,
+            .offset = offsetof(SimConstants, substepDeltaTime),
+            .size = sizeof(float),
         },
+        SpecializationMapEntry{
+            .constantID = 1,
+            .offset = offsetof(SimConstants, spatialTableSize),
+            .size = sizeof(glm::uint),
+        },
+    };
+    const SpecializationInfo specializationInfo{
+        .mapEntryCount = static_cast<uint32_t>(constantEntries.size()),
+        .pMapEntries = constantEntries.data(),
+        .dataSize = sizeof(constants),
+        .pData = &constants,
+    };
+    const PipelineShaderStageCreateInfo shaderStage{
+        .stage = shader.stageBit(),
+        .module = shaderModule,
+        .pName = "main",
+        .pSpecializationInfo = &specializationInfo,
     };
-    auto shaderStage = initializeShaders(shaders)[0];
 
+    Pipeline pipeline;
+    std::tie(result, pipeline) = device.createComputePipeline(pipelineCache, ComputePipelineCreateInfo{
+                                                                                 .stage = shaderStage,
+                                                                                 .layout = *info.layout,
+                                                                             });
+    // The shader module is not needed after pipeline creation.
+    // Destroy it right away, so that pipelines recreated while tuning do not accumulate modules.
+    device.destroyShaderModule(shaderModule);
+    if (result != Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create " + info.name + " pipeline");
+    }
+    return pipeline;
+}
+
+void Vulkan::initializeStarUpdatePipeline()
+{
     constexpr PushConstantRange pushConstantRange{
         .stageFlags = ShaderStageFlagBits::eCompute,
         .offset = 0,
@@ -50,14 +173,7 @@ void Vulkan::initializeStarUpdatePipeline()
         .pPushConstantRanges = &pushConstantRange,
     });
 
-    std::tie(result, starUpdatePipeline) = device.createComputePipeline({}, ComputePipelineCreateInfo{
-                                                                                .stage = shaderStage,
-                                                                                .layout = starUpdatePipelineLayout,
-                                                                            });
-    if (result != Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create star update pipeline");
-    }
+    starUpdatePipeline = createSimPipeline(SimKernel::starUpdate);
 
     starUpdateDescSets = initDescriptorSets(starUpdateDescLayout);
     for (DescriptorSet& set : starUpdateDescSets)
@@ -65,25 +181,16 @@ void Vulkan::initializeStarUpdatePipeline()
         setStorageBuffer(storageBuffer, storage.offset.x, starParticleCount * sizeof(glm::float4), set, 0);
         setStorageBuffer(storageBuffer, storage.offset.v, starParticleCount * sizeof(glm::float4), set, 1);
         setStorageBuffer(storageBuffer, storage.offset.state, starParticleCount * sizeof(glm::uint), set, 2);
-        setStorageBuffer(counterBuffer, 0, counterBufferSize, set, 3);
+        setStorageBuffer(statsBuffer, offsetof(SimStats, counter), sizeof(glm::uint), set, 3);
     }
 }
 
 void Vulkan::initializeSpatialHashPipeline()
 {
-    std::vector shaders{
-        Shader{
-            .name = "spatial-hash",
-            .stage = ShaderStage::Compute,
-            .macros = {Shader::macro("g_n", particleWorkgroup.size)},
-        },
-    };
-    auto shaderStage = initializeShaders(shaders)[0];
-
     constexpr PushConstantRange pushConstantRange{
         .stageFlags = ShaderStageFlagBits::eCompute,
         .offset = 0,
-        .size = 3 * sizeof(float) + sizeof(glm::uint),
+        .size = 3 * sizeof(float) + 5 * sizeof(glm::uint),
     };
     spatialHashPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
         .setLayoutCount = 1,
@@ -92,14 +199,7 @@ void Vulkan::initializeSpatialHashPipeline()
         .pPushConstantRanges = &pushConstantRange,
     });
 
-    std::tie(result, spatialHashPipeline) = device.createComputePipeline({}, ComputePipelineCreateInfo{
-                                                                                 .stage = shaderStage,
-                                                                                 .layout = spatialHashPipelineLayout,
-                                                                             });
-    if (result != Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create spatial hash pipeline");
-    }
+    spatialHashPipeline = createSimPipeline(SimKernel::spatialHash);
 
     spatialHashDescSets = initDescriptorSets(spatialHashDescLayout);
     for (DescriptorSet& set : spatialHashDescSets)
@@ -107,20 +207,14 @@ void Vulkan::initializeSpatialHashPipeline()
         setStorageBuffer(storageBuffer, storage.offset.x, storage.size.x, set, 0);
         setStorageBuffer(storageBuffer, storage.offset.v, storage.size.v, set, 1);
         setStorageBuffer(storageBuffer, storage.offset.spat, storage.size.spat, set, 2);
+        setStorageBuffer(storageBuffer, storage.offset.key, storage.size.key, set, 3);
+        setStorageBuffer(storageBuffer, storage.offset.spatMoved, storage.size.spatMoved, set, 4);
+        setStorageBuffer(storageBuffer, storage.offset.spatArgs, storage.size.spatArgs, set, 5);
     }
 }
 
 void Vulkan::initializeSpatialSortPipeline()
 {
-    std::vector shaders{
-        Shader{
-            .name = "spatial-sort",
-            .stage = ShaderStage::Compute,
-            .macros = {Shader::macro("g_n", spatWorkgroup.size)},
-        },
-    };
-    auto shaderStage = initializeShaders(shaders)[0];
-
     constexpr PushConstantRange pushConstantRange{
         .stageFlags = ShaderStageFlagBits::eCompute,
         .offset = 0,
@@ -133,14 +227,7 @@ void Vulkan::initializeSpatialSortPipeline()
         .pPushConstantRanges = &pushConstantRange,
     });
 
-    std::tie(result, spatialSortPipeline) = device.createComputePipeline({}, ComputePipelineCreateInfo{
-                                                                                 .stage = shaderStage,
-                                                                                 .layout = spatialSortPipelineLayout,
-                                                                             });
-    if (result != Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create spatial sort pipeline");
-    }
+    spatialSortPipeline = createSimPipeline(SimKernel::spatialSort);
 
     spatialSortDescSets = initDescriptorSets(spatialSortDescLayout);
     for (DescriptorSet& set : spatialSortDescSets)
@@ -151,15 +238,6 @@ void Vulkan::initializeSpatialSortPipeline()
 
 void Vulkan::initializeSpatialGroupsortPipeline()
 {
-    std::vector shaders{
-        Shader{
-            .name = "spatial-groupsort",
-            .stage = ShaderStage::Compute,
-            .macros = {Shader::macro("g_n", sharedSpatWorkgroup.size)},
-        },
-    };
-    auto shaderStage = initializeShaders(shaders)[0];
-
     constexpr PushConstantRange pushConstantRange{
         .stageFlags = ShaderStageFlagBits::eCompute,
         .offset = 0,
@@ -172,15 +250,7 @@ void Vulkan::initializeSpatialGroupsortPipeline()
         .pPushConstantRanges = &pushConstantRange,
     });
 
-    std::tie(result, spatialGroupsortPipeline) =
-        device.createComputePipeline({}, ComputePipelineCreateInfo{
-                                             .stage = shaderStage,
-                                             .layout = spatialGroupsortPipelineLayout,
-                                         });
-    if (result != Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create spatial groupsort pipeline");
-    }
+    spatialGroupsortPipeline = createSimPipeline(SimKernel::spatialGroupsort);
 
     spatialGroupsortDescSets = initDescriptorSets(spatialGroupsortDescLayout);
     for (DescriptorSet& set : spatialGroupsortDescSets)
@@ -189,38 +259,71 @@ void Vulkan::initializeSpatialGroupsortPipeline()
     }
 }
 
-void Vulkan::initializeSpatialCollectPipeline()
+void Vulkan::initializeSpatialFixupPipeline()
 {
-    std::vector shaders{
-        Shader{
-            .name = "spatial-collect",
-            .stage = ShaderStage::Compute,
-            .macros = {Shader::macro("g_n", particleWorkgroup.size)},
-        },
+    constexpr PushConstantRange pushConstantRange{
+        .stageFlags = ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = 4 * sizeof(glm::uint),
     };
-    auto shaderStage = initializeShaders(shaders)[0];
+    spatialFixupPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
+        .setLayoutCount = 1,
+        .pSetLayouts = &spatialFixupDescLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    });
+
+    spatialFixupPipeline = createSimPipeline(SimKernel::spatialFixup);
 
+    spatialFixupDescSets = initDescriptorSets(spatialFixupDescLayout);
+    for (DescriptorSet& set : spatialFixupDescSets)
+    {
+        setStorageBuffer(storageBuffer, storage.offset.spatMoved, storage.size.spatMoved, set, 0);
+        setStorageBuffer(storageBuffer, storage.offset.spatArgs, storage.size.spatArgs, set, 1);
+    }
+}
+
+void Vulkan::initializeSpatialMergePipeline()
+{
     constexpr PushConstantRange pushConstantRange{
         .stageFlags = ShaderStageFlagBits::eCompute,
         .offset = 0,
-        .size = sizeof(glm::uint),
+        .size = 2 * sizeof(glm::uint),
     };
-    spatialCollectPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
+    spatialMergePipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
         .setLayoutCount = 1,
-        .pSetLayouts = &spatialCollectDescLayout,
+        .pSetLayouts = &spatialMergeDescLayout,
         .pushConstantRangeCount = 1,
         .pPushConstantRanges = &pushConstantRange,
     });
 
-    std::tie(result, spatialCollectPipeline) =
-        device.createComputePipeline({}, ComputePipelineCreateInfo{
-                                             .stage = shaderStage,
-                                             .layout = spatialCollectPipelineLayout,
-                                         });
-    if (result != Result::eSuccess)
+    spatialMergePipeline = createSimPipeline(SimKernel::spatialMerge);
+
+    spatialMergeDescSets = initDescriptorSets(spatialMergeDescLayout);
+    for (DescriptorSet& set : spatialMergeDescSets)
     {
-        throw std::runtime_error("Failed to create spatial collect pipeline");
+        setStorageBuffer(storageBuffer, storage.offset.spat, storage.size.spat, set, 0);
+        setStorageBuffer(storageBuffer, storage.offset.spatMoved, storage.size.spatMoved, set, 1);
+        setStorageBuffer(storageBuffer, storage.offset.spatMerged, storage.size.spatMerged, set, 2);
+        setStorageBuffer(storageBuffer, storage.offset.spatArgs, storage.size.spatArgs, set, 3);
     }
+}
+
+void Vulkan::initializeSpatialCollectPipeline()
+{
+    constexpr PushConstantRange pushConstantRange{
+        .stageFlags = ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = 2 * sizeof(glm::uint),
+    };
+    spatialCollectPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
+        .setLayoutCount = 1,
+        .pSetLayouts = &spatialCollectDescLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    });
+
+    spatialCollectPipeline = createSimPipeline(SimKernel::spatialCollect);
 
     spatialCollectDescSets = initDescriptorSets(spatialCollectDescLayout);
     for (DescriptorSet& set : spatialCollectDescSets)
@@ -232,19 +335,10 @@ void Vulkan::initializeSpatialCollectPipeline()
 
 void Vulkan::initializeXpbdPredictPipeline()
 {
-    std::vector shaders{
-        Shader{
-            .name = "xpbd-predict",
-            .stage = ShaderStage::Compute,
-            .macros = {Shader::macro("g_n", particleWorkgroup.size)},
-        },
-    };
-    auto shaderStage = initializeShaders(shaders)[0];
-
     constexpr PushConstantRange pushConstantRange{
         .stageFlags = ShaderStageFlagBits::eCompute,
         .offset = 0,
-        .size = 2 * sizeof(float) + sizeof(glm::uint),
+        .size = sizeof(float) + sizeof(glm::uint),
     };
     xpbdPredictPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
         .setLayoutCount = 1,
@@ -253,14 +347,7 @@ void Vulkan::initializeXpbdPredictPipeline()
         .pPushConstantRanges = &pushConstantRange,
     });
 
-    std::tie(result, xpbdPredictPipeline) = device.createComputePipeline({}, ComputePipelineCreateInfo{
-                                                                                 .stage = shaderStage,
-                                                                                 .layout = xpbdPredictPipelineLayout,
-                                                                             });
-    if (result != Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create XPBD predict pipeline");
-    }
+    xpbdPredictPipeline = createSimPipeline(SimKernel::xpbdPredict);
 
     xpbdPredictDescSets = initDescriptorSets(xpbdPredictDescLayout);
     for (DescriptorSet& set : xpbdPredictDescSets)
@@ -268,40 +355,73 @@ void Vulkan::initializeXpbdPredictPipeline()
         setStorageBuffer(storageBuffer, storage.offset.x, storage.size.x, set, 0);
         setStorageBuffer(storageBuffer, storage.offset.v, storage.size.v, set, 1);
         setStorageBuffer(storageBuffer, storage.offset.x_, storage.size.x_, set, 2);
+        setStorageBuffer(storageBuffer, storage.offset.state, storage.size.state, set, 3);
     }
 }
 
-void Vulkan::initializeXpbdObjcollPipeline()
+void Vulkan::initializeXpbdLraPipeline()
 {
-    std::vector shaders{
-        Shader{
-            .name = "xpbd-objcoll",
-            .stage = ShaderStage::Compute,
-            .macros = {Shader::macro("g_n", particleWorkgroup.size)},
-        },
+    constexpr PushConstantRange pushConstantRange{
+        .stageFlags = ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = sizeof(glm::uint),
     };
-    auto shaderStage = initializeShaders(shaders)[0];
+    xpbdLraPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
+        .setLayoutCount = 1,
+        .pSetLayouts = &xpbdLraDescLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    });
+
+    xpbdLraPipeline = createSimPipeline(SimKernel::xpbdLra);
+
+    xpbdLraDescSets = initDescriptorSets(xpbdLraDescLayout);
+    for (DescriptorSet& set : xpbdLraDescSets)
+    {
+        setStorageBuffer(storageBuffer, storage.offset.lraConstr, storage.size.lraConstr, set, 0);
+        setStorageBuffer(storageBuffer, storage.offset.x, storage.size.x, set, 1);
+        setStorageBuffer(storageBuffer, storage.offset.state, storage.size.state, set, 2);
+        setStorageBuffer(storageBuffer, storage.offset.x_, storage.size.x_, set, 3);
+    }
+}
 
+void Vulkan::initializeBodyBroadphasePipeline()
+{
     constexpr PushConstantRange pushConstantRange{
         .stageFlags = ShaderStageFlagBits::eCompute,
         .offset = 0,
-        .size = sizeof(glm::uint),
+        .size = sizeof(float) + 2 * sizeof(glm::uint),
     };
-    xpbdObjcollPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
+    bodyBroadphasePipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
         .setLayoutCount = 1,
-        .pSetLayouts = &xpbdObjcollDescLayout,
+        .pSetLayouts = &bodyBroadphaseDescLayout,
         .pushConstantRangeCount = 1,
         .pPushConstantRanges = &pushConstantRange,
     });
 
-    std::tie(result, xpbdObjcollPipeline) = device.createComputePipeline({}, ComputePipelineCreateInfo{
-                                                                                 .stage = shaderStage,
-                                                                                 .layout = xpbdObjcollPipelineLayout,
-                                                                             });
-    if (result != Result::eSuccess)
+    bodyBroadphasePipeline = createSimPipeline(SimKernel::bodyBroadphase);
+
+    bodyBroadphaseDescSets = initDescriptorSets(bodyBroadphaseDescLayout);
+    for (uint32_t i = 0; i < frameCount; i++)
     {
-        throw std::runtime_error("Failed to create XPBD object collide pipeline");
+        setUniformBuffer(varUniformBuffers[i], playerCollisionUniformOffset, sizeof(PlayerCollisionUniform),
+                         bodyBroadphaseDescSets[i], 0);
+        setStorageBuffer(storageBuffer, storage.offset.bodies, storage.size.bodies, bodyBroadphaseDescSets[i], 1);
+        setStorageBuffer(storageBuffer, storage.offset.x, storage.size.x, bodyBroadphaseDescSets[i], 2);
+        setStorageBuffer(storageBuffer, storage.offset.r, storage.size.r, bodyBroadphaseDescSets[i], 3);
+        setStorageBuffer(storageBuffer, storage.offset.chunks, storage.size.chunks, bodyBroadphaseDescSets[i], 4);
+        setStorageBuffer(storageBuffer, storage.offset.args, storage.size.args, bodyBroadphaseDescSets[i], 5);
     }
+}
+
+void Vulkan::initializeXpbdObjcollPipeline()
+{
+    xpbdObjcollPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
+        .setLayoutCount = 1,
+        .pSetLayouts = &xpbdObjcollDescLayout,
+    });
+
+    xpbdObjcollPipeline = createSimPipeline(SimKernel::xpbdObjcoll);
 
     xpbdObjcollDescSets = initDescriptorSets(xpbdObjcollDescLayout);
     for (uint32_t i = 0; i < frameCount; i++)
@@ -311,24 +431,20 @@ void Vulkan::initializeXpbdObjcollPipeline()
         setStorageBuffer(storageBuffer, storage.offset.x_, storage.size.x_, xpbdObjcollDescSets[i], 1);
         setStorageBuffer(storageBuffer, storage.offset.r, storage.size.r, xpbdObjcollDescSets[i], 2);
         setStorageBuffer(storageBuffer, storage.offset.dx, storage.size.dx, xpbdObjcollDescSets[i], 3);
+        setStorageBuffer(storageBuffer, storage.offset.state, storage.size.state, xpbdObjcollDescSets[i], 4);
+        setStorageBuffer(storageBuffer, storage.offset.island, storage.size.island, xpbdObjcollDescSets[i], 5);
+        setStorageBuffer(storageBuffer, storage.offset.islands, storage.size.islands, xpbdObjcollDescSets[i], 6);
+        setStorageBuffer(storageBuffer, storage.offset.filter, storage.size.filter, xpbdObjcollDescSets[i], 7);
+        setStorageBuffer(storageBuffer, storage.offset.chunks, storage.size.chunks, xpbdObjcollDescSets[i], 8);
     }
 }
 
 void Vulkan::initializeXpbdPcollPipeline()
 {
-    std::vector shaders{
-        Shader{
-            .name = "xpbd-pcoll",
-            .stage = ShaderStage::Compute,
-            .macros = {Shader::macro("g_n", particleWorkgroup.size)},
-        },
-    };
-    auto shaderStage = initializeShaders(shaders)[0];
-
     constexpr PushConstantRange pushConstantRange{
         .stageFlags = ShaderStageFlagBits::eCompute,
         .offset = 0,
-        .size = sizeof(glm::uint),
+        .size = 2 * sizeof(glm::uint),
     };
     xpbdPcollPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
         .setLayoutCount = 1,
@@ -337,14 +453,7 @@ void Vulkan::initializeXpbdPcollPipeline()
         .pPushConstantRanges = &pushConstantRange,
     });
 
-    std::tie(result, xpbdPcollPipeline) = device.createComputePipeline({}, ComputePipelineCreateInfo{
-                                                                               .stage = shaderStage,
-                                                                               .layout = xpbdPcollPipelineLayout,
-                                                                           });
-    if (result != Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create XPBD particle collide pipeline");
-    }
+    xpbdPcollPipeline = createSimPipeline(SimKernel::xpbdPcoll);
 
     xpbdPcollDescSets = initDescriptorSets(xpbdPcollDescLayout);
     for (DescriptorSet& set : xpbdPcollDescSets)
@@ -356,24 +465,19 @@ void Vulkan::initializeXpbdPcollPipeline()
         setStorageBuffer(storageBuffer, storage.offset.w, storage.size.w, set, 4);
         setStorageBuffer(storageBuffer, storage.offset.state, storage.size.state, set, 5);
         setStorageBuffer(storageBuffer, storage.offset.dx, storage.size.dx, set, 6);
+        setStorageBuffer(storageBuffer, storage.offset.key, storage.size.key, set, 7);
+        setStorageBuffer(storageBuffer, storage.offset.island, storage.size.island, set, 8);
+        setStorageBuffer(storageBuffer, storage.offset.islands, storage.size.islands, set, 9);
+        setStorageBuffer(storageBuffer, storage.offset.filter, storage.size.filter, set, 10);
     }
 }
 
 void Vulkan::initializeXpbdDistPipeline()
 {
-    std::vector shaders{
-        Shader{
-            .name = "xpbd-dist",
-            .stage = ShaderStage::Compute,
-            .macros = {Shader::macro("g_n", distWorkgroup.size)},
-        },
-    };
-    auto shaderStage = initializeShaders(shaders)[0];
-
     constexpr PushConstantRange pushConstantRange{
         .stageFlags = ShaderStageFlagBits::eCompute,
         .offset = 0,
-        .size = sizeof(float) + sizeof(glm::uint),
+        .size = sizeof(glm::uint),
     };
     xpbdDistPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
         .setLayoutCount = 1,
@@ -382,14 +486,7 @@ void Vulkan::initializeXpbdDistPipeline()
         .pPushConstantRanges = &pushConstantRange,
     });
 
-    std::tie(result, xpbdDistPipeline) = device.createComputePipeline({}, ComputePipelineCreateInfo{
-                                                                              .stage = shaderStage,
-                                                                              .layout = xpbdDistPipelineLayout,
-                                                                          });
-    if (result != Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create XPBD distance constrain pipeline");
-    }
+    xpbdDistPipeline = createSimPipeline(SimKernel::xpbdDist);
 
     xpbdDistDescSets = initDescriptorSets(xpbdDistDescLayout);
     for (DescriptorSet& set : xpbdDistDescSets)
@@ -398,24 +495,16 @@ void Vulkan::initializeXpbdDistPipeline()
         setStorageBuffer(storageBuffer, storage.offset.x_, storage.size.x_, set, 1);
         setStorageBuffer(storageBuffer, storage.offset.w, storage.size.w, set, 2);
         setStorageBuffer(storageBuffer, storage.offset.dxE7, storage.size.dxE7, set, 3);
+        setStorageBuffer(storageBuffer, storage.offset.state, storage.size.state, set, 4);
     }
 }
 
 void Vulkan::initializeXpbdVolPipeline()
 {
-    std::vector shaders{
-        Shader{
-            .name = "xpbd-vol",
-            .stage = ShaderStage::Compute,
-            .macros = {Shader::macro("g_n", volWorkgroup.size)},
-        },
-    };
-    auto shaderStage = initializeShaders(shaders)[0];
-
     constexpr PushConstantRange pushConstantRange{
         .stageFlags = ShaderStageFlagBits::eCompute,
         .offset = 0,
-        .size = sizeof(float) + sizeof(glm::uint),
+        .size = sizeof(glm::uint),
     };
     xpbdVolPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
         .setLayoutCount = 1,
@@ -424,14 +513,7 @@ void Vulkan::initializeXpbdVolPipeline()
         .pPushConstantRanges = &pushConstantRange,
     });
 
-    std::tie(result, xpbdVolPipeline) = device.createComputePipeline({}, ComputePipelineCreateInfo{
-                                                                             .stage = shaderStage,
-                                                                             .layout = xpbdVolPipelineLayout,
-                                                                         });
-    if (result != Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create XPBD volume constrain pipeline");
-    }
+    xpbdVolPipeline = createSimPipeline(SimKernel::xpbdVol);
 
     xpbdVolDescSets = initDescriptorSets(xpbdVolDescLayout);
     for (DescriptorSet& set : xpbdVolDescSets)
@@ -440,24 +522,16 @@ void Vulkan::initializeXpbdVolPipeline()
         setStorageBuffer(storageBuffer, storage.offset.x_, storage.size.x_, set, 1);
         setStorageBuffer(storageBuffer, storage.offset.w, storage.size.w, set, 2);
         setStorageBuffer(storageBuffer, storage.offset.dxE7, storage.size.dxE7, set, 3);
+        setStorageBuffer(storageBuffer, storage.offset.state, storage.size.state, set, 4);
     }
 }
 
 void Vulkan::initializeXpbdCorrectPipeline()
 {
-    std::vector shaders{
-        Shader{
-            .name = "xpbd-correct",
-            .stage = ShaderStage::Compute,
-            .macros = {Shader::macro("g_n", particleWorkgroup.size)},
-        },
-    };
-    auto shaderStage = initializeShaders(shaders)[0];
-
     constexpr PushConstantRange pushConstantRange{
         .stageFlags = ShaderStageFlagBits::eCompute,
         .offset = 0,
-        .size = sizeof(float) + sizeof(glm::uint),
+        .size = sizeof(glm::uint),
     };
     xpbdCorrectPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
         .setLayoutCount = 1,
@@ -466,14 +540,7 @@ void Vulkan::initializeXpbdCorrectPipeline()
         .pPushConstantRanges = &pushConstantRange,
     });
 
-    std::tie(result, xpbdCorrectPipeline) = device.createComputePipeline({}, ComputePipelineCreateInfo{
-                                                                                 .stage = shaderStage,
-                                                                                 .layout = xpbdCorrectPipelineLayout,
-                                                                             });
-    if (result != Result::eSuccess)
-    {
-        throw std::runtime_error("Failed to create XPBD correct pipeline");
-    }
+    xpbdCorrectPipeline = createSimPipeline(SimKernel::xpbdCorrect);
 
     xpbdCorrectDescSets = initDescriptorSets(xpbdCorrectDescLayout);
     for (DescriptorSet& set : xpbdCorrectDescSets)
@@ -487,6 +554,60 @@ void Vulkan::initializeXpbdCorrectPipeline()
     }
 }
 
+void Vulkan::initializeIslandSleepPipeline()
+{
+    constexpr PushConstantRange pushConstantRange{
+        .stageFlags = ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = sizeof(float) + 2 * sizeof(glm::uint),
+    };
+    islandSleepPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
+        .setLayoutCount = 1,
+        .pSetLayouts = &islandSleepDescLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    });
+
+    islandSleepPipeline = createSimPipeline(SimKernel::islandSleep);
+
+    islandSleepDescSets = initDescriptorSets(islandSleepDescLayout);
+    for (DescriptorSet& set : islandSleepDescSets)
+    {
+        setStorageBuffer(storageBuffer, storage.offset.islands, storage.size.islands, set, 0);
+        setStorageBuffer(storageBuffer, storage.offset.islandIdx, storage.size.islandIdx, set, 1);
+        setStorageBuffer(storageBuffer, storage.offset.v, storage.size.v, set, 2);
+        setStorageBuffer(storageBuffer, storage.offset.state, storage.size.state, set, 3);
+    }
+}
+
+void Vulkan::initializeSimStatsPipeline()
+{
+    constexpr PushConstantRange pushConstantRange{
+        .stageFlags = ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = sizeof(float) + 5 * sizeof(glm::uint),
+    };
+    simStatsPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
+        .setLayoutCount = 1,
+        .pSetLayouts = &simStatsDescLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    });
+
+    simStatsPipeline = createSimPipeline(SimKernel::simStats);
+
+    simStatsDescSets = initDescriptorSets(simStatsDescLayout);
+    for (DescriptorSet& set : simStatsDescSets)
+    {
+        setStorageBuffer(storageBuffer, storage.offset.x, storage.size.x, set, 0);
+        setStorageBuffer(storageBuffer, storage.offset.v, storage.size.v, set, 1);
+        setStorageBuffer(storageBuffer, storage.offset.w, storage.size.w, set, 2);
+        setStorageBuffer(storageBuffer, storage.offset.state, storage.size.state, set, 3);
+        setStorageBuffer(storageBuffer, storage.offset.distConstr, storage.size.distConstr, set, 4);
+        setStorageBuffer(statsBuffer, 0, batchSize * sizeof(SimStats), set, 5);
+    }
+}
+
 void Vulkan::initializeDepthPipeline()
 {
     std::vector shaders{
@@ -600,20 +721,20 @@ void Vulkan::initializeDepthPipeline()
         .depthAttachmentFormat = depthFormat,
     };
     std::tie(result, depthPipeline) =
-        device.createGraphicsPipeline({}, GraphicsPipelineCreateInfo{
-                                              .pNext = &rendering,
-                                              .stageCount = static_cast<uint32_t>(shaderStages.size()),
-                                              .pStages = shaderStages.data(),
-                                              .pVertexInputState = &vertexInputState,
-                                              .pInputAssemblyState = &inputAssemblyState,
-                                              .pViewportState = &viewportState,
-                                              .pRasterizationState = &rasterizationState,
-                                              .pMultisampleState = &multisampleState,
-                                              .pDepthStencilState = &depthStencilState,
-                                              .pColorBlendState = &colorBlendState,
-                                              .pDynamicState = &dynamicState,
-                                              .layout = depthPipelineLayout,
-                                          });
+        device.createGraphicsPipeline(pipelineCache, GraphicsPipelineCreateInfo{
+                                                         .pNext = &rendering,
+                                                         .stageCount = static_cast<uint32_t>(shaderStages.size()),
+                                                         .pStages = shaderStages.data(),
+                                                         .pVertexInputState = &vertexInputState,
+                                                         .pInputAssemblyState = &inputAssemblyState,
+                                                         .pViewportState = &viewportState,
+                                                         .pRasterizationState = &rasterizationState,
+                                                         .pMultisampleState = &multisampleState,
+                                                         .pDepthStencilState = &depthStencilState,
+                                                         .pColorBlendState = &colorBlendState,
+                                                         .pDynamicState = &dynamicState,
+                                                         .layout = depthPipelineLayout,
+                                                     });
     if (result != Result::eSuccess)
     {
         throw std::runtime_error("Failed to create depth pipeline");
@@ -621,38 +742,90 @@ void Vulkan::initializeDepthPipeline()
 
     multisampleState = {};
     std::tie(result, shadowPipeline) =
-        device.createGraphicsPipeline({}, GraphicsPipelineCreateInfo{
-                                              .pNext = &rendering,
-                                              .stageCount = static_cast<uint32_t>(shaderStages.size()),
-                                              .pStages = shaderStages.data(),
-                                              .pVertexInputState = &vertexInputState,
-                                              .pInputAssemblyState = &inputAssemblyState,
-                                              .pViewportState = &viewportState,
-                                              .pRasterizationState = &rasterizationState,
-                                              .pMultisampleState = &multisampleState,
-                                              .pDepthStencilState = &depthStencilState,
-                                              .pColorBlendState = &colorBlendState,
-                                              .pDynamicState = &dynamicState,
-                                              .layout = depthPipelineLayout,
-                                          });
+        device.createGraphicsPipeline(pipelineCache, GraphicsPipelineCreateInfo{
+                                                         .pNext = &rendering,
+                                                         .stageCount = static_cast<uint32_t>(shaderStages.size()),
+                                                         .pStages = shaderStages.data(),
+                                                         .pVertexInputState = &vertexInputState,
+                                                         .pInputAssemblyState = &inputAssemblyState,
+                                                         .pViewportState = &viewportState,
+                                                         .pRasterizationState = &rasterizationState,
+                                                         .pMultisampleState = &multisampleState,
+                                                         .pDepthStencilState = &depthStencilState,
+                                                         .pColorBlendState = &colorBlendState,
+                                                         .pDynamicState = &dynamicState,
+                                                         .layout = depthPipelineLayout,
+                                                     });
     if (result != Result::eSuccess)
     {
         throw std::runtime_error("Failed to create shadow pipeline");
     }
 
-    const DeviceSize positionsOffset = storage.offset.x + starParticleCount * sizeof(glm::float4);
-    const DeviceSize positionsSize = (particleCount - starParticleCount) * sizeof(glm::float4);
+    const DeviceSize positionsSize = batchParticleCount * sizeof(glm::float4);
+    for (uint32_t p = 0; p < positionBufferCount; p++)
+    {
+        const DeviceSize positionsOffset = storage.offset.xr[p] + starParticleCount * sizeof(glm::float4);
+        depthDescSets[p] = initDescriptorSets(depthDescLayout);
+        shadowDescSets[p] = initDescriptorSets(depthDescLayout);
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            setUniformBuffer(varUniformBuffers[i], cameraTransformUniformOffset, sizeof(TransformUniform),
+                             depthDescSets[p][i], 0);
+            setUniformBuffer(varUniformBuffers[i], lightTransformUniformOffset, sizeof(TransformUniform),
+                             shadowDescSets[p][i], 0);
+            setStorageBuffer(storageBuffer, positionsOffset, positionsSize, depthDescSets[p][i], 1);
+            setStorageBuffer(storageBuffer, positionsOffset, positionsSize, shadowDescSets[p][i], 1);
+        }
+    }
+}
 
-    depthDescSets = initDescriptorSets(depthDescLayout);
-    shadowDescSets = initDescriptorSets(depthDescLayout);
-    for (uint32_t i = 0; i < frameCount; i++)
+void Vulkan::initializeParticleCullPipeline()
+{
+    particleCullWorkgroup = gpu.selectWorkgroupDimensions(starParticleCount, 256, 0);
+    std::vector shaders{
+        Shader{
+            .name = "particle-cull",
+            .stage = ShaderStage::Compute,
+            .macros = {Shader::macro("g_n", particleCullWorkgroup.size),
+                       Shader::macro("WAVE", gpu.supportsWaveOps(particleCullWorkgroup.size) ? 1 : 0)},
+        },
+    };
+    auto shaderStages = initializeShaders(shaders);
+
+    constexpr PushConstantRange pushConstantRange{
+        .stageFlags = ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = sizeof(glm::float4x4) + 2 * sizeof(glm::float4) + sizeof(float) + sizeof(glm::uint),
+    };
+    particleCullPipelineLayout = device.createPipelineLayout(PipelineLayoutCreateInfo{
+        .setLayoutCount = 1,
+        .pSetLayouts = &particleCullDescLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange,
+    });
+
+    std::tie(result, particleCullPipeline) =
+        device.createComputePipeline(pipelineCache, ComputePipelineCreateInfo{
+                                                        .stage = shaderStages[0],
+                                                        .layout = particleCullPipelineLayout,
+                                                    });
+    if (result != Result::eSuccess)
+    {
+        throw std::runtime_error("Failed to create particle cull pipeline");
+    }
+
+    for (uint32_t p = 0; p < positionBufferCount; p++)
     {
-        setUniformBuffer(varUniformBuffers[i], cameraTransformUniformOffset, sizeof(TransformUniform), depthDescSets[i],
-                         0);
-        setUniformBuffer(varUniformBuffers[i], lightTransformUniformOffset, sizeof(TransformUniform), shadowDescSets[i],
-                         0);
-        setStorageBuffer(storageBuffer, positionsOffset, positionsSize, depthDescSets[i], 1);
-        setStorageBuffer(storageBuffer, positionsOffset, positionsSize, shadowDescSets[i], 1);
+        particleCullDescSets[p] = initDescriptorSets(particleCullDescLayout);
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            setStorageBuffer(storageBuffer, storage.offset.xr[p], starParticleCount * sizeof(glm::float4),
+                             particleCullDescSets[p][i], 0);
+            setStorageBuffer(particleCullBuffers[i], 0, sizeof(DrawIndexedIndirectCommand), particleCullDescSets[p][i],
+                             1);
+            setStorageBuffer(particleCullBuffers[i], particleInstanceOffset, starParticleCount * sizeof(glm::uint),
+                             particleCullDescSets[p][i], 2);
+        }
     }
 }
 
@@ -743,20 +916,20 @@ void Vulkan::initializeParticleDepthPipeline()
         .depthAttachmentFormat = depthFormat,
     };
     std::tie(result, particleDepthPipeline) =
-        device.createGraphicsPipeline({}, GraphicsPipelineCreateInfo{
-                                              .pNext = &rendering,
-                                              .stageCount = static_cast<uint32_t>(shaderStages.size()),
-                                              .pStages = shaderStages.data(),
-                                              .pVertexInputState = &vertexInputState,
-                                              .pInputAssemblyState = &inputAssemblyState,
-                                              .pViewportState = &viewportState,
-                                              .pRasterizationState = &rasterizationState,
-                                              .pMultisampleState = &multisampleState,
-                                              .pDepthStencilState = &depthStencilState,
-                                              .pColorBlendState = &colorBlendState,
-                                              .pDynamicState = &dynamicState,
-                                              .layout = particleDepthPipelineLayout,
-                                          });
+        device.createGraphicsPipeline(pipelineCache, GraphicsPipelineCreateInfo{
+                                                         .pNext = &rendering,
+                                                         .stageCount = static_cast<uint32_t>(shaderStages.size()),
+                                                         .pStages = shaderStages.data(),
+                                                         .pVertexInputState = &vertexInputState,
+                                                         .pInputAssemblyState = &inputAssemblyState,
+                                                         .pViewportState = &viewportState,
+                                                         .pRasterizationState = &rasterizationState,
+                                                         .pMultisampleState = &multisampleState,
+                                                         .pDepthStencilState = &depthStencilState,
+                                                         .pColorBlendState = &colorBlendState,
+                                                         .pDynamicState = &dynamicState,
+                                                         .layout = particleDepthPipelineLayout,
+                                                     });
     if (result != Result::eSuccess)
     {
         throw std::runtime_error("Failed to create particle depth pipeline");
@@ -871,48 +1044,51 @@ void Vulkan::initializeLightingPipeline()
         .depthAttachmentFormat = depthImage.format,
     };
     std::tie(result, lightingPipeline) =
-        device.createGraphicsPipeline({}, GraphicsPipelineCreateInfo{
-                                              .pNext = &rendering,
-                                              .stageCount = static_cast<uint32_t>(shaderStages.size()),
-                                              .pStages = shaderStages.data(),
-                                              .pVertexInputState = &vertexInputState,
-                                              .pInputAssemblyState = &inputAssemblyState,
-                                              .pViewportState = &viewportState,
-                                              .pRasterizationState = &rasterizationState,
-                                              .pMultisampleState = &multisampleState,
-                                              .pDepthStencilState = &depthStencilState,
-                                              .pColorBlendState = &colorBlendState,
-                                              .pDynamicState = &dynamicState,
-                                              .layout = lightingPipelineLayout,
-                                          });
+        device.createGraphicsPipeline(pipelineCache, GraphicsPipelineCreateInfo{
+                                                         .pNext = &rendering,
+                                                         .stageCount = static_cast<uint32_t>(shaderStages.size()),
+                                                         .pStages = shaderStages.data(),
+                                                         .pVertexInputState = &vertexInputState,
+                                                         .pInputAssemblyState = &inputAssemblyState,
+                                                         .pViewportState = &viewportState,
+                                                         .pRasterizationState = &rasterizationState,
+                                                         .pMultisampleState = &multisampleState,
+                                                         .pDepthStencilState = &depthStencilState,
+                                                         .pColorBlendState = &colorBlendState,
+                                                         .pDynamicState = &dynamicState,
+                                                         .layout = lightingPipelineLayout,
+                                                     });
     if (result != Result::eSuccess)
     {
         throw std::runtime_error("Failed to create lighting pipeline");
     }
 
     setupGraphics();
-    brdfImage =
-        initTextureImage(ImageUsageFlagBits::eSampled, ImageData::loadKhronosTexture("brdf")[0][0], ColorSpace::linear);
-    irradianceImage = initTextureCubemap(ImageUsageFlagBits::eSampled, ImageData::loadKhronosTexture("irradiance"));
-    radianceImage = initTextureCubemap(ImageUsageFlagBits::eSampled, ImageData::loadKhronosTexture("radiance"));
+    brdfImage = initKhronosTexture(ImageUsageFlagBits::eSampled, "brdf", {}, ColorSpace::linear);
+    irradianceImage = initKhronosTexture(ImageUsageFlagBits::eSampled, "irradiance");
+    radianceImage = initKhronosTexture(ImageUsageFlagBits::eSampled, "radiance");
     shadowImage =
         createImage(ImageViewType::e2D, shadowRes, shadowRes, 1, 1, SampleCountFlagBits::e1, depthFormat,
                     ImageTiling::eOptimal, ImageUsageFlagBits::eDepthStencilAttachment | ImageUsageFlagBits::eSampled);
     transitionImageLayout(shadowImage, ImageLayout::eUndefined, ImageLayout::eDepthStencilAttachmentOptimal);
     playGraphics();
 
-    sceneDescSets = initDescriptorSets(sceneDescLayout);
-    for (uint32_t i = 0; i < frameCount; i++)
+    for (uint32_t p = 0; p < positionBufferCount; p++)
     {
-        setUniformBuffer(varUniformBuffers[i], sceneUniformOffset, sizeof(SceneUniform), sceneDescSets[i], 0);
-        setCombinedImageSampler({}, brdfImage, sceneDescSets[i], 1);
-        setCombinedImageSampler({}, irradianceImage, sceneDescSets[i], 2);
-        setCombinedImageSampler({}, radianceImage, sceneDescSets[i], 3);
-        setUniformBuffer(varUniformBuffers[i], viewProjectionUniformOffset, sizeof(ViewProjectionUniform),
-                         sceneDescSets[i], 4);
-        setSampledImage(shadowImage, sceneDescSets[i], 5);
-        setStorageBuffer(storageBuffer, storage.offset.x + starParticleCount * sizeof(glm::float4),
-                         (particleCount - starParticleCount) * sizeof(glm::float4), sceneDescSets[i], 7);
+        sceneDescSets[p] = initDescriptorSets(sceneDescLayout);
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            DescriptorSet& set = sceneDescSets[p][i];
+            setUniformBuffer(varUniformBuffers[i], sceneUniformOffset, sizeof(SceneUniform), set, 0);
+            setCombinedImageSampler({}, brdfImage, set, 1);
+            setCombinedImageSampler({}, irradianceImage, set, 2);
+            setCombinedImageSampler({}, radianceImage, set, 3);
+            setUniformBuffer(varUniformBuffers[i], viewProjectionUniformOffset, sizeof(ViewProjectionUniform), set,
+                             4);
+            setSampledImage(shadowImage, set, 5);
+            setStorageBuffer(storageBuffer, storage.offset.xr[p] + starParticleCount * sizeof(glm::float4),
+                             batchParticleCount * sizeof(glm::float4), set, 7);
+        }
     }
 
     inactiveSkinDescSets = initDescriptorSets(skinDescLayout);
@@ -1038,29 +1214,35 @@ void Vulkan::initializeParticlePipeline()
         .depthAttachmentFormat = depthImage.format,
     };
     std::tie(result, particlePipeline) =
-        device.createGraphicsPipeline({}, GraphicsPipelineCreateInfo{
-                                              .pNext = &rendering,
-                                              .stageCount = static_cast<uint32_t>(shaderStages.size()),
-                                              .pStages = shaderStages.data(),
-                                              .pVertexInputState = &vertexInputState,
-                                              .pInputAssemblyState = &inputAssemblyState,
-                                              .pViewportState = &viewportState,
-                                              .pRasterizationState = &rasterizationState,
-                                              .pMultisampleState = &multisampleState,
-                                              .pDepthStencilState = &depthStencilState,
-                                              .pColorBlendState = &colorBlendState,
-                                              .pDynamicState = &dynamicState,
-                                              .layout = particlePipelineLayout,
-                                          });
+        device.createGraphicsPipeline(pipelineCache, GraphicsPipelineCreateInfo{
+                                                         .pNext = &rendering,
+                                                         .stageCount = static_cast<uint32_t>(shaderStages.size()),
+                                                         .pStages = shaderStages.data(),
+                                                         .pVertexInputState = &vertexInputState,
+                                                         .pInputAssemblyState = &inputAssemblyState,
+                                                         .pViewportState = &viewportState,
+                                                         .pRasterizationState = &rasterizationState,
+                                                         .pMultisampleState = &multisampleState,
+                                                         .pDepthStencilState = &depthStencilState,
+                                                         .pColorBlendState = &colorBlendState,
+                                                         .pDynamicState = &dynamicState,
+                                                         .layout = particlePipelineLayout,
+                                                     });
     if (result != Result::eSuccess)
     {
         throw std::runtime_error("Failed to create particle pipeline");
     }
 
-    particleDescSets = initDescriptorSets(particleDescLayout);
-    for (DescriptorSet& set : particleDescSets)
+    for (uint32_t p = 0; p < positionBufferCount; p++)
     {
-        setStorageBuffer(storageBuffer, storage.offset.x, starParticleCount * sizeof(glm::float4), set, 0);
+        particleDescSets[p] = initDescriptorSets(particleDescLayout);
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            setStorageBuffer(storageBuffer, storage.offset.xr[p], starParticleCount * sizeof(glm::float4),
+                             particleDescSets[p][i], 0);
+            setStorageBuffer(particleCullBuffers[i], particleInstanceOffset, starParticleCount * sizeof(glm::uint),
+                             particleDescSets[p][i], 1);
+        }
     }
 }
 
@@ -1173,27 +1355,27 @@ void Vulkan::initializeSkyboxPipeline()
         .depthAttachmentFormat = depthImage.format,
     };
     std::tie(result, skyboxPipeline) =
-        device.createGraphicsPipeline({}, GraphicsPipelineCreateInfo{
-                                              .pNext = &rendering,
-                                              .stageCount = static_cast<uint32_t>(shaderStages.size()),
-                                              .pStages = shaderStages.data(),
-                                              .pVertexInputState = &vertexInputState,
-                                              .pInputAssemblyState = &inputAssemblyState,
-                                              .pViewportState = &viewportState,
-                                              .pRasterizationState = &rasterizationState,
-                                              .pMultisampleState = &multisampleState,
-                                              .pDepthStencilState = &depthStencilState,
-                                              .pColorBlendState = &colorBlendState,
-                                              .pDynamicState = &dynamicState,
-                                              .layout = skyboxPipelineLayout,
-                                          });
+        device.createGraphicsPipeline(pipelineCache, GraphicsPipelineCreateInfo{
+                                                         .pNext = &rendering,
+                                                         .stageCount = static_cast<uint32_t>(shaderStages.size()),
+                                                         .pStages = shaderStages.data(),
+                                                         .pVertexInputState = &vertexInputState,
+                                                         .pInputAssemblyState = &inputAssemblyState,
+                                                         .pViewportState = &viewportState,
+                                                         .pRasterizationState = &rasterizationState,
+                                                         .pMultisampleState = &multisampleState,
+                                                         .pDepthStencilState = &depthStencilState,
+                                                         .pColorBlendState = &colorBlendState,
+                                                         .pDynamicState = &dynamicState,
+                                                         .layout = skyboxPipelineLayout,
+                                                     });
     if (result != Result::eSuccess)
     {
         throw std::runtime_error("Failed to create skybox pipeline");
     }
 
     setupGraphics();
-    skyboxImage = initTextureCubemap(ImageUsageFlagBits::eSampled, ImageData::loadKhronosTexture("starmap"));
+    skyboxImage = initKhronosTexture(ImageUsageFlagBits::eSampled, "starmap");
     playGraphics();
 
     skyboxDescSets = initDescriptorSets(skyboxDescLayout);
@@ -1274,20 +1456,20 @@ void Vulkan::initializePostPipeline()
         .pColorAttachmentFormats = &swapchainFormat,
     };
     std::tie(result, postPipeline) =
-        device.createGraphicsPipeline({}, GraphicsPipelineCreateInfo{
-                                              .pNext = &rendering,
-                                              .stageCount = static_cast<uint32_t>(shaderStages.size()),
-                                              .pStages = shaderStages.data(),
-                                              .pVertexInputState = &vertexInputState,
-                                              .pInputAssemblyState = &inputAssemblyState,
-                                              .pViewportState = &viewportState,
-                                              .pRasterizationState = &rasterizationState,
-                                              .pMultisampleState = &multisampleState,
-                                              .pDepthStencilState = &depthStencilState,
-                                              .pColorBlendState = &colorBlendState,
-                                              .pDynamicState = &dynamicState,
-                                              .layout = postPipelineLayout,
-                                          });
+        device.createGraphicsPipeline(pipelineCache, GraphicsPipelineCreateInfo{
+                                                         .pNext = &rendering,
+                                                         .stageCount = static_cast<uint32_t>(shaderStages.size()),
+                                                         .pStages = shaderStages.data(),
+                                                         .pVertexInputState = &vertexInputState,
+                                                         .pInputAssemblyState = &inputAssemblyState,
+                                                         .pViewportState = &viewportState,
+                                                         .pRasterizationState = &rasterizationState,
+                                                         .pMultisampleState = &multisampleState,
+                                                         .pDepthStencilState = &depthStencilState,
+                                                         .pColorBlendState = &colorBlendState,
+                                                         .pDynamicState = &dynamicState,
+                                                         .layout = postPipelineLayout,
+                                                     });
     if (result != Result::eSuccess)
     {
         throw std::runtime_error("Failed to create post pipeline");
@@ -1304,6 +1486,7 @@ void Vulkan::initializePostPipeline()
 
 void Vulkan::initializeGuiPipeline()
 {
+    Profiler::Scope scope("initialize pipeline", "gui");
     std::vector shaders{
         Shader{
             .name = "gui",
@@ -1410,20 +1593,20 @@ void Vulkan::initializeGuiPipeline()
         .pColorAttachmentFormats = &swapchainFormat,
     };
     std::tie(result, guiPipeline) =
-        device.createGraphicsPipeline({}, GraphicsPipelineCreateInfo{
-                                              .pNext = &rendering,
-                                              .stageCount = static_cast<uint32_t>(shaderStages.size()),
-                                              .pStages = shaderStages.data(),
-                                              .pVertexInputState = &vertexInputState,
-                                              .pInputAssemblyState = &inputAssemblyState,
-                                              .pViewportState = &viewportState,
-                                              .pRasterizationState = &rasterizationState,
-                                              .pMultisampleState = &multisampleState,
-                                              .pDepthStencilState = &depthStencilState,
-                                              .pColorBlendState = &colorBlendState,
-                                              .pDynamicState = &dynamicState,
-                                              .layout = guiPipelineLayout,
-                                          });
+        device.createGraphicsPipeline(pipelineCache, GraphicsPipelineCreateInfo{
+                                                         .pNext = &rendering,
+                                                         .stageCount = static_cast<uint32_t>(shaderStages.size()),
+                                                         .pStages = shaderStages.data(),
+                                                         .pVertexInputState = &vertexInputState,
+                                                         .pInputAssemblyState = &inputAssemblyState,
+                                                         .pViewportState = &viewportState,
+                                                         .pRasterizationState = &rasterizationState,
+                                                         .pMultisampleState = &multisampleState,
+                                                         .pDepthStencilState = &depthStencilState,
+                                                         .pColorBlendState = &colorBlendState,
+                                                         .pDynamicState = &dynamicState,
+                                                         .layout = guiPipelineLayout,
+                                                     });
     if (result != Result::eSuccess)
     {
         throw std::runtime_error("Failed to create GUI pipeline");
@@ -1,11 +1,13 @@
 #include "Vulkan.h"
 
 #include "Engine.h"
+#include "Profiler.h"
 
 using namespace vk;
 
 void Vulkan::initializeSwapchain()
 {
+    Profiler::Scope scope("initialize swapchain");
     gpu.querySwapchainSupport(surface);
 
     // Create the swapchain.
@@ -81,6 +83,8 @@ void Vulkan::updateScene()
 {
     using namespace glm;
 
+    readSimStats();
+
     // Update the cinematic bar height, frame brightness, star regeneration progress, and lightness blend value
     // depending on the game state.
     float lightness = 1.0f;
@@ -96,7 +100,7 @@ void Vulkan::updateScene()
     {
         bar = lerp(0.0f, 0.1f, fadeOut(engine.stateTime, 0.0f, 3.0f));
         brightness = fadeIn(engine.stateTime, 0.0f, 1.5f);
-        starProgress = saturate(static_cast<float>(counterBuffer.as<glm::uint>()) / 700.0f);
+        starProgress = saturate(static_cast<float>(simStats.counter) / 700.0f);
         lightness = starProgress * starProgress;
     }
     else if (engine.state == Engine::State::Finale)
@@ -157,8 +161,43 @@ void Vulkan::recordRendering(vk::CommandBuffer& renderBuffer, AllocatedImage& sw
     renderBuffer.begin(CommandBufferBeginInfo{});
     activate(renderBuffer);
 
+    // Render the particle positions of the last submitted update.
+    const uint32_t positionIndex = updateCount % positionBufferCount;
+
     transitionImageLayout(swapchainImage, ImageLayout::eUndefined, ImageLayout::eColorAttachmentOptimal);
 
+    // Record the particle cull pass.
+    // The star particles outside the view frustum, behind the moon or parked in the star core are culled,
+    // so that the particle draws only process the compacted visible particle indices.
+    AllocatedBuffer& particleCullBuffer = particleCullBuffers[frameIndex];
+    if (starParticlesActive)
+    {
+        clearBuffer(particleCullBuffer, 0, offsetof(DrawIndexedIndirectCommand, instanceCount), sizeof(uint32_t));
+        syncBufferAccess(particleCullBuffer, PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferWrite,
+                         PipelineStageFlagBits::eComputeShader,
+                         AccessFlagBits::eShaderRead | AccessFlagBits::eShaderWrite, 0,
+                         sizeof(DrawIndexedIndirectCommand));
+        renderBuffer.bindPipeline(PipelineBindPoint::eCompute, particleCullPipeline);
+        renderBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, particleCullPipelineLayout, 0,
+                                        particleCullDescSets[positionIndex][frameIndex], {});
+        renderBuffer.pushConstants<glm::float4x4>(particleCullPipelineLayout, ShaderStageFlagBits::eCompute, 0,
+                                                  viewProjection.camera);
+        renderBuffer.pushConstants<glm::float4>(particleCullPipelineLayout, ShaderStageFlagBits::eCompute,
+                                                sizeof(glm::float4x4), scene.viewPosition);
+        renderBuffer.pushConstants<glm::float4>(particleCullPipelineLayout, ShaderStageFlagBits::eCompute,
+                                                sizeof(glm::float4x4) + sizeof(glm::float4),
+                                                glm::float4{starPosition, starCoreRadius});
+        renderBuffer.pushConstants<float>(particleCullPipelineLayout, ShaderStageFlagBits::eCompute,
+                                          sizeof(glm::float4x4) + 2 * sizeof(glm::float4), starParticleRadius);
+        renderBuffer.pushConstants<glm::uint>(particleCullPipelineLayout, ShaderStageFlagBits::eCompute,
+                                              sizeof(glm::float4x4) + 2 * sizeof(glm::float4) + sizeof(float),
+                                              starParticleCount);
+        renderBuffer.dispatch(particleCullWorkgroup.count, 1, 1);
+        syncBufferAccess(particleCullBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                         PipelineStageFlagBits::eDrawIndirect | PipelineStageFlagBits::eVertexShader,
+                         AccessFlagBits::eIndirectCommandRead | AccessFlagBits::eShaderRead);
+    }
+
     // Record the shadow pass.
     RenderingAttachmentInfo depthAttachment{
         .imageView = shadowImage.view,
@@ -189,13 +228,17 @@ void Vulkan::recordRendering(vk::CommandBuffer& renderBuffer, AllocatedImage& sw
                                    .offset = {0, 0},
                                    .extent = {shadowRes, shadowRes},
                                });
-    renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, depthPipelineLayout, 0, shadowDescSets[frameIndex],
-                                    {});
+    renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, depthPipelineLayout, 0,
+                                    shadowDescSets[positionIndex][frameIndex], {});
     Model::Skin* activeSkin{};
     renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, depthPipelineLayout, 1,
                                     inactiveSkinDescSets[frameIndex], {});
     for (const Model& model : models)
     {
+        if (model.residency != Model::Residency::resident)
+        {
+            continue;
+        }
         for (const Model::Material& material : model.materials)
         {
             for (const Model::Node* node : material.nodes)
@@ -265,13 +308,17 @@ void Vulkan::recordRendering(vk::CommandBuffer& renderBuffer, AllocatedImage& sw
                                    .offset = {0, 0},
                                    .extent = swapchainExtent,
                                });
-    renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, depthPipelineLayout, 0, depthDescSets[frameIndex],
-                                    {});
+    renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, depthPipelineLayout, 0,
+                                    depthDescSets[positionIndex][frameIndex], {});
     activeSkin = {};
     renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, depthPipelineLayout, 1,
                                     inactiveSkinDescSets[frameIndex], {});
     for (const Model& model : models)
     {
+        if (model.residency != Model::Residency::resident)
+        {
+            continue;
+        }
         for (const Model::Material& material : model.materials)
         {
             for (const Model::Node* node : material.nodes)
@@ -310,14 +357,14 @@ void Vulkan::recordRendering(vk::CommandBuffer& renderBuffer, AllocatedImage& sw
     {
         renderBuffer.bindPipeline(PipelineBindPoint::eGraphics, particleDepthPipeline);
         renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, particleDepthPipelineLayout, 0,
-                                        particleDescSets[frameIndex], {});
+                                        particleDescSets[positionIndex][frameIndex], {});
         renderBuffer.pushConstants<glm::float4x4>(particleDepthPipelineLayout, ShaderStageFlagBits::eVertex, 0,
                                                   viewProjection.camera);
         renderBuffer.pushConstants<float>(particleDepthPipelineLayout, ShaderStageFlagBits::eVertex,
                                           sizeof(glm::float4x4), starParticleRadius);
         renderBuffer.bindVertexBuffers(0, vertexBuffer(), particleVertexOffset);
         renderBuffer.bindIndexBuffer(indexBuffer(), particleIndexOffset, IndexType::eUint16);
-        renderBuffer.drawIndexed(particleIndexCount, starParticleCount, 0, 0, 0);
+        renderBuffer.drawIndexedIndirect(particleCullBuffer(), 0, 1, sizeof(DrawIndexedIndirectCommand));
     }
     renderBuffer.endRendering();
 
@@ -380,13 +427,17 @@ void Vulkan::recordRendering(vk::CommandBuffer& renderBuffer, AllocatedImage& sw
                                    .offset = {0, 0},
                                    .extent = swapchainExtent,
                                });
-    renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, lightingPipelineLayout, 0, sceneDescSets[frameIndex],
-                                    {});
+    renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, lightingPipelineLayout, 0,
+                                    sceneDescSets[positionIndex][frameIndex], {});
     activeSkin = {};
     renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, lightingPipelineLayout, 2,
                                     inactiveSkinDescSets[frameIndex], {});
     for (const Model& model : models)
     {
+        if (model.residency != Model::Residency::resident)
+        {
+            continue;
+        }
         for (const Model::Material& material : model.materials)
         {
             renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, lightingPipelineLayout, 1,
@@ -433,7 +484,7 @@ void Vulkan::recordRendering(vk::CommandBuffer& renderBuffer, AllocatedImage& sw
     {
         renderBuffer.bindPipeline(PipelineBindPoint::eGraphics, particlePipeline);
         renderBuffer.bindDescriptorSets(PipelineBindPoint::eGraphics, particlePipelineLayout, 0,
-                                        particleDescSets[frameIndex], {});
+                                        particleDescSets[positionIndex][frameIndex], {});
         renderBuffer.pushConstants<glm::float4x4>(particlePipelineLayout, ShaderStageFlagBits::eVertex, 0,
                                                   viewProjection.camera);
         renderBuffer.pushConstants<float>(particlePipelineLayout, ShaderStageFlagBits::eVertex, sizeof(glm::float4x4),
@@ -444,7 +495,7 @@ void Vulkan::recordRendering(vk::CommandBuffer& renderBuffer, AllocatedImage& sw
                                           sizeof(glm::float4x4) + 2 * sizeof(float), scene.exposure);
         renderBuffer.bindVertexBuffers(0, vertexBuffer(), particleVertexOffset);
         renderBuffer.bindIndexBuffer(indexBuffer(), particleIndexOffset, IndexType::eUint16);
-        renderBuffer.drawIndexed(particleIndexCount, starParticleCount, 0, 0, 0);
+        renderBuffer.drawIndexedIndirect(particleCullBuffer(), 0, 1, sizeof(DrawIndexedIndirectCommand));
     }
     renderBuffer.bindPipeline(PipelineBindPoint::eGraphics, skyboxPipeline);
     renderBuffer.pushConstants<glm::float4x4>(skyboxPipelineLayout, ShaderStageFlagBits::eVertex, 0,
@@ -641,6 +692,8 @@ void Vulkan::renderGui(vk::CommandBuffer& renderBuffer)
 
 void Vulkan::render()
 {
+    updateStreaming();
+
     result = device.waitForFences(frameInFlight[frameIndex], true, UINT64_MAX);
 
     // Acquire the next available presentable image.
@@ -665,21 +718,31 @@ void Vulkan::render()
 
     recordRendering(renderBuffers[frameIndex], swapchainImages[imageIndex]);
 
-    const std::array waitSemaphoreValues{updateCount, static_cast<uint64_t>(0)};
-    constexpr uint64_t signalSemaphoreValue{0};
+    // Signal the render frame count once the frame has read the rendered position buffer of the last update.
+    // Wait for the submitted uploads, which are not waited for on the host.
+    renderCount++;
+    positionReadCounts[updateCount % positionBufferCount] = renderCount;
+    const std::array waitSemaphoreValues{updateCount, static_cast<uint64_t>(0), uploadCount};
+    const std::array signalSemaphoreValues{static_cast<uint64_t>(0), renderCount};
     const TimelineSemaphoreSubmitInfo semaphoreValues{
         .waitSemaphoreValueCount = waitSemaphoreValues.size(),
         .pWaitSemaphoreValues = waitSemaphoreValues.data(),
-        .signalSemaphoreValueCount = 1,
-        .pSignalSemaphoreValues = &signalSemaphoreValue,
+        .signalSemaphoreValueCount = signalSemaphoreValues.size(),
+        .pSignalSemaphoreValues = signalSemaphoreValues.data(),
     };
     const std::array waitSemaphores{
         simComplete,
         imageAcquired[frameIndex],
+        uploadComplete,
     };
     constexpr std::array waitDstStages{
-        PipelineStageFlags{PipelineStageFlagBits::eVertexShader},
+        PipelineStageFlags{PipelineStageFlagBits::eComputeShader | PipelineStageFlagBits::eVertexShader},
         PipelineStageFlags{PipelineStageFlagBits::eColorAttachmentOutput},
+        PipelineStageFlags{PipelineStageFlagBits::eAllCommands},
+    };
+    const std::array signalSemaphores{
+        renderComplete[frameIndex],
+        renderRead,
     };
     graphicsQueue.submit(
         SubmitInfo{
@@ -689,8 +752,8 @@ void Vulkan::render()
             .pWaitDstStageMask = waitDstStages.data(),
             .commandBufferCount = 1,
             .pCommandBuffers = &renderBuffers[frameIndex],
-            .signalSemaphoreCount = 1,
-            .pSignalSemaphores = &renderComplete[frameIndex],
+            .signalSemaphoreCount = signalSemaphores.size(),
+            .pSignalSemaphores = signalSemaphores.data(),
         },
         frameInFlight[frameIndex]);
 
@@ -1,8 +1,14 @@
 #include "Vulkan.h"
 
+#include "Archive.h"
 #include "Engine.h"
+#include "Profiler.h"
+#include "TetMesh.h"
 #include <glm/gtx/hash.hpp>
+#include <iostream>
 #include <mshio/mshio.h>
+#include <numeric>
+#include <queue>
 #include <random>
 #include <unordered_set>
 
@@ -20,6 +26,7 @@ void Vulkan::generateStarParticles()
     storage.r.reserve(starParticleCount);
     storage.w.reserve(starParticleCount);
     storage.state.reserve(starParticleCount);
+    storage.filter.reserve(starParticleCount);
     for (uint32_t i = 0; i < starParticleCount; i++)
     {
         // Generate particles around the moon at 5m height.
@@ -43,19 +50,34 @@ void Vulkan::generateStarParticles()
         storage.r.emplace_back(starParticleRadius);
         storage.w.emplace_back(0.001f);
         storage.state.emplace_back(static_cast<glm::uint>(State::STATIC));
+        storage.filter.emplace_back(starParticleCollisionFilter);
     }
+
+    // The star particles are bounded as one body.
+    storage.bodies.emplace_back(Body{.begin = 0, .end = starParticleCount});
 }
 
 MeshEmbedding Vulkan::loadMesh(const std::string& model, const std::string& mesh, float compliance, float density,
-                               const std::vector<uint32_t>& staticNodes, const glm::float4x4& transformation)
+                               const std::vector<uint32_t>& staticNodes, const glm::float4x4& transformation,
+                               uint32_t lod, glm::uint filter)
 {
+    Profiler::Scope scope("load simulation mesh", model + "/" + mesh);
     static constexpr float sixth = 1.0f / 6.0f;
 
     Mesh data{};
 
     // Load the mesh specification.
     const std::string path = modelMeshPath(model, mesh).string();
-    const auto spec = mshio::load_msh(path);
+    mshio::MshSpec spec;
+    if (const Data blob = Archive::assets().find(path); blob.data)
+    {
+        Archive::Stream stream(blob);
+        spec = mshio::load_msh(stream);
+    }
+    else
+    {
+        spec = mshio::load_msh(path);
+    }
     if (spec.nodes.num_entity_blocks != 1 || spec.elements.num_entity_blocks != 1)
     {
         throw std::runtime_error("Failed to load mesh [" + mesh + "] of model [" + model +
@@ -84,7 +106,7 @@ MeshEmbedding Vulkan::loadMesh(const std::string& model, const std::string& mesh
     // Initialize the nodes.
     const auto& nodeTags = nodeBlock.tags;
     const auto& nodeData = nodeBlock.data;
-    const size_t nodeCount = nodeBlock.num_nodes_in_block;
+    size_t nodeCount = nodeBlock.num_nodes_in_block;
     std::unordered_map<size_t, size_t> nodeTagsToIndices{};
     nodeTagsToIndices.reserve(nodeCount);
     const size_t nodeOffset = storage.x.size();
@@ -93,6 +115,7 @@ MeshEmbedding Vulkan::loadMesh(const std::string& model, const std::string& mesh
     storage.r.reserve(nodeOffset + nodeCount);
     storage.w.reserve(nodeOffset + nodeCount);
     storage.state.reserve(nodeOffset + nodeCount);
+    storage.filter.reserve(nodeOffset + nodeCount);
     for (size_t i = 0; i < nodeCount; i++)
     {
         nodeTagsToIndices[nodeTags[i]] = nodeOffset + i;
@@ -102,36 +125,101 @@ MeshEmbedding Vulkan::loadMesh(const std::string& model, const std::string& mesh
         storage.r.emplace_back(std::numeric_limits<float>::max());
         storage.w.emplace_back(0.0f);
         storage.state.emplace_back(static_cast<glm::uint>(State::FREE));
+        storage.filter.emplace_back(filter);
     }
 
     // Initialize the elements.
     const auto& elementData = elementBlock.data;
     const size_t elementCount = elementBlock.num_elements_in_block;
     data.elements.reserve(elementCount);
+    for (size_t i = 0; i < elementCount; i++)
+    {
+        if (data.tet)
+        {
+            data.elements.emplace_back(uvec4{
+                nodeTagsToIndices[elementData[5 * i + 1]],
+                nodeTagsToIndices[elementData[5 * i + 2]],
+                nodeTagsToIndices[elementData[5 * i + 3]],
+                nodeTagsToIndices[elementData[5 * i + 4]],
+            });
+        }
+        else
+        {
+            data.elements.emplace_back(uvec4{
+                nodeTagsToIndices[elementData[4 * i + 1]],
+                nodeTagsToIndices[elementData[4 * i + 2]],
+                nodeTagsToIndices[elementData[4 * i + 3]],
+                nodeTagsToIndices[elementData[4 * i + 1]],
+            });
+        }
+    }
+
+    // Set the correct state for the static nodes.
+    for (const uint32_t tag : staticNodes)
+    {
+        storage.state[nodeTagsToIndices[tag]] = static_cast<glm::uint>(State::STATIC);
+    }
+
+    if (data.tet && lod > 0)
+    {
+        // Replace the nodes and elements with a coarser level of detail.
+        TetMesh tetMesh{};
+        tetMesh.positions.reserve(nodeCount);
+        tetMesh.fixed.reserve(nodeCount);
+        for (size_t i = nodeOffset; i < nodeOffset + nodeCount; i++)
+        {
+            tetMesh.positions.emplace_back(storage.x[i]);
+            tetMesh.fixed.emplace_back(storage.state[i] == static_cast<glm::uint>(State::STATIC));
+        }
+        tetMesh.elements.reserve(elementCount);
+        for (const uvec4& element : data.elements)
+        {
+            tetMesh.elements.emplace_back(element - static_cast<uint32_t>(nodeOffset));
+        }
+        tetMesh = tetMesh.coarsen(lod);
+
+        nodeCount = tetMesh.positions.size();
+        storage.x.resize(nodeOffset);
+        storage.v.resize(nodeOffset);
+        storage.r.resize(nodeOffset);
+        storage.w.resize(nodeOffset);
+        storage.state.resize(nodeOffset);
+        storage.filter.resize(nodeOffset);
+        for (size_t i = 0; i < nodeCount; i++)
+        {
+            storage.x.emplace_back(float4{tetMesh.positions[i], 1.0f});
+            storage.v.emplace_back(float4{});
+            storage.r.emplace_back(std::numeric_limits<float>::max());
+            storage.w.emplace_back(0.0f);
+            storage.state.emplace_back(static_cast<glm::uint>(tetMesh.fixed[i] ? State::STATIC : State::FREE));
+            storage.filter.emplace_back(filter);
+        }
+        data.elements.clear();
+        data.elements.reserve(tetMesh.elements.size());
+        for (const uvec4& element : tetMesh.elements)
+        {
+            data.elements.emplace_back(element + static_cast<uint32_t>(nodeOffset));
+        }
+    }
+
+    // Generate the element constraints and collect the edges.
     std::unordered_set<uvec2> edges{};
     std::unordered_multimap<uvec2, uint32_t> edgesToApices{};
     if (data.tet)
     {
-        storage.volConstr.reserve(storage.volConstr.size() + elementCount);
+        storage.volConstr.reserve(storage.volConstr.size() + data.elements.size());
     }
     else
     {
-        edgesToApices.reserve(3 * elementCount);
+        edgesToApices.reserve(3 * data.elements.size());
     }
-    for (size_t i = 0; i < elementCount; i++)
+    for (const uvec4& element : data.elements)
     {
+        const uint32_t _i = element[0];
+        const uint32_t _j = element[1];
+        const uint32_t _k = element[2];
         if (data.tet)
         {
-            data.elements.emplace_back(uvec4{
-                nodeTagsToIndices[elementData[5 * i + 1]],
-                nodeTagsToIndices[elementData[5 * i + 2]],
-                nodeTagsToIndices[elementData[5 * i + 3]],
-                nodeTagsToIndices[elementData[5 * i + 4]],
-            });
-            const uvec4& element = data.elements.back();
-            const uint32_t _i = element[0];
-            const uint32_t _j = element[1];
-            const uint32_t _k = element[2];
             const uint32_t _l = element[3];
 
             // Collect the edges.
@@ -166,17 +254,6 @@ MeshEmbedding Vulkan::loadMesh(const std::string& model, const std::string& mesh
         }
         else
         {
-            data.elements.emplace_back(uvec4{
-                nodeTagsToIndices[elementData[4 * i + 1]],
-                nodeTagsToIndices[elementData[4 * i + 2]],
-                nodeTagsToIndices[elementData[4 * i + 3]],
-                nodeTagsToIndices[elementData[4 * i + 1]],
-            });
-            const uvec4& element = data.elements.back();
-            const uint32_t _i = element[0];
-            const uint32_t _j = element[1];
-            const uint32_t _k = element[2];
-
             // Collect the edges and the apices for each edge.
             const uvec2 e_ij{std::min(_i, _j), std::max(_i, _j)};
             const uvec2 e_ik{std::min(_i, _k), std::max(_i, _k)};
@@ -248,6 +325,9 @@ MeshEmbedding Vulkan::loadMesh(const std::string& model, const std::string& mesh
             }
             it = it_;
         }
+
+        // Generate long-range attachment constraints to keep the cloth from stretching away from its static nodes.
+        generateLongRangeAttachments(nodeOffset, nodeCount, edges);
     }
 
     for (size_t i = nodeOffset; i < nodeOffset + nodeCount; i++)
@@ -267,11 +347,11 @@ MeshEmbedding Vulkan::loadMesh(const std::string& model, const std::string& mesh
         data.r_max = std::max(data.r_max, storage.r[i]);
     }
 
-    // Set the correct state for the static nodes.
-    for (const uint32_t tag : staticNodes)
-    {
-        storage.state[nodeTagsToIndices[tag]] = static_cast<glm::uint>(State::STATIC);
-    }
+    // Add the mesh as a body.
+    storage.bodies.emplace_back(Body{
+        .begin = static_cast<glm::uint>(nodeOffset),
+        .end = static_cast<glm::uint>(nodeOffset + nodeCount),
+    });
 
     // Obtain the indices of the attached nodes.
     if (model == "flag" && mesh == "flag")
@@ -286,9 +366,96 @@ MeshEmbedding Vulkan::loadMesh(const std::string& model, const std::string& mesh
     return data.tet ? MeshEmbedding::tetrahedral : MeshEmbedding::triangular;
 }
 
+void Vulkan::generateLongRangeAttachments(size_t nodeOffset, size_t nodeCount, const std::unordered_set<uvec2>& edges)
+{
+    // Collect the static nodes, which anchor the tethers.
+    std::vector<uint32_t> anchors{};
+    for (size_t i = nodeOffset; i < nodeOffset + nodeCount; i++)
+    {
+        if (storage.state[i] == static_cast<glm::uint>(State::STATIC))
+        {
+            anchors.emplace_back(i);
+        }
+    }
+    if (anchors.empty())
+    {
+        return;
+    }
+
+    // Build the adjacency lists of the edge graph (in local node indices).
+    std::vector<std::vector<std::pair<uint32_t, float>>> neighbors(nodeCount);
+    for (const uvec2& edge : edges)
+    {
+        const uint32_t i = edge[0] - nodeOffset;
+        const uint32_t j = edge[1] - nodeOffset;
+        const float d = distance(float3(storage.x[edge[0]]), float3(storage.x[edge[1]]));
+        neighbors[i].emplace_back(j, d);
+        neighbors[j].emplace_back(i, d);
+    }
+
+    // Calculate the geodesic distances from each anchor via Dijkstra's algorithm
+    // and keep the two nearest anchors of each node.
+    static constexpr float d_max = std::numeric_limits<float>::max();
+    std::vector<LongRangeAttachment> lras(nodeCount,
+                                          LongRangeAttachment{.i = ~0u, .a = {~0u, ~0u}, .d = {d_max, d_max}});
+    std::vector<float> geodesics(nodeCount);
+    using Entry = std::pair<float, uint32_t>;
+    for (const uint32_t anchor : anchors)
+    {
+        std::fill(geodesics.begin(), geodesics.end(), d_max);
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue{};
+        geodesics[anchor - nodeOffset] = 0.0f;
+        queue.emplace(0.0f, anchor - nodeOffset);
+        while (!queue.empty())
+        {
+            const auto [d_i, i] = queue.top();
+            queue.pop();
+            if (d_i > geodesics[i])
+            {
+                continue;
+            }
+            for (const auto& [j, d_ij] : neighbors[i])
+            {
+                if (d_i + d_ij < geodesics[j])
+                {
+                    geodesics[j] = d_i + d_ij;
+                    queue.emplace(geodesics[j], j);
+                }
+            }
+        }
+        for (uint32_t i = 0; i < nodeCount; i++)
+        {
+            LongRangeAttachment& lra = lras[i];
+            if (geodesics[i] < lra.d[0])
+            {
+                lra.a[1] = lra.a[0];
+                lra.d[1] = lra.d[0];
+                lra.a[0] = anchor;
+                lra.d[0] = geodesics[i];
+            }
+            else if (geodesics[i] < lra.d[1])
+            {
+                lra.a[1] = anchor;
+                lra.d[1] = geodesics[i];
+            }
+        }
+    }
+
+    // Generate the constraints of the free nodes connected to an anchor.
+    for (uint32_t i = 0; i < nodeCount; i++)
+    {
+        if (storage.state[nodeOffset + i] != static_cast<glm::uint>(State::STATIC) && lras[i].a[0] != ~0u)
+        {
+            lras[i].i = nodeOffset + i;
+            storage.lraConstr.emplace_back(lras[i]);
+        }
+    }
+}
+
 void Vulkan::embedMesh(const std::string& model, const std::string& mesh, Data positionData, Data& jointData,
                        Data& weightData)
 {
+    Profiler::Scope scope("embed mesh", model + "/" + mesh);
     // Precompute cell neighbors in a spatial grid sorted by the Manhattan distance.
     static const std::multimap<uint32_t, ivec3> distancesToNeighbors = []() -> std::multimap<uint32_t, ivec3> {
         std::multimap<uint32_t, ivec3> distancesToNeighbors;
@@ -306,7 +473,8 @@ void Vulkan::embedMesh(const std::string& model, const std::string& mesh, Data p
     }();
 
     // Load the mesh data.
-    const Mesh& data = _meshes[model + "/" + mesh];
+    // Look it up without inserting, since meshes are embedded concurrently.
+    const Mesh& data = _meshes.at(model + "/" + mesh);
 
     // Allocate memory for the vertex skinning data.
     const uint32_t vertexCount = positionData.size / sizeof(float3);
@@ -350,7 +518,8 @@ void Vulkan::embedMesh(const std::string& model, const std::string& mesh, Data p
     }
 
     // Find an embedding for the vertices of the surface mesh.
-    const std::vector<Model::Node*>& modelMeshNodes = getModel(model).mesh(mesh).nodes;
+    const Model& modelData = models[modelNamesToIndices.at(model)];
+    const std::vector<Model::Node*>& modelMeshNodes = modelData.meshes[modelData.meshNamesToIndices.at(mesh)].nodes;
     if (modelMeshNodes.size() != 1)
     {
         throw std::runtime_error("Failed to embed mesh [" + mesh + "] of model [" + model +
@@ -452,26 +621,202 @@ void Vulkan::embedMesh(const std::string& model, const std::string& mesh, Data p
     }
 }
 
+void Vulkan::batchSimulation()
+{
+    // The star particles precede the simulated meshes and are not copied.
+    batchParticleCount = storage.x.size() - starParticleCount;
+    batchDistCount = storage.distConstr.size();
+    const size_t batchVolCount = storage.volConstr.size();
+    const size_t batchLraCount = storage.lraConstr.size();
+    const size_t batchBodyCount = storage.bodies.size();
+
+    // Copy the particles, constraints, and bodies with offset particle indices.
+    storage.x.reserve(starParticleCount + batchSize * batchParticleCount);
+    storage.v.reserve(starParticleCount + batchSize * batchParticleCount);
+    storage.r.reserve(starParticleCount + batchSize * batchParticleCount);
+    storage.w.reserve(starParticleCount + batchSize * batchParticleCount);
+    storage.state.reserve(starParticleCount + batchSize * batchParticleCount);
+    storage.filter.reserve(starParticleCount + batchSize * batchParticleCount);
+    storage.distConstr.reserve(batchSize * batchDistCount);
+    storage.volConstr.reserve(batchSize * batchVolCount);
+    storage.lraConstr.reserve(batchSize * batchLraCount);
+    storage.bodies.reserve(batchSize * batchBodyCount);
+    for (uint32_t k = 1; k < batchSize; k++)
+    {
+        const glm::uint offset = k * batchParticleCount;
+        for (size_t i = starParticleCount; i < starParticleCount + batchParticleCount; i++)
+        {
+            storage.x.emplace_back(storage.x[i]);
+            storage.v.emplace_back(storage.v[i]);
+            storage.r.emplace_back(storage.r[i]);
+            storage.w.emplace_back(storage.w[i]);
+            storage.state.emplace_back(storage.state[i]);
+            storage.filter.emplace_back(storage.filter[i]);
+        }
+        for (size_t c = 0; c < batchDistCount; c++)
+        {
+            DistanceConstraint constr = storage.distConstr[c];
+            constr.i += offset;
+            constr.j += offset;
+            storage.distConstr.emplace_back(constr);
+        }
+        for (size_t c = 0; c < batchVolCount; c++)
+        {
+            VolumeConstraint constr = storage.volConstr[c];
+            constr.i += offset;
+            constr.j += offset;
+            constr.k += offset;
+            constr.l += offset;
+            storage.volConstr.emplace_back(constr);
+        }
+        for (size_t c = 0; c < batchLraCount; c++)
+        {
+            LongRangeAttachment constr = storage.lraConstr[c];
+            constr.i += offset;
+            for (glm::uint& a : constr.a)
+            {
+                if (a != ~0u)
+                {
+                    a += offset;
+                }
+            }
+            storage.lraConstr.emplace_back(constr);
+        }
+        for (size_t b = 0; b < batchBodyCount; b++)
+        {
+            if (storage.bodies[b].begin >= starParticleCount)
+            {
+                storage.bodies.emplace_back(Body{
+                    .begin = storage.bodies[b].begin + offset,
+                    .end = storage.bodies[b].end + offset,
+                });
+            }
+        }
+    }
+
+    // Apply the variant parameters, i.e. scale the compliances and the masses.
+    for (uint32_t k = 0; k < batchSize; k++)
+    {
+        const SimVariant& variant = simVariants[k];
+        const size_t particleOffset = starParticleCount + k * batchParticleCount;
+        for (size_t i = particleOffset; i < particleOffset + batchParticleCount; i++)
+        {
+            storage.w[i] /= variant.densityScale;
+        }
+        for (size_t c = k * batchDistCount; c < (k + 1) * batchDistCount; c++)
+        {
+            storage.distConstr[c].alpha *= variant.complianceScale;
+        }
+        for (size_t c = k * batchVolCount; c < (k + 1) * batchVolCount; c++)
+        {
+            storage.volConstr[c].alpha *= variant.complianceScale;
+        }
+    }
+}
+
+void Vulkan::initializeIslands()
+{
+    // Find the connected components via union-find with path halving.
+    std::vector<uint32_t> parent(particleCount);
+    std::iota(parent.begin(), parent.end(), 0);
+    const auto find = [&](uint32_t i) -> uint32_t {
+        while (parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+    std::vector<bool> constrained(particleCount);
+    for (const DistanceConstraint& constr : storage.distConstr)
+    {
+        parent[find(constr.i)] = find(constr.j);
+        constrained[constr.i] = true;
+        constrained[constr.j] = true;
+    }
+    for (const VolumeConstraint& constr : storage.volConstr)
+    {
+        parent[find(constr.j)] = find(constr.i);
+        parent[find(constr.k)] = find(constr.i);
+        parent[find(constr.l)] = find(constr.i);
+        constrained[constr.i] = true;
+        constrained[constr.j] = true;
+        constrained[constr.k] = true;
+        constrained[constr.l] = true;
+    }
+
+    // Number the islands and count their particles. Unconstrained particles do not belong to an island.
+    storage.island.assign(particleCount, ~0u);
+    std::vector<uint32_t> rootsToIslands(particleCount, ~0u);
+    for (uint32_t i = 0; i < particleCount; i++)
+    {
+        if (!constrained[i])
+        {
+            continue;
+        }
+        const uint32_t root = find(i);
+        if (rootsToIslands[root] == ~0u)
+        {
+            rootsToIslands[root] = static_cast<uint32_t>(storage.islands.size());
+            storage.islands.emplace_back(Island{});
+        }
+        storage.island[i] = rootsToIslands[root];
+        storage.islands[storage.island[i]].end++;
+    }
+    islandCount = storage.islands.size();
+    attachmentIslands.clear();
+    for (uint32_t k = 0; k < batchSize; k++)
+    {
+        attachmentIslands.emplace_back(storage.island[attachmentIndices[0] + k * batchParticleCount]);
+    }
+
+    // Sort the particle indices by island.
+    uint32_t begin = 0;
+    for (Island& island : storage.islands)
+    {
+        island.begin = begin;
+        begin += island.end;
+        island.end = island.begin;
+    }
+    storage.islandIdx.resize(begin);
+    for (uint32_t i = 0; i < particleCount; i++)
+    {
+        if (storage.island[i] != ~0u)
+        {
+            storage.islandIdx[storage.islands[storage.island[i]].end++] = i;
+        }
+    }
+}
+
 void Vulkan::initializeSimulation()
 {
+    Profiler::Scope scope("initialize simulation");
     // Assert that the star particle count is a multiple of 64,
     // so that even the smallest used storage type with size of 4 bytes
     // is aligned to the max. storage offset alignment of 256 bytes.
     static_assert(alignedSize(starParticleCount, 64) == starParticleCount);
 
+    // Copy the simulated meshes for the simulation variants.
+    batchSimulation();
+
     // Initialize the entity counts.
     particleCount = storage.x.size();
     spatCount = std::bit_ceil(particleCount);
     distCount = storage.distConstr.size();
     volCount = storage.volConstr.size();
+    lraCount = storage.lraConstr.size();
+    bodyCount = storage.bodies.size();
+    chunkCount = 0;
+    for (const Body& body : storage.bodies)
+    {
+        chunkCount += (body.end - body.begin + bodyChunkSize - 1) / bodyChunkSize;
+    }
+
+    // Initialize the islands.
+    initializeIslands();
 
     // Select the workgroup dimensions.
-    starWorkgroup = gpu.selectWorkgroupDimensions(starParticleCount, 256, 0);
-    particleWorkgroup = gpu.selectWorkgroupDimensions(particleCount, 256, 0);
-    spatWorkgroup = gpu.selectWorkgroupDimensions(spatCount, 256, 0);
-    sharedSpatWorkgroup = gpu.selectWorkgroupDimensions(spatCount, -1, sizeof(uvec2));
-    distWorkgroup = gpu.selectWorkgroupDimensions(distCount, 256, 0);
-    volWorkgroup = gpu.selectWorkgroupDimensions(volCount, 256, 0);
+    selectSimWorkgroups();
 
     // Initialize the maximum particle radius and the cell size.
     r_max = starParticleRadius;
@@ -488,6 +833,13 @@ void Vulkan::initializeSimulation()
     storage.size.x = particleCount * sizeof(float4);
     storage.offset.x = storageBufferSize;
     storageBufferSize += gpu.alignedStorageSize(storage.size.x);
+    // Only the first batched copy is rendered.
+    storage.size.xr = (starParticleCount + batchParticleCount) * sizeof(float4);
+    for (DeviceSize& offset : storage.offset.xr)
+    {
+        offset = storageBufferSize;
+        storageBufferSize += gpu.alignedStorageSize(storage.size.xr);
+    }
     storage.size.x_ = particleCount * sizeof(float4);
     storage.offset.x_ = storageBufferSize;
     storageBufferSize += gpu.alignedStorageSize(storage.size.x_);
@@ -503,7 +855,19 @@ void Vulkan::initializeSimulation()
     storage.size.spat = spatCount * sizeof(Spatial);
     storage.offset.spat = storageBufferSize;
     storageBufferSize += gpu.alignedStorageSize(storage.size.spat);
-    storage.size.cell = particleCount * sizeof(uvec2);
+    storage.size.spatMoved = workgroup(SimKernel::spatialFixup).size * sizeof(SpatialMove);
+    storage.offset.spatMoved = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.spatMoved);
+    storage.size.spatMerged = spatCount * sizeof(Spatial);
+    storage.offset.spatMerged = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.spatMerged);
+    storage.size.spatArgs = sizeof(SpatialSortArgs);
+    storage.offset.spatArgs = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.spatArgs);
+    storage.size.key = particleCount * sizeof(uvec4);
+    storage.offset.key = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.key);
+    storage.size.cell = spatialTableSize * sizeof(SpatialCell);
     storage.offset.cell = storageBufferSize;
     storageBufferSize += gpu.alignedStorageSize(storage.size.cell);
     storage.size.r = particleCount * sizeof(float);
@@ -515,25 +879,72 @@ void Vulkan::initializeSimulation()
     storage.size.state = particleCount * sizeof(glm::uint);
     storage.offset.state = storageBufferSize;
     storageBufferSize += gpu.alignedStorageSize(storage.size.state);
+    storage.size.filter = particleCount * sizeof(glm::uint);
+    storage.offset.filter = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.filter);
     storage.size.distConstr = distCount * sizeof(DistanceConstraint);
     storage.offset.distConstr = storageBufferSize;
     storageBufferSize += gpu.alignedStorageSize(storage.size.distConstr);
     storage.size.volConstr = volCount * sizeof(VolumeConstraint);
     storage.offset.volConstr = storageBufferSize;
     storageBufferSize += gpu.alignedStorageSize(storage.size.volConstr);
+    storage.size.lraConstr = lraCount * sizeof(LongRangeAttachment);
+    storage.offset.lraConstr = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.lraConstr);
+    storage.size.island = particleCount * sizeof(glm::uint);
+    storage.offset.island = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.island);
+    storage.size.islands = islandCount * sizeof(Island);
+    storage.offset.islands = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.islands);
+    storage.size.islandIdx = storage.islandIdx.size() * sizeof(glm::uint);
+    storage.offset.islandIdx = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.islandIdx);
+    storage.size.bodies = bodyCount * sizeof(Body);
+    storage.offset.bodies = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.bodies);
+    storage.size.chunks = chunkCount * sizeof(ColliderChunk);
+    storage.offset.chunks = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.chunks);
+    storage.size.args = 4 * sizeof(glm::uint);
+    storage.offset.args = storageBufferSize;
+    storageBufferSize += gpu.alignedStorageSize(storage.size.args);
 
     // Initialize the storage buffer.
     setupTransfer();
-    storageBuffer =
-        createBuffer(storageBufferSize, BufferUsageFlagBits::eStorageBuffer | BufferUsageFlagBits::eTransferDst);
+    storageBuffer = createBuffer(storageBufferSize, BufferUsageFlagBits::eStorageBuffer |
+                                                        BufferUsageFlagBits::eIndirectBuffer |
+                                                        BufferUsageFlagBits::eTransferSrc |
+                                                        BufferUsageFlagBits::eTransferDst);
     fillBuffer(storageBuffer, Data::of(storage.x), storage.offset.x);
+    // The rendered position buffers only hold the first copy.
+    for (const DeviceSize& offset : storage.offset.xr)
+    {
+        fillBuffer(storageBuffer,
+                   Data{
+                       .data = storage.x.data(),
+                       .size = storage.size.xr,
+                   },
+                   offset);
+    }
     fillBuffer(storageBuffer, Data::of(storage.v), storage.offset.v);
     clearBuffer(storageBuffer, ~0, storage.offset.spat, storage.size.spat);
+    // The dispatch arguments only vary in their workgroup count.
+    clearBuffer(storageBuffer, 1, storage.offset.spatArgs, storage.size.spatArgs);
+    clearBuffer(storageBuffer, 0, storage.offset.cell, storage.size.cell);
     fillBuffer(storageBuffer, Data::of(storage.r), storage.offset.r);
     fillBuffer(storageBuffer, Data::of(storage.w), storage.offset.w);
     fillBuffer(storageBuffer, Data::of(storage.state), storage.offset.state);
+    fillBuffer(storageBuffer, Data::of(storage.filter), storage.offset.filter);
     fillBuffer(storageBuffer, Data::of(storage.distConstr), storage.offset.distConstr);
     fillBuffer(storageBuffer, Data::of(storage.volConstr), storage.offset.volConstr);
+    fillBuffer(storageBuffer, Data::of(storage.lraConstr), storage.offset.lraConstr);
+    fillBuffer(storageBuffer, Data::of(storage.island), storage.offset.island);
+    fillBuffer(storageBuffer, Data::of(storage.islands), storage.offset.islands);
+    fillBuffer(storageBuffer, Data::of(storage.islandIdx), storage.offset.islandIdx);
+    fillBuffer(storageBuffer, Data::of(storage.bodies), storage.offset.bodies);
+    // The collider chunk counts are reset in each update, the remaining workgroup counts stay 1.
+    clearBuffer(storageBuffer, 1, storage.offset.args, storage.size.args);
     playTransfer();
 
     // Destroy the initial storage data.
@@ -541,24 +952,71 @@ void Vulkan::initializeSimulation()
     storage.v.clear();
     storage.r.clear();
     storage.w.clear();
+    storage.filter.clear();
     storage.distConstr.clear();
     storage.volConstr.clear();
+    storage.lraConstr.clear();
+    storage.island.clear();
+    storage.islands.clear();
+    storage.islandIdx.clear();
+    storage.bodies.clear();
+
+    // Initialize the attachment copies of all batched copies.
+    attachmentCopies.clear();
+    for (uint32_t k = 0; k < batchSize; k++)
+    {
+        for (uint32_t i = 0; i < attachmentCount; i++)
+        {
+            attachmentCopies.emplace_back(BufferCopy{
+                .srcOffset = attachmentOffset + i * sizeof(float4),
+                .dstOffset = storage.offset.x + (attachmentIndices[i] + k * batchParticleCount) * sizeof(float4),
+                .size = sizeof(float3),
+            });
+        }
+    }
 
-    // Initialize the attachment copies.
-    for (uint32_t i = 0; i < attachmentCount; i++)
+    // Initialize the statistics buffer and the readback buffers, which hold the statistics of each batched copy.
+    statsBufferSize = gpu.alignedStorageSize(batchSize * sizeof(SimStats));
+    setupTransfer();
+    statsBuffer = createBuffer(statsBufferSize, BufferUsageFlagBits::eStorageBuffer |
+                                                    BufferUsageFlagBits::eTransferSrc |
+                                                    BufferUsageFlagBits::eTransferDst);
+    clearBuffer(statsBuffer);
+    playTransfer();
+    for (AllocatedBuffer& statsReadbackBuffer : statsReadbackBuffers)
     {
-        attachmentCopies[i] = BufferCopy{
-            .srcOffset = attachmentOffset + i * sizeof(float4),
-            .dstOffset = storage.offset.x + attachmentIndices[i] * sizeof(float4),
-            .size = sizeof(float3),
-        };
+        statsReadbackBuffer = createReadbackBuffer(statsBufferSize, BufferUsageFlagBits::eTransferDst);
+        mapBuffer(statsReadbackBuffer);
     }
 
-    // Initialize the counter buffer.
-    counterBufferSize = gpu.alignedStorageSize(sizeof(glm::uint));
-    counterBuffer = createReadbackBuffer(counterBufferSize, BufferUsageFlagBits::eStorageBuffer);
-    mapBuffer(counterBuffer);
-    counterBuffer.as<glm::uint>() = 0;
+    // Initialize the timestamp query pool of the batched updates if the compute queue supports timestamps.
+    const std::vector<QueueFamilyProperties> queueFamilies = gpu.device.getQueueFamilyProperties();
+    if (batchSize > 1 && queueFamilies[gpu.computeQueueFamilyIndex].timestampValidBits != 0)
+    {
+        batchTimestampPool = device.createQueryPool(QueryPoolCreateInfo{
+            .queryType = QueryType::eTimestamp,
+            .queryCount = 2 * readbackCount,
+        });
+    }
+
+    // Open the batch report next to the startup profile. The report is diagnostic,
+    // so a failure to open it is reported without failing the demo.
+    if (batchSize > 1)
+    {
+        const std::filesystem::path path = profilePath("sim-batch", "csv");
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+        batchReport.open(path);
+        if (batchReport.is_open())
+        {
+            batchReport << "update,duration ms,variant,compliance scale,density scale,free,sleeping,"
+                           "max constraint error,energy,collider chunks,chunks culled by moon shell,chunk count\n";
+        }
+        else
+        {
+            std::clog << "Failed to open simulation batch report " << path.string() << std::endl;
+        }
+    }
 
     Model& astronaut = getModel("astronaut");
 
@@ -666,10 +1124,57 @@ void Vulkan::updatePlayer()
     varUniformBuffers[updateIndex].set(attachmentPositions, attachmentOffset);
 }
 
+WorkgroupDimensions& Vulkan::workgroup(SimKernel kernel)
+{
+    return simWorkgroups[static_cast<uint32_t>(kernel)];
+}
+
+void Vulkan::dispatch(vk::CommandBuffer& simBuffer, SimKernel kernel, vk::DeviceSize indirectOffset)
+{
+    // While tuning, measure the duration of the dispatch with timestamps.
+    // Dispatches exceeding the capacity of the query pool are counted, so that the pool can be grown.
+    const bool timed = timestampPool && timestampCount + 2 <= timestampCapacity;
+    if (timestampPool)
+    {
+        requiredTimestampCount += 2;
+    }
+    if (timed)
+    {
+        simBuffer.writeTimestamp(PipelineStageFlagBits::eComputeShader, timestampPool, timestampCount++);
+    }
+    if (indirectOffset != -1u)
+    {
+        simBuffer.dispatchIndirect(storageBuffer(), indirectOffset);
+    }
+    else
+    {
+        simBuffer.dispatch(workgroup(kernel).count, 1, 1);
+    }
+    if (timed)
+    {
+        simBuffer.writeTimestamp(PipelineStageFlagBits::eComputeShader, timestampPool, timestampCount++);
+        timedKernels.emplace_back(kernel);
+    }
+}
+
 void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
 {
     simBuffer.begin(CommandBufferBeginInfo{});
     activate(simBuffer);
+    if (timestampPool)
+    {
+        simBuffer.resetQueryPool(timestampPool, 0, timestampCapacity);
+        timestampCount = 0;
+        requiredTimestampCount = 0;
+        timedKernels.clear();
+    }
+    // Measure the duration of a batched update with timestamps, which are read with the statistics.
+    const uint32_t readbackIndex = (updateCount + 1) % readbackCount;
+    if (batchTimestampPool)
+    {
+        simBuffer.resetQueryPool(batchTimestampPool, 2 * readbackIndex, 2);
+        simBuffer.writeTimestamp(PipelineStageFlagBits::eTopOfPipe, batchTimestampPool, 2 * readbackIndex);
+    }
 
     // Activate the star particles at the beginning of the main state.
     if (!starParticlesActive && engine.state == Engine::State::Main)
@@ -701,12 +1206,54 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
                                     float4(engine.player.x, 1.0));
     simBuffer.pushConstants<glm::uint>(starUpdatePipelineLayout, ShaderStageFlagBits::eCompute, sizeof(float4),
                                        starParticleCount);
-    simBuffer.dispatch(starWorkgroup.count, 1, 1);
+    dispatch(simBuffer, SimKernel::starUpdate);
 
     // Update the positions of the attached particles.
     simBuffer.copyBuffer(varUniformBuffers[updateIndex](), storageBuffer(), attachmentCopies);
 
+    // Wake up the islands of the attached particles once the attachments have moved.
+    bool attachmentsMoved = false;
+    for (uint32_t i = 0; i < attachmentCount; i++)
+    {
+        attachmentsMoved |=
+            distance(float3(attachmentPositions[i]), float3(attachmentWakePositions[i])) > attachmentWakeDistance;
+    }
+    if (attachmentsMoved)
+    {
+        for (const uint32_t attachmentIsland : attachmentIslands)
+        {
+            if (attachmentIsland != ~0u)
+            {
+                clearBuffer(storageBuffer, 1,
+                            storage.offset.islands + attachmentIsland * sizeof(Island) + offsetof(Island, wake),
+                            sizeof(glm::uint));
+            }
+        }
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferWrite,
+                         PipelineStageFlagBits::eComputeShader,
+                         AccessFlagBits::eShaderRead | AccessFlagBits::eShaderWrite, storage.offset.islands,
+                         storage.size.islands);
+        attachmentWakePositions = attachmentPositions;
+    }
+
+    // Stamp the spatial table entries with the (non-zero) update count, so stale entries are ignored.
+    const glm::uint spatialStamp = static_cast<glm::uint>(updateCount + 1);
+
+    // Maintain the sorted spatial indices incrementally, i.e. keep the order of the last update and merge the indices
+    // whose hash value changed. The full sort is used in the first update and while tuning, so that its kernels are
+    // timed, and as fallback if the moved indices exceed the capacity.
+    const bool incremental = incrementalSpatialSort && updateCount != 0 && !timestampPool;
+    const uint32_t movedCapacity = workgroup(SimKernel::spatialFixup).size;
+
     // Record the spatial hash pass.
+    if (incremental)
+    {
+        clearBuffer(storageBuffer, 0, storage.offset.spatArgs, sizeof(glm::uint));
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferWrite,
+                         PipelineStageFlagBits::eComputeShader,
+                         AccessFlagBits::eShaderRead | AccessFlagBits::eShaderWrite, storage.offset.spatArgs,
+                         storage.size.spatArgs);
+    }
     syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader | PipelineStageFlagBits::eTransfer,
                      AccessFlagBits::eShaderWrite | AccessFlagBits::eTransferWrite,
                      PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead, storage.offset.x,
@@ -724,7 +1271,62 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
                                    cellSize);
     simBuffer.pushConstants<glm::uint>(spatialHashPipelineLayout, ShaderStageFlagBits::eCompute, 3 * sizeof(float),
                                        particleCount);
-    simBuffer.dispatch(particleWorkgroup.count, 1, 1);
+    simBuffer.pushConstants<glm::uint>(spatialHashPipelineLayout, ShaderStageFlagBits::eCompute,
+                                       3 * sizeof(float) + sizeof(glm::uint), incremental);
+    simBuffer.pushConstants<glm::uint>(spatialHashPipelineLayout, ShaderStageFlagBits::eCompute,
+                                       3 * sizeof(float) + 2 * sizeof(glm::uint), movedCapacity);
+    simBuffer.pushConstants<glm::uint>(spatialHashPipelineLayout, ShaderStageFlagBits::eCompute,
+                                       3 * sizeof(float) + 3 * sizeof(glm::uint), starParticleCount);
+    simBuffer.pushConstants<glm::uint>(spatialHashPipelineLayout, ShaderStageFlagBits::eCompute,
+                                       3 * sizeof(float) + 4 * sizeof(glm::uint), batchParticleCount);
+    dispatch(simBuffer, SimKernel::spatialHash);
+
+    // The full sort passes are dispatched indirectly in incremental mode, i.e. only as fallback.
+    const auto sortArgs = [&](DeviceSize offset) -> DeviceSize {
+        return incremental ? storage.offset.spatArgs + offset : -1u;
+    };
+    if (incremental)
+    {
+        // Record the spatial fixup pass, i.e. sort the moved indices and select the sort passes.
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                         PipelineStageFlagBits::eComputeShader,
+                         AccessFlagBits::eShaderRead | AccessFlagBits::eShaderWrite, storage.offset.spatMoved,
+                         storage.size.spatMoved);
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                         PipelineStageFlagBits::eComputeShader,
+                         AccessFlagBits::eShaderRead | AccessFlagBits::eShaderWrite, storage.offset.spatArgs,
+                         storage.size.spatArgs);
+        simBuffer.bindPipeline(PipelineBindPoint::eCompute, spatialFixupPipeline);
+        simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, spatialFixupPipelineLayout, 0,
+                                     spatialFixupDescSets[updateIndex], {});
+        simBuffer.pushConstants<glm::uint>(spatialFixupPipelineLayout, ShaderStageFlagBits::eCompute, 0,
+                                           workgroup(SimKernel::spatialHash).count);
+        simBuffer.pushConstants<glm::uint>(spatialFixupPipelineLayout, ShaderStageFlagBits::eCompute,
+                                           sizeof(glm::uint), workgroup(SimKernel::spatialSort).count);
+        simBuffer.pushConstants<glm::uint>(spatialFixupPipelineLayout, ShaderStageFlagBits::eCompute,
+                                           2 * sizeof(glm::uint), workgroup(SimKernel::spatialGroupsort).count);
+        simBuffer.pushConstants<glm::uint>(spatialFixupPipelineLayout, ShaderStageFlagBits::eCompute,
+                                           3 * sizeof(glm::uint), workgroup(SimKernel::spatialMerge).count);
+        dispatch(simBuffer, SimKernel::spatialFixup);
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                         PipelineStageFlagBits::eDrawIndirect | PipelineStageFlagBits::eComputeShader,
+                         AccessFlagBits::eIndirectCommandRead | AccessFlagBits::eShaderRead,
+                         storage.offset.spatArgs, storage.size.spatArgs);
+
+        // Record the fallback spatial hash pass, which rehashes the spatial indices from scratch.
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                         PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite, storage.offset.key,
+                         storage.size.key);
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead,
+                         PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite, storage.offset.spat,
+                         storage.size.spat);
+        simBuffer.bindPipeline(PipelineBindPoint::eCompute, spatialHashPipeline);
+        simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, spatialHashPipelineLayout, 0,
+                                     spatialHashDescSets[updateIndex], {});
+        simBuffer.pushConstants<glm::uint>(spatialHashPipelineLayout, ShaderStageFlagBits::eCompute,
+                                           3 * sizeof(float) + sizeof(glm::uint), false);
+        dispatch(simBuffer, SimKernel::spatialHash, sortArgs(offsetof(SpatialSortArgs, rehash)));
+    }
 
     // Record the spatial sort passes.
     for (uint32_t peak = 2; peak <= spatCount; peak *= 2)
@@ -734,7 +1336,7 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
             syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
                              PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead, storage.offset.spat,
                              storage.size.spat);
-            if (dist < sharedSpatWorkgroup.size)
+            if (dist < workgroup(SimKernel::spatialGroupsort).size)
             {
                 // Perform the rest of the subiterations in a single pass using group-shared memory.
                 simBuffer.bindPipeline(PipelineBindPoint::eCompute, spatialGroupsortPipeline);
@@ -744,7 +1346,7 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
                                                    peak);
                 simBuffer.pushConstants<glm::uint>(spatialGroupsortPipelineLayout, ShaderStageFlagBits::eCompute,
                                                    sizeof(glm::uint), dist);
-                simBuffer.dispatch(sharedSpatWorkgroup.count, 1, 1);
+                dispatch(simBuffer, SimKernel::spatialGroupsort, sortArgs(offsetof(SpatialSortArgs, groupsort)));
                 break;
             }
             else
@@ -755,11 +1357,39 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
                 simBuffer.pushConstants<glm::uint>(spatialSortPipelineLayout, ShaderStageFlagBits::eCompute, 0, peak);
                 simBuffer.pushConstants<glm::uint>(spatialSortPipelineLayout, ShaderStageFlagBits::eCompute,
                                                    sizeof(glm::uint), dist);
-                simBuffer.dispatch(spatWorkgroup.count, 1, 1);
+                dispatch(simBuffer, SimKernel::spatialSort, sortArgs(offsetof(SpatialSortArgs, sort)));
             }
         }
     }
 
+    // Record the spatial merge passes, i.e. merge the sorted moved indices into the unmoved indices
+    // and copy the result back.
+    if (incremental)
+    {
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                         PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead, storage.offset.spat,
+                         storage.size.spat);
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                         PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead,
+                         storage.offset.spatMoved, storage.size.spatMoved);
+        simBuffer.bindPipeline(PipelineBindPoint::eCompute, spatialMergePipeline);
+        simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, spatialMergePipelineLayout, 0,
+                                     spatialMergeDescSets[updateIndex], {});
+        simBuffer.pushConstants<glm::uint>(spatialMergePipelineLayout, ShaderStageFlagBits::eCompute, 0, spatCount);
+        simBuffer.pushConstants<glm::uint>(spatialMergePipelineLayout, ShaderStageFlagBits::eCompute,
+                                           sizeof(glm::uint), false);
+        dispatch(simBuffer, SimKernel::spatialMerge, sortArgs(offsetof(SpatialSortArgs, merge)));
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                         PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead,
+                         storage.offset.spatMerged, storage.size.spatMerged);
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead,
+                         PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite, storage.offset.spat,
+                         storage.size.spat);
+        simBuffer.pushConstants<glm::uint>(spatialMergePipelineLayout, ShaderStageFlagBits::eCompute,
+                                           sizeof(glm::uint), true);
+        dispatch(simBuffer, SimKernel::spatialMerge, sortArgs(offsetof(SpatialSortArgs, merge)));
+    }
+
     // Record the spatial collect pass.
     syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
                      PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead, storage.offset.spat,
@@ -768,7 +1398,32 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
     simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, spatialCollectPipelineLayout, 0,
                                  spatialCollectDescSets[updateIndex], {});
     simBuffer.pushConstants<glm::uint>(spatialCollectPipelineLayout, ShaderStageFlagBits::eCompute, 0, particleCount);
-    simBuffer.dispatch(particleWorkgroup.count, 1, 1);
+    simBuffer.pushConstants<glm::uint>(spatialCollectPipelineLayout, ShaderStageFlagBits::eCompute, sizeof(glm::uint),
+                                       spatialStamp);
+    dispatch(simBuffer, SimKernel::spatialCollect);
+
+    // Record the body broadphase pass, i.e. collect the collider chunks of the bodies overlapping a collider
+    // for the indirect dispatches of the XPBD object collide pass.
+    clearBuffer(storageBuffer, 0, storage.offset.args, sizeof(glm::uint));
+    clearBuffer(storageBuffer, 0, storage.offset.args + 3 * sizeof(glm::uint), sizeof(glm::uint));
+    syncBufferAccess(storageBuffer, PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferWrite,
+                     PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead | AccessFlagBits::eShaderWrite,
+                     storage.offset.args, storage.size.args);
+    simBuffer.bindPipeline(PipelineBindPoint::eCompute, bodyBroadphasePipeline);
+    simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, bodyBroadphasePipelineLayout, 0,
+                                 bodyBroadphaseDescSets[updateIndex], {});
+    simBuffer.pushConstants<float>(bodyBroadphasePipelineLayout, ShaderStageFlagBits::eCompute, 0, bodyMargin);
+    simBuffer.pushConstants<glm::uint>(bodyBroadphasePipelineLayout, ShaderStageFlagBits::eCompute, sizeof(float),
+                                       bodyChunkSize);
+    simBuffer.pushConstants<glm::uint>(bodyBroadphasePipelineLayout, ShaderStageFlagBits::eCompute,
+                                       sizeof(float) + sizeof(glm::uint), bodyCount);
+    dispatch(simBuffer, SimKernel::bodyBroadphase);
+    syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                     PipelineStageFlagBits::eDrawIndirect, AccessFlagBits::eIndirectCommandRead, storage.offset.args,
+                     storage.size.args);
+    syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                     PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead, storage.offset.chunks,
+                     storage.size.chunks);
 
     for (uint32_t i = 0; i < substepCount; i++)
     {
@@ -801,12 +1456,21 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
         simBuffer.bindPipeline(PipelineBindPoint::eCompute, xpbdPredictPipeline);
         simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, xpbdPredictPipelineLayout, 0,
                                      xpbdPredictDescSets[updateIndex], {});
-        simBuffer.pushConstants<float>(xpbdPredictPipelineLayout, ShaderStageFlagBits::eCompute, 0, substepDeltaTime);
-        simBuffer.pushConstants<float>(xpbdPredictPipelineLayout, ShaderStageFlagBits::eCompute, sizeof(float),
-                                       engine.gravity);
-        simBuffer.pushConstants<glm::uint>(xpbdPredictPipelineLayout, ShaderStageFlagBits::eCompute, 2 * sizeof(float),
+        simBuffer.pushConstants<float>(xpbdPredictPipelineLayout, ShaderStageFlagBits::eCompute, 0, engine.gravity);
+        simBuffer.pushConstants<glm::uint>(xpbdPredictPipelineLayout, ShaderStageFlagBits::eCompute, sizeof(float),
                                            particleCount);
-        simBuffer.dispatch(particleWorkgroup.count, 1, 1);
+        dispatch(simBuffer, SimKernel::xpbdPredict);
+
+        // Record the XPBD long-range attachment pass.
+        syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                         PipelineStageFlagBits::eComputeShader,
+                         AccessFlagBits::eShaderRead | AccessFlagBits::eShaderWrite, storage.offset.x_,
+                         storage.size.x_);
+        simBuffer.bindPipeline(PipelineBindPoint::eCompute, xpbdLraPipeline);
+        simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, xpbdLraPipelineLayout, 0,
+                                     xpbdLraDescSets[updateIndex], {});
+        simBuffer.pushConstants<glm::uint>(xpbdLraPipelineLayout, ShaderStageFlagBits::eCompute, 0, lraCount);
+        dispatch(simBuffer, SimKernel::xpbdLra);
 
         // Record the XPBD object collide pass.
         syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
@@ -818,8 +1482,7 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
         simBuffer.bindPipeline(PipelineBindPoint::eCompute, xpbdObjcollPipeline);
         simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, xpbdObjcollPipelineLayout, 0,
                                      xpbdObjcollDescSets[updateIndex], {});
-        simBuffer.pushConstants<glm::uint>(xpbdObjcollPipelineLayout, ShaderStageFlagBits::eCompute, 0, particleCount);
-        simBuffer.dispatch(particleWorkgroup.count, 1, 1);
+        dispatch(simBuffer, SimKernel::xpbdObjcoll, storage.offset.args);
 
         // Record the XPBD particle collide pass.
         if (i == 0)
@@ -827,6 +1490,9 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
             syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
                              PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead, storage.offset.cell,
                              storage.size.cell);
+            syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                             PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead, storage.offset.key,
+                             storage.size.key);
             syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
                              PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead, storage.offset.state,
                              storage.size.state);
@@ -838,7 +1504,9 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
         simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, xpbdPcollPipelineLayout, 0,
                                      xpbdPcollDescSets[updateIndex], {});
         simBuffer.pushConstants<glm::uint>(xpbdPcollPipelineLayout, ShaderStageFlagBits::eCompute, 0, particleCount);
-        simBuffer.dispatch(particleWorkgroup.count, 1, 1);
+        simBuffer.pushConstants<glm::uint>(xpbdPcollPipelineLayout, ShaderStageFlagBits::eCompute, sizeof(glm::uint),
+                                           spatialStamp);
+        dispatch(simBuffer, SimKernel::xpbdPcoll);
 
         // Record the XPBD distance constrain pass.
         syncBufferAccess(storageBuffer, PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferWrite,
@@ -847,19 +1515,15 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
         simBuffer.bindPipeline(PipelineBindPoint::eCompute, xpbdDistPipeline);
         simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, xpbdDistPipelineLayout, 0,
                                      xpbdDistDescSets[updateIndex], {});
-        simBuffer.pushConstants<float>(xpbdDistPipelineLayout, ShaderStageFlagBits::eCompute, 0, substepDeltaTime);
-        simBuffer.pushConstants<glm::uint>(xpbdDistPipelineLayout, ShaderStageFlagBits::eCompute, sizeof(float),
-                                           distCount);
-        simBuffer.dispatch(distWorkgroup.count, 1, 1);
+        simBuffer.pushConstants<glm::uint>(xpbdDistPipelineLayout, ShaderStageFlagBits::eCompute, 0, distCount);
+        dispatch(simBuffer, SimKernel::xpbdDist);
 
         // Record the XPBD volume constrain pass.
         simBuffer.bindPipeline(PipelineBindPoint::eCompute, xpbdVolPipeline);
         simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, xpbdVolPipelineLayout, 0,
                                      xpbdVolDescSets[updateIndex], {});
-        simBuffer.pushConstants<float>(xpbdVolPipelineLayout, ShaderStageFlagBits::eCompute, 0, substepDeltaTime);
-        simBuffer.pushConstants<glm::uint>(xpbdVolPipelineLayout, ShaderStageFlagBits::eCompute, sizeof(float),
-                                           volCount);
-        simBuffer.dispatch(volWorkgroup.count, 1, 1);
+        simBuffer.pushConstants<glm::uint>(xpbdVolPipelineLayout, ShaderStageFlagBits::eCompute, 0, volCount);
+        dispatch(simBuffer, SimKernel::xpbdVol);
 
         // Record the XPBD correct pass.
         syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
@@ -871,17 +1535,178 @@ void Vulkan::recordSimulation(vk::CommandBuffer& simBuffer)
         simBuffer.bindPipeline(PipelineBindPoint::eCompute, xpbdCorrectPipeline);
         simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, xpbdCorrectPipelineLayout, 0,
                                      xpbdCorrectDescSets[updateIndex], {});
-        simBuffer.pushConstants<float>(xpbdCorrectPipelineLayout, ShaderStageFlagBits::eCompute, 0, substepDeltaTime);
-        simBuffer.pushConstants<glm::uint>(xpbdCorrectPipelineLayout, ShaderStageFlagBits::eCompute, sizeof(float),
-                                           particleCount);
-        simBuffer.dispatch(particleWorkgroup.count, 1, 1);
+        simBuffer.pushConstants<glm::uint>(xpbdCorrectPipelineLayout, ShaderStageFlagBits::eCompute, 0, particleCount);
+        dispatch(simBuffer, SimKernel::xpbdCorrect);
+    }
+
+    // Record the island sleep pass.
+    syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                     PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead | AccessFlagBits::eShaderWrite,
+                     storage.offset.islands, storage.size.islands);
+    syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                     PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead | AccessFlagBits::eShaderWrite,
+                     storage.offset.v, storage.size.v);
+    simBuffer.bindPipeline(PipelineBindPoint::eCompute, islandSleepPipeline);
+    simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, islandSleepPipelineLayout, 0,
+                                 islandSleepDescSets[updateIndex], {});
+    simBuffer.pushConstants<float>(islandSleepPipelineLayout, ShaderStageFlagBits::eCompute, 0, restEnergy);
+    simBuffer.pushConstants<glm::uint>(islandSleepPipelineLayout, ShaderStageFlagBits::eCompute, sizeof(float),
+                                       restCount);
+    simBuffer.pushConstants<glm::uint>(islandSleepPipelineLayout, ShaderStageFlagBits::eCompute,
+                                       sizeof(float) + sizeof(glm::uint), islandCount);
+    dispatch(simBuffer, SimKernel::islandSleep);
+
+    // Record the simulation statistics passes, one per batched copy.
+    // The star particle counter is accumulated over all updates, the other statistics are reset.
+    // The collider chunk counts of the body broadphase are copied from the dispatch arguments,
+    // so that the chunks culled by the moon shell test can be checked against the dispatched ones.
+    syncBufferAccess(statsBuffer, PipelineStageFlagBits::eComputeShader | PipelineStageFlagBits::eTransfer, {},
+                     PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferWrite);
+    clearBuffer(statsBuffer, 0, offsetof(SimStats, stateCounts),
+                batchSize * sizeof(SimStats) - offsetof(SimStats, stateCounts));
+    syncBufferAccess(statsBuffer, PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferWrite,
+                     PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferWrite);
+    syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                     PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferRead, storage.offset.args,
+                     storage.size.args);
+    simBuffer.copyBuffer(storageBuffer(), statsBuffer(),
+                         {
+                             BufferCopy{
+                                 .srcOffset = storage.offset.args,
+                                 .dstOffset = offsetof(SimStats, colliderChunks),
+                                 .size = sizeof(glm::uint),
+                             },
+                             BufferCopy{
+                                 .srcOffset = storage.offset.args + 3 * sizeof(glm::uint),
+                                 .dstOffset = offsetof(SimStats, shellCulledChunks),
+                                 .size = sizeof(glm::uint),
+                             },
+                         });
+    syncBufferAccess(statsBuffer, PipelineStageFlagBits::eComputeShader | PipelineStageFlagBits::eTransfer,
+                     AccessFlagBits::eShaderWrite | AccessFlagBits::eTransferWrite,
+                     PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead | AccessFlagBits::eShaderWrite);
+    syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                     PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead, storage.offset.x,
+                     storage.size.x);
+    syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                     PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead, storage.offset.v,
+                     storage.size.v);
+    syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                     PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderRead, storage.offset.state,
+                     storage.size.state);
+    simBuffer.bindPipeline(PipelineBindPoint::eCompute, simStatsPipeline);
+    simBuffer.bindDescriptorSets(PipelineBindPoint::eCompute, simStatsPipelineLayout, 0, simStatsDescSets[updateIndex],
+                                 {});
+    simBuffer.pushConstants<float>(simStatsPipelineLayout, ShaderStageFlagBits::eCompute, 0, engine.gravity);
+    for (uint32_t k = 0; k < batchSize; k++)
+    {
+        // The first copy includes the star particles.
+        const uint32_t particleOffset = (k == 0) ? 0 : starParticleCount + k * batchParticleCount;
+        const uint32_t copyParticleCount = (k == 0) ? starParticleCount + batchParticleCount : batchParticleCount;
+        simBuffer.pushConstants<glm::uint>(simStatsPipelineLayout, ShaderStageFlagBits::eCompute, sizeof(float),
+                                           copyParticleCount);
+        simBuffer.pushConstants<glm::uint>(simStatsPipelineLayout, ShaderStageFlagBits::eCompute,
+                                           sizeof(float) + sizeof(glm::uint), batchDistCount);
+        simBuffer.pushConstants<glm::uint>(simStatsPipelineLayout, ShaderStageFlagBits::eCompute,
+                                           sizeof(float) + 2 * sizeof(glm::uint), particleOffset);
+        simBuffer.pushConstants<glm::uint>(simStatsPipelineLayout, ShaderStageFlagBits::eCompute,
+                                           sizeof(float) + 3 * sizeof(glm::uint), k * batchDistCount);
+        simBuffer.pushConstants<glm::uint>(simStatsPipelineLayout, ShaderStageFlagBits::eCompute,
+                                           sizeof(float) + 4 * sizeof(glm::uint), k);
+        dispatch(simBuffer, SimKernel::simStats);
+    }
+
+    // Copy the positions to the rendered position buffer of this update, while the other one may be rendered.
+    // The copy waits for the last frame reading the buffer, see sim().
+    syncBufferAccess(storageBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                     PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferRead, storage.offset.x,
+                     storage.size.x);
+    simBuffer.copyBuffer(storageBuffer(), storageBuffer(),
+                         BufferCopy{
+                             .srcOffset = storage.offset.x,
+                             .dstOffset = storage.offset.xr[(updateCount + 1) % positionBufferCount],
+                             .size = storage.size.xr,
+                         });
+    syncBufferAccess(storageBuffer, PipelineStageFlagBits::eTransfer, {}, PipelineStageFlagBits::eComputeShader,
+                     AccessFlagBits::eShaderWrite, storage.offset.x, storage.size.x);
+
+    // Copy the statistics to the readback buffer of this update, which is read once the update is complete.
+    syncBufferAccess(statsBuffer, PipelineStageFlagBits::eComputeShader, AccessFlagBits::eShaderWrite,
+                     PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferRead);
+    AllocatedBuffer& statsReadbackBuffer = statsReadbackBuffers[readbackIndex];
+    copyBuffer(statsBuffer, statsReadbackBuffer);
+    syncBufferAccess(statsReadbackBuffer, PipelineStageFlagBits::eTransfer, AccessFlagBits::eTransferWrite,
+                     PipelineStageFlagBits::eHost, AccessFlagBits::eHostRead);
+    if (batchTimestampPool)
+    {
+        simBuffer.writeTimestamp(PipelineStageFlagBits::eBottomOfPipe, batchTimestampPool, 2 * readbackIndex + 1);
     }
 
     simBuffer.end();
 }
 
+void Vulkan::readSimStats()
+{
+    // Get the last completed update. Its readback buffer is not written by any update in flight.
+    const uint64_t completedUpdateCount = device.getSemaphoreCounterValue(simComplete);
+    if (completedUpdateCount == statsUpdateCount)
+    {
+        return;
+    }
+
+    // Read the statistics from the readback buffer.
+    AllocatedBuffer& statsReadbackBuffer = statsReadbackBuffers[completedUpdateCount % readbackCount];
+    allocator.invalidateAllocation(statsReadbackBuffer.allocation, 0, batchSize * sizeof(SimStats));
+    batchSimStats = statsReadbackBuffer.as<std::array<SimStats, batchSize>>();
+    simStats = batchSimStats[0];
+
+    // Report the batched copies periodically.
+    if (batchReport.is_open() && completedUpdateCount / batchReportInterval != statsUpdateCount / batchReportInterval)
+    {
+        reportSimBatch(completedUpdateCount);
+    }
+    statsUpdateCount = completedUpdateCount;
+}
+
+void Vulkan::reportSimBatch(uint64_t completedUpdateCount)
+{
+    // Read the timestamps of the completed update, which are available without waiting.
+    float duration = 0.0f;
+    if (batchTimestampPool)
+    {
+        std::vector<uint64_t> timestamps;
+        std::tie(result, timestamps) = device.getQueryPoolResults<uint64_t>(
+            batchTimestampPool, 2 * (completedUpdateCount % readbackCount), 2, 2 * sizeof(uint64_t), sizeof(uint64_t),
+            QueryResultFlagBits::e64);
+        if (result == Result::eSuccess)
+        {
+            const uint64_t ticks = timestamps[1] - timestamps[0];
+            duration = static_cast<float>(ticks) * gpu.properties.limits.timestampPeriod * 1e-6f;
+        }
+    }
+
+    // Write one row per batched copy. The collider chunk counts are only gathered for the first copy.
+    for (uint32_t k = 0; k < batchSize; k++)
+    {
+        const SimStats& stats = batchSimStats[k];
+        batchReport << completedUpdateCount << "," << duration << "," << k << "," << simVariants[k].complianceScale
+                    << "," << simVariants[k].densityScale << ","
+                    << stats.stateCounts[static_cast<uint32_t>(State::FREE)] << ","
+                    << stats.stateCounts[static_cast<uint32_t>(State::SLEEP)] << "," << stats.maxConstrError << ","
+                    << stats.energy << "," << stats.colliderChunks << "," << stats.shellCulledChunks << ","
+                    << chunkCount << "\n";
+    }
+    batchReport.flush();
+}
+
 void Vulkan::sim()
 {
+    // Tune the workgroup sizes before the first update, when the player is initialized and no update is in flight.
+    if (updateCount == 0)
+    {
+        tuneSimWorkgroups();
+    }
+
     result = device.waitForFences(updateInFlight[updateIndex], true, UINT64_MAX);
 
     updatePlayer();
@@ -891,22 +1716,34 @@ void Vulkan::sim()
 
     recordSimulation(simBuffers[updateIndex]);
 
-    const uint64_t waitSemaphoreValue = updateCount;
+    // Wait for the previous update and the last frame reading the rendered position buffer written by this update.
+    // Also wait for the submitted uploads, which are not waited for on the host.
+    const std::array waitSemaphoreValues{updateCount, positionReadCounts[(updateCount + 1) % positionBufferCount],
+                                         uploadCount};
     updateCount++;
     const uint64_t signalSemaphoreValue = updateCount;
     const TimelineSemaphoreSubmitInfo semaphoreValues{
-        .waitSemaphoreValueCount = 1,
-        .pWaitSemaphoreValues = &waitSemaphoreValue,
+        .waitSemaphoreValueCount = waitSemaphoreValues.size(),
+        .pWaitSemaphoreValues = waitSemaphoreValues.data(),
         .signalSemaphoreValueCount = 1,
         .pSignalSemaphoreValues = &signalSemaphoreValue,
     };
-    constexpr PipelineStageFlags waitDstStage = PipelineStageFlagBits::eComputeShader;
+    const std::array waitSemaphores{
+        simComplete,
+        renderRead,
+        uploadComplete,
+    };
+    constexpr std::array waitDstStages{
+        PipelineStageFlags{PipelineStageFlagBits::eComputeShader},
+        PipelineStageFlags{PipelineStageFlagBits::eTransfer},
+        PipelineStageFlags{PipelineStageFlagBits::eAllCommands},
+    };
     computeQueue.submit(
         SubmitInfo{
             .pNext = &semaphoreValues,
-            .waitSemaphoreCount = 1,
-            .pWaitSemaphores = &simComplete,
-            .pWaitDstStageMask = &waitDstStage,
+            .waitSemaphoreCount = waitSemaphores.size(),
+            .pWaitSemaphores = waitSemaphores.data(),
+            .pWaitDstStageMask = waitDstStages.data(),
             .commandBufferCount = 1,
             .pCommandBuffers = &simBuffers[updateIndex],
             .signalSemaphoreCount = 1,
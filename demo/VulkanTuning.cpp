@@ -0,0 +1,303 @@
+#include "Vulkan.h"
+
+#include "TaskGraph.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+using namespace vk;
+
+Vulkan::SimKernelInfo Vulkan::simKernelInfo(SimKernel kernel)
+{
+    switch (kernel)
+    {
+    case SimKernel::starUpdate:
+        return {"star-update", starParticleCount, 256, 0, true, &starUpdatePipeline, &starUpdatePipelineLayout};
+    case SimKernel::spatialHash:
+        return {"spatial-hash", particleCount, 256, 0, true, &spatialHashPipeline, &spatialHashPipelineLayout};
+    case SimKernel::spatialSort:
+        return {"spatial-sort", spatCount, 256, 0, true, &spatialSortPipeline, &spatialSortPipelineLayout};
+    case SimKernel::spatialGroupsort:
+        // The group size determines which sort subiterations are performed in group-shared memory,
+        // so it is not tuned independently of the spatial sort. Select the maximum group size.
+        return {"spatial-groupsort", spatCount, -1u, sizeof(glm::uvec2), false, &spatialGroupsortPipeline,
+                &spatialGroupsortPipelineLayout};
+    case SimKernel::spatialFixup:
+        // A single workgroup sorts the moved spatial indices, so the group size is their capacity.
+        // Select the maximum group size.
+        return {"spatial-fixup", 1, -1u, sizeof(glm::uvec2) + sizeof(glm::uint), false, &spatialFixupPipeline,
+                &spatialFixupPipelineLayout};
+    case SimKernel::spatialMerge:
+        // The incremental sort is not used while tuning, so the merge passes are not timed.
+        return {"spatial-merge", spatCount, 256, 0, false, &spatialMergePipeline, &spatialMergePipelineLayout};
+    case SimKernel::spatialCollect:
+        return {"spatial-collect", particleCount, 256, 0, true, &spatialCollectPipeline, &spatialCollectPipelineLayout};
+    case SimKernel::xpbdPredict:
+        return {"xpbd-predict", particleCount, 256, 0, true, &xpbdPredictPipeline, &xpbdPredictPipelineLayout};
+    case SimKernel::xpbdLra:
+        return {"xpbd-lra", lraCount, 256, 0, true, &xpbdLraPipeline, &xpbdLraPipelineLayout};
+    case SimKernel::bodyBroadphase:
+        // Each workgroup processes one body, so the group size is fixed.
+        return {"body-broadphase", bodyCount * 256, 256, 2 * sizeof(glm::float3), false, &bodyBroadphasePipeline,
+                &bodyBroadphasePipelineLayout};
+    case SimKernel::xpbdObjcoll:
+        // Each workgroup processes one collider chunk of the indirect dispatch, so the group size is tuned
+        // for the chunk size.
+        return {"xpbd-objcoll", chunkCount * bodyChunkSize, bodyChunkSize, 0, true, &xpbdObjcollPipeline,
+                &xpbdObjcollPipelineLayout};
+    case SimKernel::xpbdPcoll:
+        return {"xpbd-pcoll", particleCount, 256, 0, true, &xpbdPcollPipeline, &xpbdPcollPipelineLayout};
+    case SimKernel::xpbdDist:
+        return {"xpbd-dist", distCount, 256, 0, true, &xpbdDistPipeline, &xpbdDistPipelineLayout};
+    case SimKernel::xpbdVol:
+        return {"xpbd-vol", volCount, 256, 0, true, &xpbdVolPipeline, &xpbdVolPipelineLayout};
+    case SimKernel::xpbdCorrect:
+        return {"xpbd-correct", particleCount, 256, 0, true, &xpbdCorrectPipeline, &xpbdCorrectPipelineLayout};
+    case SimKernel::islandSleep:
+        // Each workgroup processes one island, so the group size is fixed.
+        return {"island-sleep", islandCount * 256, 256, sizeof(float), false, &islandSleepPipeline,
+                &islandSleepPipelineLayout};
+    case SimKernel::simStats:
+        // The statistics are calculated per batched copy, the first one includes the star particles.
+        return {"sim-stats", std::max(starParticleCount + batchParticleCount, batchDistCount), 256, sizeof(float), true,
+                &simStatsPipeline, &simStatsPipelineLayout};
+    }
+    throw std::runtime_error("Failed to find simulation kernel");
+}
+
+std::filesystem::path Vulkan::workgroupCachePath()
+{
+    std::ostringstream key;
+    key << std::hex << gpu.properties.vendorID << "-" << gpu.properties.deviceID << "-"
+        << gpu.properties.driverVersion;
+    return cachePath("workgroups." + key.str());
+}
+
+void Vulkan::selectSimWorkgroups()
+{
+    // Select the group sizes heuristically.
+    for (uint32_t k = 0; k < simKernelCount; k++)
+    {
+        const SimKernelInfo info = simKernelInfo(static_cast<SimKernel>(k));
+        simWorkgroups[k] =
+            gpu.selectWorkgroupDimensions(info.invocationCount, info.desiredGroupSize, info.sharedSizePerInvocation);
+        cachedSimWorkgroups[k] = !info.tunable;
+    }
+
+    // Replace them with the cached group sizes.
+    // The cache entries are only valid for the same invocation counts, i.e. the same scene.
+    std::ifstream file(workgroupCachePath());
+    if (!file.is_open())
+    {
+        return;
+    }
+    std::string name;
+    uint32_t invocationCount, groupSize;
+    while (file >> name >> invocationCount >> groupSize)
+    {
+        for (uint32_t k = 0; k < simKernelCount; k++)
+        {
+            const SimKernelInfo info = simKernelInfo(static_cast<SimKernel>(k));
+            if (info.tunable && info.name == name && info.invocationCount == invocationCount)
+            {
+                simWorkgroups[k] =
+                    gpu.selectWorkgroupDimensions(info.invocationCount, groupSize, info.sharedSizePerInvocation);
+                cachedSimWorkgroups[k] = true;
+            }
+        }
+    }
+}
+
+void Vulkan::tuneSimWorkgroups()
+{
+    // Collect the candidate dimensions of the uncached kernels,
+    // i.e. the supported power-of-two group sizes from the subgroup size to the maximum group size.
+    const uint32_t minGroupSize = std::max(gpu.subgroupProperties.subgroupSize, 32u);
+    const uint32_t maxGroupSize = std::min(gpu.properties.limits.maxComputeWorkGroupInvocations,
+                                           gpu.properties.limits.maxComputeWorkGroupSize[0]);
+    std::array<std::vector<WorkgroupDimensions>, simKernelCount> candidates{};
+    uint32_t roundCount = 0;
+    for (uint32_t k = 0; k < simKernelCount; k++)
+    {
+        if (cachedSimWorkgroups[k])
+        {
+            continue;
+        }
+        const SimKernelInfo info = simKernelInfo(static_cast<SimKernel>(k));
+        for (uint32_t groupSize = minGroupSize; groupSize <= maxGroupSize; groupSize *= 2)
+        {
+            const WorkgroupDimensions candidate =
+                gpu.selectWorkgroupDimensions(info.invocationCount, groupSize, info.sharedSizePerInvocation);
+            if (std::find_if(candidates[k].begin(), candidates[k].end(), [&](const WorkgroupDimensions& c) -> bool {
+                    return c.size == candidate.size;
+                }) == candidates[k].end())
+            {
+                candidates[k].emplace_back(candidate);
+            }
+        }
+        roundCount = std::max(roundCount, static_cast<uint32_t>(candidates[k].size()));
+    }
+    if (roundCount == 0)
+    {
+        return;
+    }
+
+    // Keep the heuristic selection if the compute queue does not support timestamps.
+    const std::vector<QueueFamilyProperties> queueFamilies = gpu.device.getQueueFamilyProperties();
+    if (queueFamilies[gpu.computeQueueFamilyIndex].timestampValidBits == 0)
+    {
+        return;
+    }
+
+    // Compile the candidate shaders concurrently beforehand,
+    // so that recreating the pipelines while timing only loads the cached SPIR-V.
+    TaskGraph compilation;
+    for (uint32_t k = 0; k < simKernelCount; k++)
+    {
+        for (const WorkgroupDimensions& candidate : candidates[k])
+        {
+            compilation.add([this, k, groupSize = candidate.size]() {
+                Shader shader = simShader(static_cast<SimKernel>(k), groupSize);
+                shaderCompiler.compile(shader);
+            });
+        }
+    }
+    compilation.run();
+
+    // Back up the storage buffer, since the timed updates advance the simulation.
+    AllocatedBuffer backupBuffer =
+        createBuffer(storageBufferSize, BufferUsageFlagBits::eTransferSrc | BufferUsageFlagBits::eTransferDst);
+    // The timed updates are submitted without semaphores, so the uploads are waited for on the host.
+    setupTransfer();
+    copyBuffer(storageBuffer, backupBuffer);
+    playTransfer();
+    waitUploads();
+
+    // Time the simulation kernels round by round.
+    // In each round, every kernel with a candidate left uses it and is timed over the same updates.
+    timestampCapacity = initialTimestampCapacity;
+    timestampPool = device.createQueryPool(QueryPoolCreateInfo{
+        .queryType = QueryType::eTimestamp,
+        .queryCount = timestampCapacity,
+    });
+    std::array<std::vector<uint64_t>, simKernelCount> durations{};
+    // Was the kernel timed at all, i.e. dispatched during the timed updates?
+    std::array<bool, simKernelCount> sampled{};
+    for (uint32_t round = 0; round < roundCount; round++)
+    {
+        for (uint32_t k = 0; k < simKernelCount; k++)
+        {
+            if (round < candidates[k].size())
+            {
+                const SimKernelInfo info = simKernelInfo(static_cast<SimKernel>(k));
+                device.destroyPipeline(*info.pipeline);
+                simWorkgroups[k] = candidates[k][round];
+                *info.pipeline = createSimPipeline(static_cast<SimKernel>(k));
+                durations[k].emplace_back(0);
+            }
+        }
+        for (uint32_t i = 0; i <= tuningUpdateCount; i++)
+        {
+            device.resetCommandPool(simPools[updateIndex]);
+            recordSimulation(simBuffers[updateIndex]);
+            updateCount++;
+            computeQueue.submit(SubmitInfo{
+                .commandBufferCount = 1,
+                .pCommandBuffers = &simBuffers[updateIndex],
+            });
+            computeQueue.waitIdle();
+
+            // Grow the query pool and repeat the update if not all dispatches were timed,
+            // so that every kernel is timed over the same updates.
+            if (requiredTimestampCount > timestampCapacity)
+            {
+                device.destroyQueryPool(timestampPool);
+                timestampCapacity = requiredTimestampCount;
+                timestampPool = device.createQueryPool(QueryPoolCreateInfo{
+                    .queryType = QueryType::eTimestamp,
+                    .queryCount = timestampCapacity,
+                });
+                i--;
+                continue;
+            }
+
+            // Skip the warm-up update.
+            if (i == 0 || timestampCount == 0)
+            {
+                continue;
+            }
+            std::vector<uint64_t> timestamps;
+            std::tie(result, timestamps) = device.getQueryPoolResults<uint64_t>(
+                timestampPool, 0, timestampCount, timestampCount * sizeof(uint64_t), sizeof(uint64_t),
+                QueryResultFlagBits::e64 | QueryResultFlagBits::eWait);
+            if (result != Result::eSuccess)
+            {
+                throw std::runtime_error("Failed to get simulation timestamps");
+            }
+            for (uint32_t j = 0; j < timedKernels.size(); j++)
+            {
+                const uint32_t k = static_cast<uint32_t>(timedKernels[j]);
+                if (round < candidates[k].size())
+                {
+                    durations[k][round] += timestamps[2 * j + 1] - timestamps[2 * j];
+                    sampled[k] = true;
+                }
+            }
+        }
+    }
+    device.destroyQueryPool(timestampPool);
+    timestampPool = nullptr;
+
+    // Select the fastest candidates and recreate the pipelines if necessary.
+    // Kernels without samples keep the heuristic selection and are not cached, so they are tuned in the next run.
+    for (uint32_t k = 0; k < simKernelCount; k++)
+    {
+        if (candidates[k].empty())
+        {
+            continue;
+        }
+        const SimKernelInfo info = simKernelInfo(static_cast<SimKernel>(k));
+        const WorkgroupDimensions selected =
+            sampled[k]
+                ? candidates[k][std::min_element(durations[k].begin(), durations[k].end()) - durations[k].begin()]
+                : gpu.selectWorkgroupDimensions(info.invocationCount, info.desiredGroupSize,
+                                                info.sharedSizePerInvocation);
+        if (selected.size != candidates[k].back().size)
+        {
+            device.destroyPipeline(*info.pipeline);
+            simWorkgroups[k] = selected;
+            *info.pipeline = createSimPipeline(static_cast<SimKernel>(k));
+        }
+        cachedSimWorkgroups[k] = sampled[k];
+    }
+
+    // Restore the storage buffer, reset the statistics and the update count.
+    setupTransfer();
+    copyBuffer(backupBuffer, storageBuffer);
+    clearBuffer(statsBuffer);
+    playTransfer();
+    waitUploads();
+    destroyBuffer(backupBuffer);
+    updateCount = 0;
+
+    // Save the tuned group sizes to the cache.
+    // The cache only saves tuning time, so a failure to write it is reported without failing the demo.
+    const fs::path path = workgroupCachePath();
+    std::error_code error;
+    fs::create_directories(path.parent_path(), error);
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::clog << "Failed to save workgroup cache to " << path.string() << std::endl;
+        return;
+    }
+    for (uint32_t k = 0; k < simKernelCount; k++)
+    {
+        const SimKernelInfo info = simKernelInfo(static_cast<SimKernel>(k));
+        if (info.tunable && cachedSimWorkgroups[k])
+        {
+            file << info.name << " " << info.invocationCount << " " << simWorkgroups[k].size << "\n";
+        }
+    }
+}
\ No newline at end of file
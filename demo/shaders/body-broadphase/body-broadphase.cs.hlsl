@@ -0,0 +1,128 @@
+#include <collision.hlsl>
+
+struct PushConstant
+{
+    // bounding box margin (maximum particle displacement during the update)
+    float margin;
+    // maximum particle count per collider chunk
+    uint chunkSize;
+    // body count
+    uint n;
+};
+[[vk::push_constant]] PushConstant _;
+
+struct PlayerCollision
+{
+    // AABB minimum position
+    float4 x_min;
+    // AABB maximum position
+    float4 x_max;
+};
+[[vk::binding(0)]] ConstantBuffer<PlayerCollision> player;
+
+struct Body
+{
+    // particle index range
+    uint begin;
+    uint end;
+};
+// bodies
+[[vk::binding(1)]] StructuredBuffer<Body> bodies;
+// particle positions
+[[vk::binding(2)]] StructuredBuffer<float4> x;
+// particle radii
+[[vk::binding(3)]] StructuredBuffer<float> r;
+// collider chunks of the bodies overlapping a collider
+[[vk::binding(4)]] RWStructuredBuffer<ColliderChunk> chunks;
+// indirect dispatch arguments of the object collide pass (collider chunk count, 1, 1),
+// followed by the count of the chunks culled by the moon shell test
+[[vk::binding(5)]] RWStructuredBuffer<uint> args;
+
+// group-shared bounding box bounds
+groupshared float3 g_min[g_n];
+groupshared float3 g_max[g_n];
+// group-shared collider chunk range and collider group bits of the body
+groupshared uint g_base;
+groupshared uint g_count;
+groupshared uint g_colliders;
+
+// Each workgroup processes one body.
+[numthreads(g_n, 1, 1)]
+void main(uint3 group : SV_GroupID, uint3 g_thread : SV_GroupThreadID)
+{
+    static const float FLT_MAX = asfloat(0x7F7FFFFF);
+
+    const uint k = group.x;
+    const uint g_i = g_thread.x;
+    if (k >= _.n)
+    {
+        return;
+    }
+    const Body body = bodies[k];
+
+    // Calculate the bounding box of the body particles.
+    float3 b_min = FLT_MAX;
+    float3 b_max = -FLT_MAX;
+    for (uint i = body.begin + g_i; i < body.end; i += g_n)
+    {
+        b_min = min(b_min, x[i].xyz - r[i]);
+        b_max = max(b_max, x[i].xyz + r[i]);
+    }
+    g_min[g_i] = b_min;
+    g_max[g_i] = b_max;
+    for (uint dist = g_n >> 1; dist > 0; dist >>= 1)
+    {
+        GroupMemoryBarrierWithGroupSync();
+        if (g_i < dist)
+        {
+            g_min[g_i] = min(g_min[g_i], g_min[g_i + dist]);
+            g_max[g_i] = max(g_max[g_i], g_max[g_i + dist]);
+        }
+    }
+
+    // Determine the colliders overlapping the bounding box, enlarged by the displacement during the update,
+    // and reserve the collider chunks of the body.
+    if (g_i == 0)
+    {
+        b_min = g_min[0];
+        b_max = g_max[0];
+        const uint chunkCount = (body.end - body.begin + _.chunkSize - 1) / _.chunkSize;
+        uint colliders = 0;
+        // Only the moon surface collides, so the body is tested against the spherical shell within the margin
+        // around the surface, i.e. the nearest point of the box must lie within the outer sphere
+        // and its farthest corner outside the inner sphere.
+        const float3 closest = clamp(0.0, b_min, b_max);
+        const float3 farthest = max(abs(b_min), abs(b_max));
+        const float d_min = dot(closest, closest);
+        const float d_max = dot(farthest, farthest);
+        if (d_min <= (MOON_RADIUS + _.margin) * (MOON_RADIUS + _.margin))
+        {
+            if (d_max >= (MOON_RADIUS - _.margin) * (MOON_RADIUS - _.margin))
+            {
+                colliders |= COLLISION_MOON;
+            }
+            else
+            {
+                InterlockedAdd(args[3], chunkCount);
+            }
+        }
+        if (overlap(b_min - _.margin, b_max + _.margin, player.x_min.xyz, player.x_max.xyz))
+        {
+            colliders |= COLLISION_PLAYER;
+        }
+        g_colliders = colliders;
+        g_count = (colliders != 0) ? chunkCount : 0;
+        InterlockedAdd(args[0], g_count, g_base);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Write the collider chunks.
+    for (uint c = g_i; c < g_count; c += g_n)
+    {
+        ColliderChunk chunk;
+        chunk.begin = body.begin + c * _.chunkSize;
+        chunk.end = min(chunk.begin + _.chunkSize, body.end);
+        chunk.colliders = g_colliders;
+        chunks[g_base + c] = chunk;
+    }
+}
\ No newline at end of file
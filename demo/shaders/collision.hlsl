@@ -0,0 +1,47 @@
+#pragma once
+
+// collision groups
+// A particle collision filter holds the group bits of the particle in the lower half
+// and the mask bits of the groups it collides with in the upper half.
+enum CollisionGroup : uint {
+    COLLISION_BODY = 1,
+    COLLISION_STAR_PARTICLE = 2,
+    COLLISION_MOON = 4,
+    COLLISION_PLAYER = 8,
+};
+
+// moon radius
+static const float MOON_RADIUS = 20.0;
+
+// range of particles of a body checked against the given colliders (collision group bits)
+struct ColliderChunk
+{
+    // particle index range
+    uint begin;
+    uint end;
+    // collider group bits
+    uint colliders;
+};
+
+// Return true if the axis-aligned bounding boxes overlap. Return false otherwise.
+bool overlap(float3 a_min, float3 a_max, float3 b_min, float3 b_max)
+{
+    return (a_min.x < b_max.x &&
+            a_min.y < b_max.y &&
+            a_min.z < b_max.z &&
+            a_max.x > b_min.x &&
+            a_max.y > b_min.y &&
+            a_max.z > b_min.z);
+}
+
+// Return true if the particles with the given collision filters collide. Return false otherwise.
+bool collides(uint filter_i, uint filter_j)
+{
+    return (filter_i & (filter_j >> 16)) != 0 && (filter_j & (filter_i >> 16)) != 0;
+}
+
+// Return true if the particle with the given collision filter collides with the given group. Return false otherwise.
+bool collidesWith(uint filter, uint group)
+{
+    return ((filter >> 16) & group) != 0;
+}
\ No newline at end of file
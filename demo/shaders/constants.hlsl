@@ -0,0 +1,9 @@
+#pragma once
+
+// simulation constants, specialized when the simulation pipelines are created
+// They are folded by the driver like literals, without recompiling the shaders for another scene.
+
+// XPBD substep delta time
+[[vk::constant_id(0)]] const float SUBSTEP_DT = 1.0;
+// spatial table size (power of two)
+[[vk::constant_id(1)]] const uint SPATIAL_TABLE_SIZE = 1;
\ No newline at end of file
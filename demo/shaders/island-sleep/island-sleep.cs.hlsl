@@ -0,0 +1,87 @@
+#include <island.hlsl>
+#include <state.hlsl>
+
+struct PushConstant
+{
+    // maximum kinetic energy per unit mass at rest
+    float e_rest;
+    // rest count after which an island sleeps
+    uint restCount;
+    // island count
+    uint n;
+};
+[[vk::push_constant]] PushConstant _;
+
+// islands
+[[vk::binding(0)]] RWStructuredBuffer<Island> islands;
+// particle indices sorted by island
+[[vk::binding(1)]] StructuredBuffer<uint> islandIdx;
+// particle velocities
+[[vk::binding(2)]] RWStructuredBuffer<float4> v;
+// particle states
+[[vk::binding(3)]] RWStructuredBuffer<uint> state;
+
+// group-shared maximum kinetic energies per unit mass
+groupshared float g_e[g_n];
+
+// Each workgroup processes one island.
+[numthreads(g_n, 1, 1)]
+void main(uint3 group : SV_GroupID, uint3 g_thread : SV_GroupThreadID)
+{
+    const uint k = group.x;
+    const uint g_i = g_thread.x;
+    if (k >= _.n)
+    {
+        return;
+    }
+    const Island island = islands[k];
+
+    // Calculate the maximum kinetic energy per unit mass of the island particles.
+    float e = 0.0;
+    for (uint idx = island.begin + g_i; idx < island.end; idx += g_n)
+    {
+        const uint i = islandIdx[idx];
+        if (state[i] != STATIC)
+        {
+            e = max(e, 0.5 * dot(v[i].xyz, v[i].xyz));
+        }
+    }
+    g_e[g_i] = e;
+    for (uint dist = g_n >> 1; dist > 0; dist >>= 1)
+    {
+        GroupMemoryBarrierWithGroupSync();
+        if (g_i < dist)
+        {
+            g_e[g_i] = max(g_e[g_i], g_e[g_i + dist]);
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Count the consecutive updates at rest unless the island is woken up.
+    const bool asleep = island.restCount >= _.restCount;
+    const uint restCount = (island.wake != 0 || g_e[0] >= _.e_rest) ? 0 : min(island.restCount + 1, _.restCount);
+    const bool sleep = restCount >= _.restCount;
+
+    // Put the island particles to sleep and stop them, or wake them up.
+    if (sleep != asleep)
+    {
+        for (uint idx = island.begin + g_i; idx < island.end; idx += g_n)
+        {
+            const uint i = islandIdx[idx];
+            if (sleep && state[i] == FREE)
+            {
+                state[i] = SLEEP;
+                v[i].xyz = 0.0;
+            }
+            else if (!sleep && state[i] == SLEEP)
+            {
+                state[i] = FREE;
+            }
+        }
+    }
+    if (g_i == 0)
+    {
+        islands[k].restCount = restCount;
+        islands[k].wake = 0;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+// simulation island (connected component of the constraint graph)
+struct Island
+{
+    // range of the island particle indices
+    uint begin;
+    uint end;
+    // consecutive updates at rest (the island sleeps once the rest count is reached)
+    uint restCount;
+    // Is the island woken up in the next update? (non-zero)
+    uint wake;
+};
\ No newline at end of file
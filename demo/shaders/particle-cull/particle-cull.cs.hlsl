@@ -0,0 +1,94 @@
+#include <collision.hlsl>
+
+struct PushConstant
+{
+    // view-projection matrix
+    float4x4 viewProjection;
+    // view position
+    float4 viewPosition;
+    // star position (xyz) and radius of the star core hiding the parked particles (w)
+    float4 star;
+    // particle radius
+    float radius;
+    // particle count
+    uint n;
+};
+[[vk::push_constant]] PushConstant _;
+
+// particle positions
+[[vk::binding(0)]] StructuredBuffer<float4> positions;
+// indexed indirect draw arguments (index count, instance count, first index, vertex offset, first instance)
+[[vk::binding(1)]] RWStructuredBuffer<uint> draw;
+// visible particle indices
+[[vk::binding(2)]] RWStructuredBuffer<uint> instances;
+
+// Return true if the particle sphere intersects the view frustum. Return false otherwise.
+bool inFrustum(float3 x)
+{
+    // Extract the side planes and the plane through the view position (w = 0) from the matrix rows.
+    const float4 row0 = _.viewProjection[0];
+    const float4 row1 = _.viewProjection[1];
+    const float4 row3 = _.viewProjection[3];
+    const float4 planes[5] = {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3};
+    [unroll]
+    for (uint p = 0; p < 5; p++)
+    {
+        if (dot(planes[p].xyz, x) + planes[p].w < -_.radius * length(planes[p].xyz))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Return true if the moon hides the particle sphere entirely. Return false otherwise.
+bool behindMoon(float3 x)
+{
+    // The moon is centered at the origin. The particle is hidden if it lies farther from the view position
+    // than the moon center and its angular extent lies within the moon silhouette.
+    const float3 e = _.viewPosition.xyz;
+    const float e_dist = length(e);
+    const float3 d = x - e;
+    const float d_dist = length(d);
+    if (e_dist <= MOON_RADIUS || d_dist - _.radius < e_dist)
+    {
+        return false;
+    }
+    const float angle = acos(clamp(dot(d, -e) / (d_dist * e_dist), -1.0, 1.0));
+    return angle + asin(_.radius / d_dist) <= asin(MOON_RADIUS / e_dist);
+}
+
+[numthreads(g_n, 1, 1)]
+void main(uint3 thread : SV_DispatchThreadID)
+{
+    const uint i = thread.x;
+    bool visible = false;
+    if (i < _.n)
+    {
+        const float3 x = positions[i].xyz;
+        visible = distance(x, _.star.xyz) + _.radius > _.star.w && inFrustum(x) && !behindMoon(x);
+    }
+
+    // Append the visible particles to the instance indices.
+#if WAVE
+    // Only the first lane increments the instance count for the whole wave.
+    const uint count = WaveActiveCountBits(visible);
+    uint base = 0;
+    if (WaveIsFirstLane() && count > 0)
+    {
+        InterlockedAdd(draw[1], count, base);
+    }
+    base = WaveReadLaneFirst(base);
+    if (visible)
+    {
+        instances[base + WavePrefixCountBits(visible)] = i;
+    }
+#else
+    if (visible)
+    {
+        uint slot;
+        InterlockedAdd(draw[1], 1, slot);
+        instances[slot] = i;
+    }
+#endif
+}
\ No newline at end of file
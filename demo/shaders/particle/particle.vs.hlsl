@@ -9,10 +9,12 @@ struct Transform
 
 // particle positions
 [[vk::binding(0)]] StructuredBuffer<float4> positions;
+// visible particle indices
+[[vk::binding(1)]] StructuredBuffer<uint> instances;
 
 struct Input
 {
-    // particle index
+    // visible particle index
     uint i : SV_InstanceID;
     // local position
     [[vk::location(0)]] float3 position : POSITION;
@@ -27,7 +29,7 @@ struct Output
 Output main(Input input)
 {
     Output output;
-    output.position = float4(positions[input.i].xyz + transform.radius * input.position, 1.0);
+    output.position = float4(positions[instances[input.i]].xyz + transform.radius * input.position, 1.0);
     output.position = mul(transform.viewProjection, output.position);
     return output;
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include <state.hlsl>
+#include <stats.hlsl>
+
+struct PushConstant
+{
+    // moon gravity
+    float g;
+    // particle count
+    uint n;
+    // constraint count
+    uint m;
+    // first particle index
+    uint i0;
+    // first constraint index
+    uint c0;
+    // batched copy index
+    uint b;
+};
+[[vk::push_constant]] PushConstant _;
+
+struct DistanceConstraint
+{
+    // particle indices
+    uint i;
+    uint j;
+    // distance
+    float d;
+    // compliance
+    float alpha;
+};
+// particle positions
+[[vk::binding(0)]] StructuredBuffer<float4> x;
+// particle velocities
+[[vk::binding(1)]] StructuredBuffer<float4> v;
+// particle weights (= inverse masses)
+[[vk::binding(2)]] StructuredBuffer<float> w;
+// particle states
+[[vk::binding(3)]] StructuredBuffer<uint> state;
+// distance constraints
+[[vk::binding(4)]] StructuredBuffer<DistanceConstraint> constr;
+// simulation statistics
+[[vk::binding(5)]] RWStructuredBuffer<uint> stats;
+
+// group-shared particle energies
+groupshared float g_E[g_n];
+
+[numthreads(g_n, 1, 1)]
+void main(uint3 thread : SV_DispatchThreadID, uint3 g_thread : SV_GroupThreadID)
+{
+    const uint t = thread.x;
+    const uint g_i = g_thread.x;
+    // particle and constraint index within the batched copy
+    const uint i = _.i0 + t;
+    const uint c = _.c0 + t;
+    // statistics of the batched copy
+    const uint b = _.b * STATS_SIZE;
+
+    // Calculate the kinetic and potential energy of the free particles.
+    float E = 0.0;
+    if (t < _.n && state[i] != STATIC && w[i] > 0.0)
+    {
+        E = (0.5 * dot(v[i].xyz, v[i].xyz) - _.g * length(x[i].xyz)) / w[i];
+    }
+
+    // Calculate the distance constraint error.
+    float C = 0.0;
+    if (t < _.m)
+    {
+        C = abs(distance(x[constr[c].i].xyz, x[constr[c].j].xyz) - constr[c].d);
+    }
+
+    // Count the particle states and calculate the maximum distance constraint error.
+    // The bit patterns of non-negative floats keep their order when interpreted as unsigned integers.
+#if WAVE
+    // Load the state once. Lanes past the copy hold no valid state, but still take part in the wave operations.
+    const uint state_i = (t < _.n) ? state[i] : ~0u;
+    for (uint s = FREE; s <= SLEEP; s++)
+    {
+        const uint count = WaveActiveCountBits(state_i == s);
+        if (WaveIsFirstLane() && count > 0)
+        {
+            InterlockedAdd(stats[b + STATE_COUNTS + s], count);
+        }
+    }
+    C = WaveActiveMax(C);
+    if (WaveIsFirstLane())
+    {
+        InterlockedMax(stats[b + MAX_CONSTR_ERROR], asuint(C));
+    }
+#else
+    if (t < _.n)
+    {
+        InterlockedAdd(stats[b + STATE_COUNTS + state[i]], 1);
+    }
+    if (t < _.m)
+    {
+        InterlockedMax(stats[b + MAX_CONSTR_ERROR], asuint(C));
+    }
+#endif
+
+    // Reduce the energies of the workgroup.
+#if WAVE
+    // Sum within each wave first, so only the first lanes use group-shared memory.
+    E = WaveActiveSum(E);
+    if (WaveIsFirstLane())
+    {
+        g_E[g_i / WaveGetLaneCount()] = E;
+    }
+    GroupMemoryBarrierWithGroupSync();
+    if (g_i == 0)
+    {
+        for (uint wave = 1; wave < g_n / WaveGetLaneCount(); wave++)
+        {
+            g_E[0] += g_E[wave];
+        }
+    }
+#else
+    g_E[g_i] = E;
+    for (uint dist = g_n >> 1; dist > 0; dist >>= 1)
+    {
+        GroupMemoryBarrierWithGroupSync();
+        if (g_i < dist)
+        {
+            g_E[g_i] += g_E[g_i + dist];
+        }
+    }
+#endif
+
+    // Accumulate the workgroup energy via compare-and-swap.
+    if (g_i == 0)
+    {
+        uint E_expected = stats[b + ENERGY];
+        uint E_original;
+        [allow_uav_condition] while (true)
+        {
+            InterlockedCompareExchange(stats[b + ENERGY], E_expected, asuint(asfloat(E_expected) + g_E[0]), E_original);
+            if (E_original == E_expected)
+            {
+                break;
+            }
+            E_expected = E_original;
+        }
+    }
+}
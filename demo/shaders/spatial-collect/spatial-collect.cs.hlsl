@@ -4,30 +4,52 @@ struct PushConstant
 {
     // particle count
     uint n;
+    // generation stamp
+    uint stamp;
 };
 [[vk::push_constant]] PushConstant _;
 
 // spatial indices
 [[vk::binding(0)]] StructuredBuffer<Spatial> spat;
-// hash value => spatial index range of grid cell
-[[vk::binding(1)]] RWStructuredBuffer<uint2> cell;
+// hash value => spatial table entry
+[[vk::binding(1)]] RWStructuredBuffer<Cell> cell;
 
 [numthreads(g_n, 1, 1)]
 void main(uint3 thread : SV_DispatchThreadID)
 {
     const uint i = thread.x;
+    const uint h = spat[min(i, _.n - 1)].h;
+#if WAVE
+    // Exchange the hash values of the adjacent lanes before any lane is inactive.
+    const uint lane = WaveGetLaneIndex();
+    const uint lastLane = WaveGetLaneCount() - 1;
+    const uint h_prev = WaveReadLaneAt(h, max(lane, 1) - 1);
+    const uint h_next = WaveReadLaneAt(h, min(lane + 1, lastLane));
+#endif
     if (i >= _.n)
     {
         return;
     }
 
-    // Store the bounds for each grid cell.
-    if (i == 0 || spat[i - 1].h != spat[i].h)
+    // Detect the bounds of each hash value.
+#if WAVE
+    // Only the lanes at the wave borders read the adjacent hash values from memory.
+    const bool begin = i == 0 || (lane == 0 ? spat[i - 1].h : h_prev) != h;
+    const bool end = i == _.n - 1 || (lane == lastLane ? spat[i + 1].h : h_next) != h;
+#else
+    const bool begin = i == 0 || spat[i - 1].h != h;
+    const bool end = i == _.n - 1 || spat[i + 1].h != h;
+#endif
+
+    // Store the bounds for each hash value and stamp the entry.
+    // Entries with an older stamp are stale and ignored, so the table does not need to be cleared.
+    if (begin)
     {
-        cell[spat[i].h].x = i;
+        cell[h].begin = i;
+        cell[h].stamp = _.stamp;
     }
-    if (i == _.n - 1 || spat[i].h != spat[i + 1].h)
+    if (end)
     {
-        cell[spat[i].h].y = i;
+        cell[h].end = i;
     }
 }
\ No newline at end of file
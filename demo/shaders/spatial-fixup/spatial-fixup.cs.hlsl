@@ -0,0 +1,85 @@
+#include <spatial.hlsl>
+
+struct PushConstant
+{
+    // workgroup counts of the full sort passes
+    uint rehashCount;
+    uint sortCount;
+    uint groupsortCount;
+    // workgroup count of the merge passes
+    uint mergeCount;
+};
+[[vk::push_constant]] PushConstant _;
+
+// moved spatial indices
+[[vk::binding(0)]] RWStructuredBuffer<SpatialMove> moved;
+// spatial sort arguments
+[[vk::binding(1)]] RWStructuredBuffer<uint> args;
+
+// group-shared moved hash values and particle indices
+groupshared uint2 g_move[g_n];
+// group-shared moved positions
+groupshared uint g_slot[g_n];
+
+// A single workgroup sorts the moved spatial indices, so the capacity is the group size.
+[numthreads(g_n, 1, 1)]
+void main(uint3 g_thread : SV_GroupThreadID)
+{
+    const uint g_i = g_thread.x;
+    const uint m = args[MOVED_COUNT];
+
+    // Fall back to the full sort if the moved indices exceed the capacity. Merge them otherwise.
+    const bool full = m > g_n;
+    if (g_i == 0)
+    {
+        args[REHASH_ARGS] = full ? _.rehashCount : 0;
+        args[SORT_ARGS] = full ? _.sortCount : 0;
+        args[GROUPSORT_ARGS] = full ? _.groupsortCount : 0;
+        args[MERGE_ARGS] = (!full && m > 0) ? _.mergeCount : 0;
+    }
+    if (full || m == 0)
+    {
+        return;
+    }
+
+    // Sort the hash values and the previous positions of the moved indices independently.
+    // The merge inserts the former by hash value and removes the latter by position.
+    static const uint UINT_MAX = 0xFFFFFFFF;
+    g_move[g_i] = (g_i < m) ? uint2(moved[g_i].h, moved[g_i].i) : UINT_MAX;
+    g_slot[g_i] = (g_i < m) ? moved[g_i].slot : UINT_MAX;
+    for (uint peak = 2; peak <= g_n; peak <<= 1)
+    {
+        const bool increase = (g_i & peak) == 0;
+        for (uint dist = peak >> 1; dist > 0; dist >>= 1)
+        {
+            GroupMemoryBarrierWithGroupSync();
+
+            const uint g_j = g_i ^ dist;
+            if (g_i < g_j) // Do not swap back.
+            {
+                // Compare the order of the elements with the order of the monotonic sequence.
+                if ((increase && (g_move[g_i].x > g_move[g_j].x)) || (!increase && (g_move[g_i].x < g_move[g_j].x)))
+                {
+                    // Swap the elements so that the orders match.
+                    const uint2 g_move_g_i = g_move[g_i];
+                    g_move[g_i] = g_move[g_j];
+                    g_move[g_j] = g_move_g_i;
+                }
+                if ((increase && (g_slot[g_i] > g_slot[g_j])) || (!increase && (g_slot[g_i] < g_slot[g_j])))
+                {
+                    const uint g_slot_g_i = g_slot[g_i];
+                    g_slot[g_i] = g_slot[g_j];
+                    g_slot[g_j] = g_slot_g_i;
+                }
+            }
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (g_i < m)
+    {
+        moved[g_i].h = g_move[g_i].x;
+        moved[g_i].i = g_move[g_i].y;
+        moved[g_i].slot = g_slot[g_i];
+    }
+}
\ No newline at end of file
@@ -26,8 +26,16 @@ void main(uint3 thread : SV_DispatchThreadID, uint3 g_thread : SV_GroupThreadID)
 
     GroupMemoryBarrierWithGroupSync();
 
-    for (uint dist = _.dist; dist > 0; dist >>= 1)
+    uint dist = _.dist;
+    for (; dist > 0; dist >>= 1)
     {
+#if WAVE
+        if (dist < WaveGetLaneCount())
+        {
+            // Perform the rest of the subiterations within the wave.
+            break;
+        }
+#endif
         const uint g_j = g_i ^ dist;
 
         if (g_i < g_j) // Do not swap back.
@@ -45,5 +53,25 @@ void main(uint3 thread : SV_DispatchThreadID, uint3 g_thread : SV_GroupThreadID)
         GroupMemoryBarrierWithGroupSync();
     }
 
+#if WAVE
+    // Compare the elements of lanes at the given distance by shuffling them within the wave.
+    Spatial spat_i = g_spat[g_i];
+    const uint lane = WaveGetLaneIndex();
+    for (; dist > 0; dist >>= 1)
+    {
+        Spatial spat_j;
+        spat_j.h = WaveReadLaneAt(spat_i.h, lane ^ dist);
+        spat_j.i = WaveReadLaneAt(spat_i.i, lane ^ dist);
+
+        // The lower element of a pair keeps the minimum in an increasing sequence and the maximum otherwise.
+        const bool keepMin = ((g_i & dist) == 0) == increase;
+        if ((keepMin && spat_j.h < spat_i.h) || (!keepMin && spat_j.h > spat_i.h))
+        {
+            spat_i = spat_j;
+        }
+    }
+    spat[i] = spat_i;
+#else
     spat[i] = g_spat[g_i];
+#endif
 }
\ No newline at end of file
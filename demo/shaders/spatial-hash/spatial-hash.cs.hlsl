@@ -1,3 +1,4 @@
+#include <constants.hlsl>
 #include <spatial.hlsl>
 
 struct PushConstant
@@ -10,6 +11,14 @@ struct PushConstant
     float l;
     // particle count
     uint n;
+    // Update the spatial indices sorted in the last update incrementally? (non-zero)
+    uint incremental;
+    // moved spatial index capacity
+    uint capacity;
+    // first particle index of the batched copies (the preceding particles belong to the first copy)
+    uint batchBegin;
+    // particle count of a batched copy
+    uint batchParticleCount;
 };
 [[vk::push_constant]] PushConstant _;
 
@@ -19,27 +28,56 @@ struct PushConstant
 [[vk::binding(1)]] StructuredBuffer<float4> v;
 // spatial indices
 [[vk::binding(2)]] RWStructuredBuffer<Spatial> spat;
+// cell keys
+[[vk::binding(3)]] RWStructuredBuffer<uint4> key;
+// moved spatial indices
+[[vk::binding(4)]] RWStructuredBuffer<SpatialMove> moved;
+// spatial sort arguments
+[[vk::binding(5)]] RWStructuredBuffer<uint> args;
 
 [numthreads(g_n, 1, 1)]
 void main(uint3 thread : SV_DispatchThreadID)
 {
     static const float dt_sq_g = _.dt * _.dt * _.g;
 
-    const uint i = thread.x;
-    if (i >= _.n)
+    const uint s = thread.x;
+    if (s >= _.n)
     {
         return;
     }
+    // In incremental mode, the spatial indices keep the order of the last update.
+    const uint i = _.incremental ? spat[s].i : s;
 
-    // Calculate the cell index for the predicted position after a full time step.
+    // Calculate the cell key for the predicted position after a full time step.
     const float3 x_i = x[i].xyz + _.dt * v[i].xyz + dt_sq_g * normalize(x[i].xyz);
-    const uint3 c_i = uint3(
-        asuint(floor(x_i.x / _.l)),
-        asuint(floor(x_i.y / _.l)),
-        asuint(floor(x_i.z / _.l))
-    );
-
-    // Hash the cell index and store it together with the particle index.
-    spat[i].h = ((73856093 * c_i.x) ^ (19349663 * c_i.y) ^ (83492791 * c_i.z)) % _.n;
-    spat[i].i = i;
+    const uint3 c_i = cellKey(x_i, _.l);
+
+    // Store the full cell key and the batched copy to reject hash collisions and particles of other copies.
+    const uint b_i = (i < _.batchBegin) ? 0 : (i - _.batchBegin) / _.batchParticleCount;
+    key[i] = uint4(c_i, b_i);
+
+    // Hash the cell key. The batched copies are offset, so that their particles do not share the entries.
+    const uint h = (cellHash(c_i, SPATIAL_TABLE_SIZE) + b_i * 50331653) % SPATIAL_TABLE_SIZE;
+
+    // In incremental mode, keep the previous hash value, so that the spatial indices stay sorted,
+    // and record the index as moved if the hash value changed.
+    if (_.incremental)
+    {
+        if (h != spat[s].h)
+        {
+            uint k;
+            InterlockedAdd(args[MOVED_COUNT], 1, k);
+            if (k < _.capacity)
+            {
+                moved[k].h = h;
+                moved[k].i = i;
+                moved[k].slot = s;
+            }
+        }
+        return;
+    }
+
+    // Store the hash value together with the particle index.
+    spat[s].h = h;
+    spat[s].i = i;
 }
\ No newline at end of file
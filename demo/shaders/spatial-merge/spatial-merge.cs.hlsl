@@ -0,0 +1,115 @@
+#include <spatial.hlsl>
+
+struct PushConstant
+{
+    // spatial index count
+    uint n;
+    // Copy the merged spatial indices back? (non-zero)
+    uint copy;
+};
+[[vk::push_constant]] PushConstant _;
+
+// spatial indices
+[[vk::binding(0)]] RWStructuredBuffer<Spatial> spat;
+// moved spatial indices (sorted by hash value and position independently)
+[[vk::binding(1)]] StructuredBuffer<SpatialMove> moved;
+// merged spatial indices
+[[vk::binding(2)]] RWStructuredBuffer<Spatial> merged;
+// spatial sort arguments
+[[vk::binding(3)]] StructuredBuffer<uint> args;
+
+// Return the number of the first m moved indices with a hash value less than h.
+uint countMovedHashes(uint h, uint m)
+{
+    uint begin = 0;
+    uint end = m;
+    while (begin < end)
+    {
+        const uint mid = (begin + end) / 2;
+        if (moved[mid].h < h)
+        {
+            begin = mid + 1;
+        }
+        else
+        {
+            end = mid;
+        }
+    }
+    return begin;
+}
+
+// Return the number of the first m moved indices with a previous position less than s.
+uint countMovedSlots(uint s, uint m)
+{
+    uint begin = 0;
+    uint end = m;
+    while (begin < end)
+    {
+        const uint mid = (begin + end) / 2;
+        if (moved[mid].slot < s)
+        {
+            begin = mid + 1;
+        }
+        else
+        {
+            end = mid;
+        }
+    }
+    return begin;
+}
+
+// Return the number of spatial indices with a hash value less than or equal to h.
+// The moved indices keep their previous hash values, so the spatial indices are still sorted.
+uint countHashes(uint h)
+{
+    uint begin = 0;
+    uint end = _.n;
+    while (begin < end)
+    {
+        const uint mid = (begin + end) / 2;
+        if (spat[mid].h <= h)
+        {
+            begin = mid + 1;
+        }
+        else
+        {
+            end = mid;
+        }
+    }
+    return begin;
+}
+
+[numthreads(g_n, 1, 1)]
+void main(uint3 thread : SV_DispatchThreadID)
+{
+    const uint s = thread.x;
+    if (s >= _.n)
+    {
+        return;
+    }
+    if (_.copy)
+    {
+        spat[s] = merged[s];
+        return;
+    }
+    const uint m = args[MOVED_COUNT];
+
+    // Each unmoved index keeps its relative order. It is shifted back by the moved indices removed before it
+    // and forth by the moved indices inserted before it, i.e. those with lower hash values.
+    const uint removed = countMovedSlots(s, m);
+    if (removed == m || moved[removed].slot != s)
+    {
+        const Spatial spat_s = spat[s];
+        merged[s - removed + countMovedHashes(spat_s.h, m)] = spat_s;
+    }
+
+    // Each moved index is inserted after the unmoved indices with lower or equal hash values.
+    if (s < m)
+    {
+        const uint unmoved = countHashes(moved[s].h);
+        Spatial spat_s;
+        spat_s.h = moved[s].h;
+        spat_s.i = moved[s].i;
+        merged[s + unmoved - countMovedSlots(unmoved, m)] = spat_s;
+    }
+}
\ No newline at end of file
@@ -7,4 +7,48 @@ struct Spatial
     uint h;
     // particle index
     uint i;
-};
\ No newline at end of file
+};
+
+// spatial index whose hash value changed since the last update
+struct SpatialMove
+{
+    // new hash value
+    uint h;
+    // particle index
+    uint i;
+    // position in the spatial indices sorted in the last update
+    uint slot;
+};
+
+// element indices of the spatial sort arguments (moved spatial index count and indirect dispatch arguments)
+static const uint MOVED_COUNT = 0;
+static const uint REHASH_ARGS = 1;
+static const uint SORT_ARGS = 4;
+static const uint GROUPSORT_ARGS = 7;
+static const uint MERGE_ARGS = 10;
+
+// spatial table entry
+struct Cell
+{
+    // spatial index range
+    uint begin;
+    uint end;
+    // generation stamp of the last update writing the entry
+    uint stamp;
+};
+
+// Return the key of the grid cell containing the position.
+uint3 cellKey(float3 x, float l)
+{
+    return uint3(
+        asuint(int(floor(x.x / l))),
+        asuint(int(floor(x.y / l))),
+        asuint(int(floor(x.z / l)))
+    );
+}
+
+// Return the hash value of the cell key for a table of the given size.
+uint cellHash(uint3 key, uint size)
+{
+    return ((73856093 * key.x) ^ (19349663 * key.y) ^ (83492791 * key.z)) % size;
+}
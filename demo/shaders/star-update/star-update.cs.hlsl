@@ -27,9 +27,10 @@ void main(uint3 thread : SV_DispatchThreadID)
     static const float3 x_star = {0.0, 30.0, 0.0};
 
     const uint i = thread.x;
+    bool arrived = false;
     if (i >= _.n || state[i] == STATIC)
     {
-        return;
+        // The particle is inactive.
     }
     else if (state[i] == FREE)
     {
@@ -56,8 +57,21 @@ void main(uint3 thread : SV_DispatchThreadID)
         {
             x[i].xyz = x_star;
             state[i] = STATIC;
-            // Count the particles at the star.
-            InterlockedAdd(counter[0], 1);
+            arrived = true;
         }
     }
+
+    // Count the particles at the star.
+#if WAVE
+    const uint count = WaveActiveCountBits(arrived);
+    if (WaveIsFirstLane() && count > 0)
+    {
+        InterlockedAdd(counter[0], count);
+    }
+#else
+    if (arrived)
+    {
+        InterlockedAdd(counter[0], 1);
+    }
+#endif
 }
\ No newline at end of file
@@ -6,4 +6,5 @@ enum State : uint {
     PLAYER = 1,
     STAR = 2,
     STATIC = 3,
+    SLEEP = 4,
 };
\ No newline at end of file
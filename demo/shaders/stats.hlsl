@@ -0,0 +1,14 @@
+#pragma once
+
+// simulation statistics indices
+enum Stats : uint {
+    COUNTER = 0,
+    STATE_COUNTS = 1,
+    MAX_CONSTR_ERROR = 6,
+    ENERGY = 7,
+    COLLIDER_CHUNKS = 8,
+    SHELL_CULLED_CHUNKS = 9,
+};
+
+// simulation statistics size (in elements)
+static const uint STATS_SIZE = 10;
@@ -1,9 +1,8 @@
+#include <constants.hlsl>
 #include <state.hlsl>
 
 struct PushConstant
 {
-    // time step
-    float dt;
     // particle count
     uint n;
 };
@@ -25,11 +24,11 @@ struct PushConstant
 [numthreads(g_n, 1, 1)]
 void main(uint3 thread : SV_DispatchThreadID)
 {
-    static const float dt_inv = 1.0 / _.dt;
+    static const float dt_inv = 1.0 / SUBSTEP_DT;
     static const float v_max = 0.01 * dt_inv;
 
     const uint i = thread.x;
-    if (i >= _.n || state[i] == STATIC)
+    if (i >= _.n || state[i] == STATIC || state[i] == SLEEP)
     {
         return;
     }
@@ -1,7 +1,8 @@
+#include <constants.hlsl>
+#include <state.hlsl>
+
 struct PushConstant
 {
-    // time step
-    float dt;
     // constraint count
     uint n;
 };
@@ -25,11 +26,13 @@ struct DistanceConstraint
 [[vk::binding(2)]] StructuredBuffer<float> w;
 // position deltas (* 10^7)
 [[vk::binding(3)]] RWStructuredBuffer<int> dxE7;
+// particle states
+[[vk::binding(4)]] StructuredBuffer<uint> state;
 
 [numthreads(g_n, 1, 1)]
 void main(uint3 thread : SV_DispatchThreadID)
 {
-    static const float dt_sq_inv = 1.0 / (_.dt * _.dt); 
+    static const float dt_sq_inv = 1.0 / (SUBSTEP_DT * SUBSTEP_DT); 
 
     if (thread.x >= _.n)
     {
@@ -39,6 +42,11 @@ void main(uint3 thread : SV_DispatchThreadID)
     const uint j = constr[thread.x].j;
     const float d = constr[thread.x].d;
     const float alpha = constr[thread.x].alpha * dt_sq_inv;
+    if (state[i] == SLEEP || state[j] == SLEEP)
+    {
+        // The island of the constraint is asleep.
+        return;
+    }
 
     // Calculate the position corrections due to the distance constraint via XPBD.
     const float3 x_ij = x_[i].xyz - x_[j].xyz;
@@ -0,0 +1,61 @@
+#include <state.hlsl>
+
+struct PushConstant
+{
+    // constraint count
+    uint n;
+};
+[[vk::push_constant]] PushConstant _;
+
+struct LongRangeAttachment
+{
+    // particle index
+    uint i;
+    // anchor particle indices (~0: none)
+    uint a[2];
+    // maximum (geodesic) distances to the anchors
+    float d[2];
+};
+// long-range attachment constraints
+[[vk::binding(0)]] StructuredBuffer<LongRangeAttachment> constr;
+// particle positions
+[[vk::binding(1)]] StructuredBuffer<float4> x;
+// particle states
+[[vk::binding(2)]] StructuredBuffer<uint> state;
+// predicted positions
+[[vk::binding(3)]] RWStructuredBuffer<float4> x_;
+
+[numthreads(g_n, 1, 1)]
+void main(uint3 thread : SV_DispatchThreadID)
+{
+    if (thread.x >= _.n)
+    {
+        return;
+    }
+    const LongRangeAttachment lra = constr[thread.x];
+    const uint i = lra.i;
+    if (state[i] == STATIC || state[i] == SLEEP)
+    {
+        return;
+    }
+
+    // Project the predicted position into the tether spheres around the anchors.
+    // The tethers are unilateral, i.e. they only act if the particle is farther away than the geodesic distance.
+    // The anchors are static, so their current positions are used and the particle takes the full correction.
+    float3 x_i = x_[i].xyz;
+    for (uint k = 0; k < 2; k++)
+    {
+        if (lra.a[k] == ~0u)
+        {
+            continue;
+        }
+        const float3 x_a = x[lra.a[k]].xyz;
+        const float3 x_ai = x_i - x_a;
+        const float d = length(x_ai);
+        if (d > lra.d[k])
+        {
+            x_i = x_a + lra.d[k] / d * x_ai;
+        }
+    }
+    x_[i].xyz = x_i;
+}
\ No newline at end of file
@@ -1,9 +1,6 @@
-struct PushConstant
-{
-    // particle count
-    uint n;
-};
-[[vk::push_constant]] PushConstant _;
+#include <collision.hlsl>
+#include <island.hlsl>
+#include <state.hlsl>
 
 struct PlayerCollision
 {
@@ -28,14 +25,21 @@ struct PlayerCollision
 [[vk::binding(2)]] StructuredBuffer<float> r;
 // position deltas
 [[vk::binding(3)]] RWStructuredBuffer<float4> dx;
+// particle states
+[[vk::binding(4)]] StructuredBuffer<uint> state;
+// particle island indices
+[[vk::binding(5)]] StructuredBuffer<uint> island;
+// islands
+[[vk::binding(6)]] RWStructuredBuffer<Island> islands;
+// particle collision filters
+[[vk::binding(7)]] StructuredBuffer<uint> filter;
+// collider chunks of the bodies overlapping a collider
+[[vk::binding(8)]] StructuredBuffer<ColliderChunk> chunks;
 
 void collideMoon(uint i)
 {
-    // moon radius
-    static const float r_j = 20.0;
-
     // Calculate the penetration depth.
-    const float d = (r[i] + r_j) - length(x_[i].xyz);
+    const float d = (r[i] + MOON_RADIUS) - length(x_[i].xyz);
     if (d > 0.0)
     {
         // Resolve the penetration.
@@ -44,26 +48,17 @@ void collideMoon(uint i)
     }
 }
 
-// Return true if the axis-aligned bounding boxes overlap. Return false otherwise.
-bool overlap(float3 a_min, float3 a_max, float3 b_min, float3 b_max)
-{
-    return (a_min.x < b_max.x &&
-            a_min.y < b_max.y &&
-            a_min.z < b_max.z &&
-            a_max.x > b_min.x &&
-            a_max.y > b_min.y &&
-            a_max.z > b_min.z);
-}
-
-void collidePlayer(uint i)
+// Return true if the particle penetrates the player. Return false otherwise.
+bool collidePlayer(uint i)
 {
+    bool collided = false;
     const float3 x_i_min = x_[i].xyz - r[i];
     const float3 x_i_max = x_[i].xyz + r[i];
 
     // Check for an overlap with the player AABB.
     if (!overlap(x_i_min, x_i_max, player.x_min.xyz, player.x_max.xyz))
     {
-        return;
+        return false;
     }
 
     for (uint j = 0; j < 13; j++)
@@ -87,21 +82,45 @@ void collidePlayer(uint i)
                 // Resolve the penetration.
                 const float3 n = normalize(x_ij);
                 dx[i].xyz += d * n;
+                collided = true;
             }
         }
     }
+    return collided;
 }
 
-[numthreads(g_n, 1, 1)]
-void main(uint3 thread : SV_DispatchThreadID)
+// Calculate the position corrections of the particle due to collisions with the given colliders via (X)PBD.
+void collide(uint i, uint colliders)
 {
-    const uint i = thread.x;
-    if (i >= _.n)
+    // Only the colliders of groups in the collision mask are checked.
+    // Sleeping particles only check for player contact, which wakes up their island.
+    const uint filter_i = filter[i];
+    const bool collideWithPlayer = (colliders & COLLISION_PLAYER) != 0 && collidesWith(filter_i, COLLISION_PLAYER);
+    if (state[i] == SLEEP)
     {
+        if (collideWithPlayer && collidePlayer(i))
+        {
+            islands[island[i]].wake = 1;
+        }
         return;
     }
+    if ((colliders & COLLISION_MOON) != 0 && collidesWith(filter_i, COLLISION_MOON))
+    {
+        collideMoon(i);
+    }
+    if (collideWithPlayer)
+    {
+        collidePlayer(i);
+    }
+}
 
-    // Calculate the position corrections due to object collisions via (X)PBD.
-    collideMoon(i);
-    collidePlayer(i);
+// Each workgroup processes one collider chunk, i.e. the groups are dispatched indirectly by the body broadphase.
+[numthreads(g_n, 1, 1)]
+void main(uint3 group : SV_GroupID, uint3 g_thread : SV_GroupThreadID)
+{
+    const ColliderChunk chunk = chunks[group.x];
+    for (uint i = chunk.begin + g_thread.x; i < chunk.end; i += g_n)
+    {
+        collide(i, chunk.colliders);
+    }
 }
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include <collision.hlsl>
+#include <island.hlsl>
 #include <spatial.hlsl>
 #include <state.hlsl>
 
@@ -5,6 +7,8 @@ struct PushConstant
 {
     // particle count
     uint n;
+    // generation stamp
+    uint stamp;
 };
 [[vk::push_constant]] PushConstant _;
 
@@ -12,8 +16,8 @@ struct PushConstant
 [[vk::binding(0)]] StructuredBuffer<float4> x_;
 // spatial indices
 [[vk::binding(1)]] StructuredBuffer<Spatial> spat;
-// hash value => spatial index range of grid cell
-[[vk::binding(2)]] StructuredBuffer<uint2> cell;
+// hash value => spatial table entry
+[[vk::binding(2)]] StructuredBuffer<Cell> cell;
 // particle radii
 [[vk::binding(3)]] StructuredBuffer<float> r;
 // particle weights (= inverse masses)
@@ -22,11 +26,19 @@ struct PushConstant
 [[vk::binding(5)]] StructuredBuffer<uint> state;
 // position deltas
 [[vk::binding(6)]] RWStructuredBuffer<float4> dx;
+// cell keys
+[[vk::binding(7)]] StructuredBuffer<uint4> key;
+// particle island indices
+[[vk::binding(8)]] StructuredBuffer<uint> island;
+// islands
+[[vk::binding(9)]] RWStructuredBuffer<Island> islands;
+// particle collision filters
+[[vk::binding(10)]] StructuredBuffer<uint> filter;
 
 [numthreads(g_n, 1, 1)]
 void main(uint3 thread : SV_DispatchThreadID)
 {
-    if (thread.x >= _.n || state[spat[thread.x].i] == STATIC)
+    if (thread.x >= _.n || state[spat[thread.x].i] == STATIC || state[spat[thread.x].i] == SLEEP)
     {
         return;
     }
@@ -34,10 +46,18 @@ void main(uint3 thread : SV_DispatchThreadID)
     // Calculate the position corrections due to particle collisions via (X)PBD.
     const uint h = spat[thread.x].h;
     const uint i = spat[thread.x].i;
-    for (uint idx = cell[h].x; idx <= cell[h].y; idx++)
+    const Cell c = cell[h];
+    if (c.stamp != _.stamp)
+    {
+        // Ignore stale entries.
+        return;
+    }
+    const uint filter_i = filter[i];
+    for (uint idx = c.begin; idx <= c.end; idx++)
     {
         const uint j = spat[idx].i;
-        if (i != j)
+        // Reject filtered particle pairs and particles of other cells or batched copies with the same hash value.
+        if (i != j && collides(filter_i, filter[j]) && all(key[i] == key[j]))
         {
             // Calculate the penetration depth.
             const float3 x_ij = x_[i].xyz - x_[j].xyz;
@@ -46,6 +66,11 @@ void main(uint3 thread : SV_DispatchThreadID)
             {
                 // Resolve the penetration.
                 dx[i].xyz += d * w[i] / (w[i] + w[j]) * normalize(x_ij);
+                // Wake up the island of a sleeping particle on contact.
+                if (state[j] == SLEEP)
+                {
+                    islands[island[j]].wake = 1;
+                }
             }
         }
     }
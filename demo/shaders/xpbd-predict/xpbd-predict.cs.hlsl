@@ -1,7 +1,8 @@
+#include <constants.hlsl>
+#include <state.hlsl>
+
 struct PushConstant
 {
-    // time step
-    float dt;
     // moon gravity
     float g;
     // particle count
@@ -15,11 +16,13 @@ struct PushConstant
 [[vk::binding(1)]] StructuredBuffer<float4> v;
 // predicted positions
 [[vk::binding(2)]] RWStructuredBuffer<float4> x_;
+// particle states
+[[vk::binding(3)]] StructuredBuffer<uint> state;
 
 [numthreads(g_n, 1, 1)]
 void main(uint3 thread : SV_DispatchThreadID)
 {
-    static const float dt_sq_g = _.dt * _.dt * _.g;
+    static const float dt_sq_g = SUBSTEP_DT * SUBSTEP_DT * _.g;
 
     const uint i = thread.x;
     if (i >= _.n)
@@ -27,6 +30,13 @@ void main(uint3 thread : SV_DispatchThreadID)
         return;
     }
 
+    // Keep sleeping particles in place, so they remain consistent collision partners.
+    if (state[i] == SLEEP)
+    {
+        x_[i] = x[i];
+        return;
+    }
+
     // Predict the position after the substep.
-    x_[i].xyz = x[i].xyz + _.dt * v[i].xyz + dt_sq_g * normalize(x[i].xyz);
+    x_[i].xyz = x[i].xyz + SUBSTEP_DT * v[i].xyz + dt_sq_g * normalize(x[i].xyz);
 }
\ No newline at end of file
@@ -1,7 +1,8 @@
+#include <constants.hlsl>
+#include <state.hlsl>
+
 struct PushConstant
 {
-    // time step
-    float dt;
     // constraint count
     uint n;
 };
@@ -27,11 +28,13 @@ struct VolumeConstraint
 [[vk::binding(2)]] StructuredBuffer<float> w;
 // position deltas (* 10^7)
 [[vk::binding(3)]] RWStructuredBuffer<int> dxE7;
+// particle states
+[[vk::binding(4)]] StructuredBuffer<uint> state;
 
 [numthreads(g_n, 1, 1)]
 void main(uint3 thread : SV_DispatchThreadID)
 {
-    static const float dt_sq_inv = 1.0 / (_.dt * _.dt); 
+    static const float dt_sq_inv = 1.0 / (SUBSTEP_DT * SUBSTEP_DT); 
     static const float sixth = 1.0 / 6.0;
 
     if (thread.x >= _.n)
@@ -44,6 +47,11 @@ void main(uint3 thread : SV_DispatchThreadID)
     const uint l = constr[thread.x].l;
     const float V = constr[thread.x].V;
     const float alpha = constr[thread.x].alpha * dt_sq_inv;
+    if (state[i] == SLEEP || state[j] == SLEEP || state[k] == SLEEP || state[l] == SLEEP)
+    {
+        // The island of the constraint is asleep.
+        return;
+    }
 
     // Calculate the position corrections due to the volume constraint via XPBD.
     const float3 x_i = x_[i].xyz;